@@ -0,0 +1,430 @@
+#include <stdio.h>
+#include <string.h>
+#include "wmsdk_config.h"
+#include "wm_drv_tft_lcd.h"
+#include "wm_drv_sdh_sdmmc.h"
+#include "wm_cli.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lcd.h"
+#include "pixel.h"
+#include "display.h"
+#include "anim.h"
+#include "sdio.h"
+
+#define LOG_TAG "anim"
+#include "wm_log.h"
+
+/* container layout, see tools/anim_enc.py */
+#define ANIM_BLOCK_SIZE                512
+#define ANIM_MAGIC                     "WANM"
+#define ANIM_VERSION                   1
+#define ANIM_HEADER_SIZE               32
+#define ANIM_FRAME_HEADER_SIZE         8
+#define ANIM_RECT_HEADER_SIZE          12
+#define ANIM_FRAME_KEY                 0
+#define ANIM_FRAME_DELTA               1
+#define ANIM_RLE_REPEAT                0x8000
+#define ANIM_RLE_COUNT_MASK            0x7FFF
+
+/* sd blocks fetched by one read, delta frames are usually much smaller than this */
+#define ANIM_CACHE_BLOCKS              8
+/* key frames beyond this are not used as skip targets */
+#define ANIM_MAX_KEYS                  128
+
+#define NOW_MS()                       (xTaskGetTickCount() * portTICK_PERIOD_MS)
+
+typedef struct {
+    uint32_t frame;
+    uint32_t block;
+} anim_key_t;
+
+typedef struct {
+    wm_device_t *dev;
+    wm_device_t *sd_dev;
+    uint32_t start_block;
+
+    uint16_t width;
+    uint16_t high;
+    uint16_t fps;
+    uint32_t frames;
+    uint32_t data_block;
+    uint32_t keys;
+    anim_key_t *key;
+
+    uint32_t pos;                      /**< byte offset of the next read from start_block */
+    uint8_t *cache;
+    uint32_t cache_first;              /**< first block held in the cache */
+    uint32_t cache_blocks;             /**< blocks held in the cache, 0 when empty */
+
+    lcd_band_t band;
+    anim_stat_t stat;
+} anim_ctx_t;
+
+static anim_stat_t g_anim_last = { 0 };
+
+static uint16_t anim_le16(const uint8_t *p)
+{
+    return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+static uint32_t anim_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* read len bytes at the current position through the block cache */
+static int anim_read(anim_ctx_t *ctx, void *dst, uint32_t len)
+{
+    uint8_t *p = dst;
+    uint32_t block;
+    uint32_t offset;
+    uint32_t n;
+    int ret;
+
+    while (len) {
+        block = ctx->pos / ANIM_BLOCK_SIZE;
+
+        if (!ctx->cache_blocks || (block < ctx->cache_first) || (block >= ctx->cache_first + ctx->cache_blocks)) {
+            ret = sdio_read_blocks(ctx->sd_dev, ctx->cache, ctx->start_block + block, ANIM_CACHE_BLOCKS);
+            if (ret != WM_ERR_SUCCESS) {
+                ctx->cache_blocks = 0;
+                wm_log_error("read sd ret=%d", ret);
+                return ret;
+            }
+
+            ctx->cache_first        = block;
+            ctx->cache_blocks       = ANIM_CACHE_BLOCKS;
+            ctx->stat.blocks_read  += ANIM_CACHE_BLOCKS;
+        }
+
+        offset = ctx->pos - ctx->cache_first * ANIM_BLOCK_SIZE;
+        n      = ctx->cache_blocks * ANIM_BLOCK_SIZE - offset;
+        if (n > len)
+            n = len;
+
+        memcpy(p, ctx->cache + offset, n);
+
+        p        += n;
+        ctx->pos += n;
+        len      -= n;
+    }
+
+    return WM_ERR_SUCCESS;
+}
+
+static int anim_parse_header(anim_ctx_t *ctx)
+{
+    uint8_t hdr[ANIM_HEADER_SIZE];
+    uint8_t entry[8];
+    int ret;
+
+    ctx->pos = 0;
+    ret = anim_read(ctx, hdr, sizeof(hdr));
+    if (ret != WM_ERR_SUCCESS)
+        return ret;
+
+    if (memcmp(hdr, ANIM_MAGIC, 4) || (anim_le16(&hdr[4]) != ANIM_VERSION)) {
+        wm_log_error("not an animation");
+        return WM_ERR_INVALID_PARAM;
+    }
+
+    ctx->width      = anim_le16(&hdr[6]);
+    ctx->high       = anim_le16(&hdr[8]);
+    ctx->fps        = anim_le16(&hdr[10]);
+    ctx->frames     = anim_le32(&hdr[12]);
+    ctx->keys       = anim_le32(&hdr[16]);
+    ctx->data_block = anim_le32(&hdr[20]);
+
+    if (ctx->keys > ANIM_MAX_KEYS)
+        ctx->keys = ANIM_MAX_KEYS;
+
+    if (!ctx->width || !ctx->high || !ctx->frames || !ctx->keys)
+        return WM_ERR_INVALID_PARAM;
+
+    ctx->key = malloc(ctx->keys * sizeof(anim_key_t));
+    if (!ctx->key)
+        return WM_ERR_NO_MEM;
+
+    for (uint32_t i = 0; i < ctx->keys; i++) {
+        ret = anim_read(ctx, entry, sizeof(entry));
+        if (ret != WM_ERR_SUCCESS)
+            return ret;
+
+        ctx->key[i].frame = anim_le32(&entry[0]);
+        ctx->key[i].block = anim_le32(&entry[4]);
+    }
+
+    return WM_ERR_SUCCESS;
+}
+
+/* expand the rle data of one rect into the band and stream it into the rect window */
+static int anim_draw_rect(anim_ctx_t *ctx, uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+    lcd_stream_t stream;
+    uint8_t token[2];
+    uint8_t pixel[2];
+    uint32_t total = (uint32_t)w * h;
+    uint32_t space = ctx->band.len / (w * WM_CFG_TFT_LCD_PIXEL_WIDTH) * w;
+    uint32_t fill  = 0;
+    uint32_t count;
+    uint32_t n;
+    bool repeat;
+    int ret;
+
+    ret = lcd_stream_begin(&stream, ctx->dev, x, y, w, h);
+    if (ret != WM_ERR_SUCCESS)
+        return ret;
+
+    while (total) {
+        ret = anim_read(ctx, token, sizeof(token));
+        if (ret != WM_ERR_SUCCESS)
+            return ret;
+
+        count  = anim_le16(token) & ANIM_RLE_COUNT_MASK;
+        repeat = anim_le16(token) & ANIM_RLE_REPEAT;
+        if (!count || (count > total))
+            return WM_ERR_INVALID_PARAM;
+
+        if (repeat) {
+            ret = anim_read(ctx, pixel, sizeof(pixel));
+            if (ret != WM_ERR_SUCCESS)
+                return ret;
+        }
+
+        /* a run may cross lines and bands, the band goes out whenever it is full */
+        while (count) {
+            n = (count > space - fill) ? (space - fill) : count;
+
+            if (repeat) {
+                pixel_fill(ctx->band.buf + fill * WM_CFG_TFT_LCD_PIXEL_WIDTH, ((uint16_t)pixel[0] << 8) | pixel[1], n);
+            } else {
+                ret = anim_read(ctx, ctx->band.buf + fill * WM_CFG_TFT_LCD_PIXEL_WIDTH, n * WM_CFG_TFT_LCD_PIXEL_WIDTH);
+                if (ret != WM_ERR_SUCCESS)
+                    return ret;
+            }
+
+            fill  += n;
+            count -= n;
+            total -= n;
+
+            if ((fill == space) || !total) {
+                ret = lcd_stream_write(&stream, ctx->band.buf, fill * WM_CFG_TFT_LCD_PIXEL_WIDTH);
+                if (ret != WM_ERR_SUCCESS)
+                    return ret;
+                fill = 0;
+            }
+        }
+    }
+
+    return lcd_stream_end(&stream);
+}
+
+static int anim_draw_frame(anim_ctx_t *ctx)
+{
+    uint8_t hdr[ANIM_RECT_HEADER_SIZE];
+    uint32_t frame_start = ctx->pos;
+    uint32_t blocks;
+    uint32_t rect_end;
+    uint16_t rects;
+    uint16_t x, y, w, h;
+    int ret;
+
+    ret = anim_read(ctx, hdr, ANIM_FRAME_HEADER_SIZE);
+    if (ret != WM_ERR_SUCCESS)
+        return ret;
+
+    rects  = anim_le16(&hdr[2]);
+    blocks = anim_le32(&hdr[4]);
+    if ((hdr[0] > ANIM_FRAME_DELTA) || !blocks)
+        return WM_ERR_INVALID_PARAM;
+
+    for (uint16_t i = 0; i < rects; i++) {
+        ret = anim_read(ctx, hdr, ANIM_RECT_HEADER_SIZE);
+        if (ret != WM_ERR_SUCCESS)
+            return ret;
+
+        x        = anim_le16(&hdr[0]);
+        y        = anim_le16(&hdr[2]);
+        w        = anim_le16(&hdr[4]);
+        h        = anim_le16(&hdr[6]);
+        rect_end = ctx->pos + anim_le32(&hdr[8]);
+
+        if (!w || !h || (x + w > ctx->width) || (y + h > ctx->high))
+            return WM_ERR_INVALID_PARAM;
+
+        ret = anim_draw_rect(ctx, x, y, w, h);
+        if (ret != WM_ERR_SUCCESS)
+            return ret;
+
+        ctx->pos = rect_end;
+    }
+
+    /* frames start on block boundaries */
+    ctx->pos = frame_start + blocks * ANIM_BLOCK_SIZE;
+
+    return WM_ERR_SUCCESS;
+}
+
+/* the latest key frame after frame that is already due, NULL when there is none */
+static const anim_key_t *anim_catch_up(anim_ctx_t *ctx, uint32_t frame, uint32_t elapsed_ms, uint16_t fps)
+{
+    const anim_key_t *found = NULL;
+
+    for (uint32_t i = 0; i < ctx->keys; i++) {
+        if ((ctx->key[i].frame > frame) && ((uint64_t)ctx->key[i].frame * 1000 / fps <= elapsed_ms))
+            found = &ctx->key[i];
+    }
+
+    return found;
+}
+
+static int anim_run(anim_ctx_t *ctx, uint16_t fps, uint32_t loops)
+{
+    const anim_key_t *key;
+    uint32_t period_ms = 1000 / fps;
+    uint32_t start;
+    uint32_t frame_start;
+    uint32_t due;
+    uint32_t now;
+    uint32_t i;
+    int ret = WM_ERR_SUCCESS;
+
+    for (uint32_t loop = 0; (loop <= loops) && (ret == WM_ERR_SUCCESS); loop++) {
+        start    = NOW_MS();
+        ctx->pos = ctx->data_block * ANIM_BLOCK_SIZE;
+
+        for (i = 0; i < ctx->frames;) {
+            now = NOW_MS() - start;
+
+            /* more than a frame behind: deltas cannot be skipped alone, jump to a key frame */
+            if (now > (uint64_t)i * 1000 / fps + period_ms) {
+                key = anim_catch_up(ctx, i, now, fps);
+                if (key) {
+                    ctx->stat.dropped += key->frame - i;
+                    i                  = key->frame;
+                    ctx->pos           = key->block * ANIM_BLOCK_SIZE;
+                }
+            }
+
+            frame_start = NOW_MS();
+            ret = anim_draw_frame(ctx);
+            if (ret != WM_ERR_SUCCESS) {
+                wm_log_error("frame %u ret=%d", i, ret);
+                break;
+            }
+
+            now = NOW_MS();
+            if (now - frame_start > ctx->stat.frame_ms_max)
+                ctx->stat.frame_ms_max = now - frame_start;
+
+            ctx->stat.drawn++;
+            i++;
+
+            /* pace on the schedule of the whole loop, not frame to frame, so that errors do not add up */
+            due = start + (uint64_t)i * 1000 / fps;
+            if (now < due) {
+                vTaskDelay(pdMS_TO_TICKS(due - now));
+            } else if (i < ctx->frames) {
+                ctx->stat.late++;
+            }
+        }
+    }
+
+    return ret;
+}
+
+int anim_play(wm_device_t *dev, uint32_t start_block, uint16_t fps, uint32_t loops, anim_stat_t *stat)
+{
+    anim_ctx_t ctx = { 0 };
+    uint32_t start;
+    int ret;
+
+    if (!dev)
+        return WM_ERR_INVALID_PARAM;
+
+    ctx.dev         = dev;
+    ctx.start_block = start_block;
+
+    ctx.sd_dev = wm_dt_get_device_by_name("sdmmc");
+    if (!(ctx.sd_dev && (WM_DEV_ST_INITED == ctx.sd_dev->state)))
+        ctx.sd_dev = wm_drv_sdh_sdmmc_init("sdmmc");
+
+    if (!ctx.sd_dev) {
+        wm_log_error("sdmmc init failed, maybe sd card not exist");
+        return WM_ERR_FAILED;
+    }
+
+    ctx.cache = malloc(ANIM_CACHE_BLOCKS * ANIM_BLOCK_SIZE);
+    if (!ctx.cache)
+        return WM_ERR_NO_MEM;
+
+    ret = anim_parse_header(&ctx);
+    if (ret != WM_ERR_SUCCESS)
+        goto exit;
+
+    if (!fps)
+        fps = ctx.fps ? ctx.fps : 1;
+
+    wm_log_debug("%ux%u, %u frames, %u key frames, %u fps", ctx.width, ctx.high, ctx.frames, ctx.keys, fps);
+
+    ret = lcd_band_alloc(&ctx.band, ctx.width * WM_CFG_TFT_LCD_PIXEL_WIDTH, ctx.high, 0);
+    if (ret != WM_ERR_SUCCESS) {
+        wm_log_error("mem err");
+        goto exit;
+    }
+
+    start = NOW_MS();
+
+    display_lock();
+    ret = anim_run(&ctx, fps, loops);
+    display_unlock();
+
+    ctx.stat.elapsed_ms = NOW_MS() - start;
+    if (!ctx.stat.elapsed_ms)
+        ctx.stat.elapsed_ms = 1;
+
+    wm_log_info("%u frames drawn, %u dropped, %u late, %u.%02u fps of %u, slowest %u ms, sd %u KB/s",
+                ctx.stat.drawn, ctx.stat.dropped, ctx.stat.late,
+                ctx.stat.drawn * 1000 / ctx.stat.elapsed_ms, (ctx.stat.drawn * 100000 / ctx.stat.elapsed_ms) % 100,
+                fps, ctx.stat.frame_ms_max, ctx.stat.blocks_read * ANIM_BLOCK_SIZE / ctx.stat.elapsed_ms * 1000 / 1024);
+
+    if (stat)
+        *stat = ctx.stat;
+
+exit:
+    lcd_band_free(&ctx.band);
+    if (ctx.key)
+        free(ctx.key);
+    free(ctx.cache);
+
+    return ret;
+}
+
+static void cmd_anim(int argc, char *argv[])
+{
+    wm_device_t *dev;
+    int ret;
+
+    if (argc < 2)
+        return;
+
+    if (!strcmp("play", argv[1])) {
+        if (argc < 3)
+            return;
+
+        dev = lcd_get_device();
+        if (!dev)
+            return;
+
+        ret = anim_play(dev, atoi(argv[2]), (argc > 3) ? atoi(argv[3]) : 0, (argc > 4) ? atoi(argv[4]) : 0, &g_anim_last);
+        if (ret != WM_ERR_SUCCESS) {
+            wm_log_error("anim_play ret=%d", ret);
+        }
+    } else if (!strcmp("stat", argv[1])) {
+        wm_cli_printf("drawn %u, dropped %u, late %u, %u ms, slowest frame %u ms, %u sd blocks\r\n",
+                      g_anim_last.drawn, g_anim_last.dropped, g_anim_last.late, g_anim_last.elapsed_ms,
+                      g_anim_last.frame_ms_max, g_anim_last.blocks_read);
+    }
+}
+WM_CLI_CMD_DEFINE(anim, cmd_anim, anim cmd, anim <play <start_block> [fps] [loops] | stat> -- play an animation from sd card);
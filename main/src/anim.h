@@ -0,0 +1,32 @@
+#ifndef __ANIM_H__
+#define __ANIM_H__
+
+#include <stdint.h>
+#include "wm_dt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t drawn;                    /**< frames decoded and sent to the lcd */
+    uint32_t dropped;                  /**< frames skipped to catch up with the schedule */
+    uint32_t late;                     /**< frames that finished after the next one was due */
+    uint32_t elapsed_ms;
+    uint32_t frame_ms_max;             /**< slowest frame, sd read + decode + lcd */
+    uint32_t blocks_read;
+} anim_stat_t;
+
+/*
+ * Play an animation written by tools/anim_enc.py at start_block of the sd card.
+ * fps 0 uses the rate stored in the file, loops 0 plays once.
+ * When playback falls more than a frame behind, it jumps to the latest key frame already due,
+ * delta frames in between are dropped.
+ */
+int anim_play(wm_device_t *dev, uint32_t start_block, uint16_t fps, uint32_t loops, anim_stat_t *stat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ANIM_H__ */
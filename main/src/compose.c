@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wmsdk_config.h"
+#include "wm_drv_tft_lcd.h"
+#include "wm_cli.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lcd.h"
+#include "display.h"
+#include "pixel.h"
+#include "compose.h"
+
+#define LOG_TAG "compose"
+#include "wm_log.h"
+
+#define COMPOSE_BAR_HEIGHT             24
+#define COMPOSE_POPUP_WIDTH            240
+#define COMPOSE_POPUP_HEIGHT           72
+
+#define NOW_MS()                       (xTaskGetTickCount() * portTICK_PERIOD_MS)
+
+#define COMPOSE_MAX(a, b)              (((a) > (b)) ? (a) : (b))
+#define COMPOSE_MIN(a, b)              (((a) < (b)) ? (a) : (b))
+
+/* blend the part of one layer that falls in band lines [y, y + lines) of a region starting at column x, w wide */
+static void compose_layer_band(const compose_layer_t *layer, uint8_t *buf, uint8_t *line,
+                               uint16_t x, uint16_t w, uint16_t y, uint16_t lines, compose_stat_t *stat)
+{
+    int x0 = COMPOSE_MAX(x, layer->x);
+    int x1 = COMPOSE_MIN(x + w, layer->x + layer->w);
+    int y0 = COMPOSE_MAX(y, layer->y);
+    int y1 = COMPOSE_MIN(y + lines, layer->y + layer->h);
+    uint32_t lx;
+    uint32_t n;
+
+    if ((x0 >= x1) || (y0 >= y1))
+        return;
+
+    lx = x0 - layer->x;
+    n  = x1 - x0;
+
+    /* a solid layer blends the same source line into every row */
+    if (!layer->pixels)
+        pixel_fill(line, layer->color, n);
+
+    for (int row = y0; row < y1; row++) {
+        uint8_t *dst       = buf + ((uint32_t)(row - y) * w + (x0 - x)) * WM_CFG_TFT_LCD_PIXEL_WIDTH;
+        uint32_t ly        = row - layer->y;
+        const uint8_t *src = layer->pixels ? (layer->pixels + (ly * layer->w + lx) * WM_CFG_TFT_LCD_PIXEL_WIDTH) : line;
+
+        if (!layer->alpha)
+            pixel_blend(dst, src, layer->opacity, n);
+        else if (layer->alpha_bits == 4)
+            pixel_blend_a4(dst, src, layer->alpha + ly * ((layer->w + 1) / 2) + lx / 2, lx & 1, n);
+        else
+            pixel_blend_a8(dst, src, layer->alpha + ly * layer->w + lx, n);
+    }
+
+    stat->pixels_blended += n * (y1 - y0);
+}
+
+int compose_region(wm_device_t *dev, const compose_scene_t *scene, uint16_t x, uint16_t y, uint16_t w, uint16_t h,
+                   compose_stat_t *stat)
+{
+    wm_lcd_capabilitys_t cap = { 0 };
+    compose_stat_t local     = { 0 };
+    lcd_stream_t stream      = { 0 };
+    lcd_band_t band          = { 0 };
+    uint32_t line_size       = w * WM_CFG_TFT_LCD_PIXEL_WIDTH;
+    uint8_t *line;
+    uint32_t start;
+    uint16_t lines;
+    int ret;
+
+    if (!stat)
+        stat = &local;
+    memset(stat, 0, sizeof(*stat));
+
+    wm_drv_tft_lcd_get_capability(dev, &cap);
+    if (!w || !h || (x + w > cap.x_resolution) || (y + h > cap.y_resolution))
+        return WM_ERR_INVALID_PARAM;
+
+    /* one more line holds the color of solid layers */
+    ret = lcd_band_alloc(&band, line_size, h, line_size);
+    if (ret != WM_ERR_SUCCESS)
+        return ret;
+
+    line             = band.buf + band.lines * line_size;
+    stat->band_lines = band.lines;
+
+    display_lock();
+    ret = lcd_stream_begin(&stream, dev, x, y, w, h);
+
+    for (uint16_t i = 0; (i < h) && (ret == WM_ERR_SUCCESS); i += lines) {
+        lines = COMPOSE_MIN(band.lines, h - i);
+        start = NOW_MS();
+
+        if (scene->background) {
+            for (uint16_t r = 0; r < lines; r++) {
+                memcpy(band.buf + r * line_size,
+                       scene->background + ((uint32_t)(y + i + r) * cap.x_resolution + x) * WM_CFG_TFT_LCD_PIXEL_WIDTH,
+                       line_size);
+            }
+        } else {
+            pixel_fill(band.buf, scene->bg_color, (uint32_t)w * lines);
+        }
+
+        for (uint8_t k = 0; k < scene->count; k++)
+            compose_layer_band(&scene->layers[k], band.buf, line, x, w, y + i, lines, stat);
+
+        stat->blend_ms += NOW_MS() - start;
+
+        start = NOW_MS();
+        ret   = lcd_stream_write(&stream, band.buf, lines * line_size);
+        stat->lcd_ms += NOW_MS() - start;
+    }
+
+    if (ret == WM_ERR_SUCCESS)
+        ret = lcd_stream_end(&stream);
+    display_unlock();
+
+    lcd_band_free(&band);
+
+    return ret;
+}
+
+/* text in fg on a fully transparent background, the alpha plane marks the glyph pixels */
+static uint8_t *compose_text_layer(compose_layer_t *layer, const char *str, uint8_t scale, uint16_t fg, uint8_t bits)
+{
+    uint16_t len     = strlen(str);
+    uint16_t stride;
+    uint8_t *pixels;
+    uint8_t *alpha;
+
+    layer->w          = len * LCD_CHAR_WIDTH * scale;
+    layer->h          = LCD_CHAR_HEIGHT * scale;
+    layer->alpha_bits = bits;
+    stride            = (bits == 4) ? ((layer->w + 1) / 2) : layer->w;
+
+    /* one allocation for both planes, freed through the pixels pointer */
+    pixels = malloc((uint32_t)layer->w * layer->h * WM_CFG_TFT_LCD_PIXEL_WIDTH + (uint32_t)stride * layer->h);
+    if (!pixels)
+        return NULL;
+    alpha = pixels + (uint32_t)layer->w * layer->h * WM_CFG_TFT_LCD_PIXEL_WIDTH;
+
+    lcd_render_string(pixels, str, len, scale, 0, layer->h, fg, (uint16_t)~fg);
+    memset(alpha, 0, (uint32_t)stride * layer->h);
+
+    for (uint32_t j = 0; j < layer->h; j++) {
+        for (uint32_t i = 0; i < layer->w; i++) {
+            const uint8_t *p = pixels + (j * layer->w + i) * WM_CFG_TFT_LCD_PIXEL_WIDTH;
+
+            if ((((uint16_t)p[0] << 8) | p[1]) != fg)
+                continue;
+
+            if (bits == 4)
+                alpha[j * stride + i / 2] |= (i & 1) ? 0x0F : 0xF0;
+            else
+                alpha[j * layer->w + i] = 0xFF;
+        }
+    }
+
+    layer->pixels = pixels;
+    layer->alpha  = alpha;
+
+    return pixels;
+}
+
+static void compose_print(const char *name, uint16_t w, uint16_t h, uint32_t loops, const compose_stat_t *sum)
+{
+    uint32_t ms = sum->blend_ms + sum->lcd_ms;
+
+    wm_cli_printf("%-6s %3ux%-3u  blend %4u ms  lcd %4u ms  %6.2f fps  %u lines per band, %u pixels blended\r\n",
+                  name, w, h, sum->blend_ms / loops, sum->lcd_ms / loops, (float)loops * 1000 / (ms ? ms : 1),
+                  sum->band_lines, sum->pixels_blended / loops);
+}
+
+/* a translucent status bar and popup over the built-in picture, the whole screen then the popup alone */
+static void cmd_compose(int argc, char *argv[])
+{
+    compose_layer_t layers[4]     = { 0 };
+    compose_scene_t scene         = { 0 };
+    wm_lcd_capabilitys_t cap      = { 0 };
+    compose_stat_t stat;
+    compose_stat_t screen         = { 0 };
+    compose_stat_t popup          = { 0 };
+    uint8_t opacity               = (argc > 1) ? (uint8_t)strtoul(argv[1], NULL, 0) : 160;
+    uint32_t loops                = (argc > 2) ? strtoul(argv[2], NULL, 0) : 10;
+    uint8_t *bar_text             = NULL;
+    uint8_t *popup_text           = NULL;
+    wm_device_t *dev;
+    int ret                       = WM_ERR_SUCCESS;
+
+    if (!loops)
+        return;
+
+    dev = lcd_get_device();
+    if (!dev)
+        return;
+
+    wm_drv_tft_lcd_get_capability(dev, &cap);
+
+    /* status bar, solid with one opacity, and its text with a 4-bit mask */
+    layers[0].w       = cap.x_resolution;
+    layers[0].h       = COMPOSE_BAR_HEIGHT;
+    layers[0].color   = LCD_RGB565_BLACK;
+    layers[0].opacity = opacity;
+
+    bar_text    = compose_text_layer(&layers[1], "12:00  25.3C  56%RH", 2, LCD_RGB565_WHITE, 4);
+    layers[1].x = 8;
+    layers[1].y = (COMPOSE_BAR_HEIGHT - layers[1].h) / 2;
+
+    /* popup in the middle, its text with an 8-bit mask */
+    layers[2].x       = (cap.x_resolution - COMPOSE_POPUP_WIDTH) / 2;
+    layers[2].y       = (cap.y_resolution - COMPOSE_POPUP_HEIGHT) / 2;
+    layers[2].w       = COMPOSE_POPUP_WIDTH;
+    layers[2].h       = COMPOSE_POPUP_HEIGHT;
+    layers[2].color   = LCD_RGB565_BLUE;
+    layers[2].opacity = opacity;
+
+    popup_text  = compose_text_layer(&layers[3], "Hello", 4, LCD_RGB565_YELLOW, 8);
+    layers[3].x = layers[2].x + (layers[2].w - layers[3].w) / 2;
+    layers[3].y = layers[2].y + (layers[2].h - layers[3].h) / 2;
+
+    if (!bar_text || !popup_text) {
+        wm_cli_printf("mem err\r\n");
+        goto exit;
+    }
+
+    scene.background = image_bluesky_480x272;
+    scene.layers     = layers;
+    scene.count      = 4;
+
+    for (uint32_t i = 0; (i < loops) && (ret == WM_ERR_SUCCESS); i++) {
+        ret = compose_region(dev, &scene, 0, 0, cap.x_resolution, cap.y_resolution, &stat);
+        screen.blend_ms += stat.blend_ms;
+        screen.lcd_ms += stat.lcd_ms;
+        screen.pixels_blended += stat.pixels_blended;
+        screen.band_lines = stat.band_lines;
+    }
+
+    /* a popup update only touches its own rectangle */
+    for (uint32_t i = 0; (i < loops) && (ret == WM_ERR_SUCCESS); i++) {
+        ret = compose_region(dev, &scene, layers[2].x, layers[2].y, layers[2].w, layers[2].h, &stat);
+        popup.blend_ms += stat.blend_ms;
+        popup.lcd_ms += stat.lcd_ms;
+        popup.pixels_blended += stat.pixels_blended;
+        popup.band_lines = stat.band_lines;
+    }
+
+    if (ret != WM_ERR_SUCCESS) {
+        wm_cli_printf("compose ret=%d\r\n", ret);
+        goto exit;
+    }
+
+    wm_cli_printf("opacity %u, %u loops, per frame:\r\n", opacity, loops);
+    compose_print("screen", cap.x_resolution, cap.y_resolution, loops, &screen);
+    compose_print("popup", layers[2].w, layers[2].h, loops, &popup);
+
+exit:
+    free(bar_text);
+    free(popup_text);
+}
+WM_CLI_CMD_DEFINE(compose, cmd_compose, compose cmd, compose [opacity] [loops] -- blend a status bar and popup over an image and time it);
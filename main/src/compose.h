@@ -0,0 +1,50 @@
+#ifndef __COMPOSE_H__
+#define __COMPOSE_H__
+
+#include <stdint.h>
+#include "wm_dt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* one overlay in screen coordinates, it may reach past the composed region, only the overlap is blended */
+typedef struct {
+    uint16_t x;
+    uint16_t y;
+    uint16_t w;
+    uint16_t h;
+    const uint8_t *pixels;             /**< rgb565 lcd byte order, w * h, NULL for a solid color layer */
+    uint16_t color;                    /**< used when pixels is NULL */
+    const uint8_t *alpha;              /**< alpha plane, NULL to apply opacity to the whole layer */
+    uint8_t alpha_bits;                /**< 8: a byte per pixel, 4: two pixels per byte and each line starts on a byte */
+    uint8_t opacity;                   /**< 0 - 255, used when alpha is NULL */
+} compose_layer_t;
+
+typedef struct {
+    const uint8_t *background;         /**< full screen rgb565 image, NULL to use bg_color */
+    uint16_t bg_color;
+    const compose_layer_t *layers;     /**< bottom first */
+    uint8_t count;
+} compose_scene_t;
+
+typedef struct {
+    uint32_t blend_ms;                 /**< background copy and blending */
+    uint32_t lcd_ms;
+    uint32_t pixels_blended;
+    uint16_t band_lines;
+} compose_stat_t;
+
+/*
+ * Compose the scene inside (x, y, w, h) and stream it to the lcd band by band,
+ * the overlays are blended over the background in the band buffer and nothing is read back from the panel.
+ * stat may be NULL.
+ */
+int compose_region(wm_device_t *dev, const compose_scene_t *scene, uint16_t x, uint16_t y, uint16_t w, uint16_t h,
+                   compose_stat_t *stat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __COMPOSE_H__ */
@@ -0,0 +1,42 @@
+#ifndef __CRC_H__
+#define __CRC_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Table driven checksums, chained by passing the previous result back in:
+ *   crc8   poly 0x31, init 0xFF, not reflected (sensirion sensors)
+ *   crc16  poly 0x1021, init 0xFFFF, not reflected (ccitt-false)
+ *   crc32  poly 0x04C11DB7 reflected, the zlib / ethernet crc, start from 0
+ * With CRC_HW_ENABLE crc32 hands aligned buffers of CRC_HW_MIN_LEN bytes or more to the hardware
+ * crc block when it passed a self check against the table, and falls back to the table when it is busy.
+ */
+#define CRC8_INIT                      0xFF
+#define CRC16_INIT                     0xFFFF
+#define CRC32_INIT                     0
+
+/*
+ * The crc block is part of the gpsec unit (0x40000600) with the hash and rng the sdk drives for
+ * mbedtls and the network stack, which know nothing of crc32's claim on it, so this image does not
+ * use it: the driver is not enabled in prj.config and crc32 always runs from the table. The backend
+ * is kept for an image where nothing else uses the unit, it needs CONFIG_COMPONENT_DRIVER_CRC_ENABLED
+ * as well as CRC_HW_ENABLE.
+ */
+#define CRC_HW_ENABLE                  0
+
+/* below this the table is faster than setting up the hardware */
+#define CRC_HW_MIN_LEN                 256
+
+uint8_t crc8(uint8_t crc, const void *data, uint32_t len);
+uint16_t crc16(uint16_t crc, const void *data, uint32_t len);
+uint32_t crc32(uint32_t crc, const void *data, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CRC_H__ */
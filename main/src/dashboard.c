@@ -0,0 +1,323 @@
+#include <stdio.h>
+#include <string.h>
+#include "wmsdk_config.h"
+#include "wm_drv_tft_lcd.h"
+#include "wm_netif.h"
+#include "wm_cli.h"
+#include "lwip/netif.h"
+#include "lwip/ip_addr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lcd.h"
+#include "display.h"
+#include "sht30.h"
+#include "ntc.h"
+#include "fastbee.h"
+
+#define LOG_TAG "dashboard"
+#include "wm_log.h"
+
+#define DASHBOARD_TASK_STACK           1024
+#define DASHBOARD_TASK_PRIO            1
+
+#define DASHBOARD_DEFAULT_PERIOD_MS    1000
+#define DASHBOARD_MIN_PERIOD_MS        100
+#define DASHBOARD_STAT_INTERVAL_MS     10000
+/* a stop wakes the task, it only has to finish the frame it is drawing */
+#define DASHBOARD_STOP_MS              1000
+
+#define DASHBOARD_SCALE                3
+#define DASHBOARD_CHAR_W               (LCD_CHAR_WIDTH * DASHBOARD_SCALE)
+#define DASHBOARD_CHAR_H               (LCD_CHAR_HEIGHT * DASHBOARD_SCALE)
+#define DASHBOARD_LABEL_CHARS          6
+#define DASHBOARD_VALUE_CHARS          16
+#define DASHBOARD_TITLE_Y              8
+#define DASHBOARD_FIELD_X              12
+#define DASHBOARD_FIELD_Y              48
+#define DASHBOARD_FIELD_PITCH          36
+#define DASHBOARD_VALUE_X              (DASHBOARD_FIELD_X + DASHBOARD_LABEL_CHARS * DASHBOARD_CHAR_W)
+
+#define DASHBOARD_BG_COLOR             LCD_RGB565_BLACK
+#define DASHBOARD_LABEL_COLOR          LCD_RGB565_CYAN
+#define DASHBOARD_VALUE_COLOR          LCD_RGB565_WHITE
+
+#define NOW_MS()                       (xTaskGetTickCount() * portTICK_PERIOD_MS)
+
+enum {
+    DASHBOARD_FIELD_TEMP = 0,
+    DASHBOARD_FIELD_HUMI,
+    DASHBOARD_FIELD_NTC,
+    DASHBOARD_FIELD_IP,
+    DASHBOARD_FIELD_MQTT,
+    DASHBOARD_FIELD_LED,
+    DASHBOARD_FIELD_MAX
+};
+
+static const char *dashboard_labels[DASHBOARD_FIELD_MAX] = {"Temp", "Humi", "NTC", "IP", "MQTT", "LED"};
+
+typedef struct {
+    TaskHandle_t task;
+    volatile bool running;
+    volatile uint32_t period_ms;
+    char value[DASHBOARD_FIELD_MAX][DASHBOARD_VALUE_CHARS + 1]; /**< text currently shown on the panel */
+
+    uint32_t frames;                   /**< frames evaluated since the last report */
+    uint32_t fields;                   /**< fields redrawn since the last report */
+    uint32_t render_ms;                /**< time spent expanding glyphs since the last report */
+    uint32_t xfer_ms;                  /**< time spent in draw_bitmap since the last report */
+    uint32_t stat_start;               /**< tick (ms) of the last report */
+} dashboard_ctx_t;
+
+static dashboard_ctx_t g_dash = { 0 };
+
+static void dashboard_format_ip(char *buf, size_t size)
+{
+    wm_netif_t *netif = wm_netif_get_netif(WM_NETIF_TYPE_ETH);
+
+    if (!netif || !netif->netif || !netif_is_link_up(netif->netif)) {
+        snprintf(buf, size, "link down");
+        return;
+    }
+
+    if (ip_addr_isany(&netif->netif->ip_addr)) {
+        snprintf(buf, size, "link up, no ip");
+        return;
+    }
+
+    ipaddr_ntoa_r(&netif->netif->ip_addr, buf, size);
+}
+
+/* collect the latest readings, formatted exactly as they are shown */
+static void dashboard_collect(char value[DASHBOARD_FIELD_MAX][DASHBOARD_VALUE_CHARS + 1])
+{
+    float temp;
+    float humi;
+
+    if (WM_ERR_SUCCESS == sht30_read(&temp, &humi)) {
+        snprintf(value[DASHBOARD_FIELD_TEMP], DASHBOARD_VALUE_CHARS + 1, "%.1f C", temp);
+        snprintf(value[DASHBOARD_FIELD_HUMI], DASHBOARD_VALUE_CHARS + 1, "%.1f %%", humi);
+    } else {
+        snprintf(value[DASHBOARD_FIELD_TEMP], DASHBOARD_VALUE_CHARS + 1, "--");
+        snprintf(value[DASHBOARD_FIELD_HUMI], DASHBOARD_VALUE_CHARS + 1, "--");
+    }
+
+    if (WM_ERR_SUCCESS == ntc_get(&temp)) {
+        snprintf(value[DASHBOARD_FIELD_NTC], DASHBOARD_VALUE_CHARS + 1, "%.1f C", temp);
+    } else {
+        snprintf(value[DASHBOARD_FIELD_NTC], DASHBOARD_VALUE_CHARS + 1, "--");
+    }
+
+    dashboard_format_ip(value[DASHBOARD_FIELD_IP], DASHBOARD_VALUE_CHARS + 1);
+
+    snprintf(value[DASHBOARD_FIELD_MQTT], DASHBOARD_VALUE_CHARS + 1, "%s",
+             fastbee_mqtt_state() ? "connected" : "disconnected");
+    snprintf(value[DASHBOARD_FIELD_LED], DASHBOARD_VALUE_CHARS + 1, "%s", led_state() ? "on" : "off");
+}
+
+/* render one value padded to the field width, so that the previous text is always overwritten */
+static int dashboard_draw_value(wm_device_t *dev, uint8_t *buf, int field, const char *text)
+{
+    char padded[DASHBOARD_VALUE_CHARS + 1];
+    uint32_t start;
+    int ret;
+
+    snprintf(padded, sizeof(padded), "%-*s", DASHBOARD_VALUE_CHARS, text);
+
+    start = NOW_MS();
+    lcd_render_string(buf, padded, DASHBOARD_VALUE_CHARS, DASHBOARD_SCALE, 0, DASHBOARD_CHAR_H,
+                      DASHBOARD_VALUE_COLOR, DASHBOARD_BG_COLOR);
+    g_dash.render_ms += NOW_MS() - start;
+
+    start = NOW_MS();
+    ret = lcd_flush_area(dev, buf, DASHBOARD_VALUE_X, DASHBOARD_FIELD_Y + field * DASHBOARD_FIELD_PITCH,
+                         DASHBOARD_VALUE_CHARS * DASHBOARD_CHAR_W, DASHBOARD_CHAR_H);
+    g_dash.xfer_ms += NOW_MS() - start;
+
+    return ret;
+}
+
+static void dashboard_layout(wm_device_t *dev, uint8_t *buf, uint32_t buf_len)
+{
+    wm_lcd_capabilitys_t cap = { 0 };
+
+    wm_drv_tft_lcd_get_capability(dev, &cap);
+
+    lcd_fill_rect(dev, buf, buf_len, 0, 0, cap.x_resolution, cap.y_resolution, DASHBOARD_BG_COLOR);
+
+    lcd_draw_string(dev, buf, buf_len, DASHBOARD_FIELD_X, DASHBOARD_TITLE_Y, "W802 Virt Board",
+                    DASHBOARD_SCALE, LCD_RGB565_YELLOW, DASHBOARD_BG_COLOR);
+
+    for (int i = 0; i < DASHBOARD_FIELD_MAX; i++) {
+        lcd_draw_string(dev, buf, buf_len, DASHBOARD_FIELD_X, DASHBOARD_FIELD_Y + i * DASHBOARD_FIELD_PITCH,
+                        dashboard_labels[i], DASHBOARD_SCALE, DASHBOARD_LABEL_COLOR, DASHBOARD_BG_COLOR);
+        g_dash.value[i][0] = '\0';
+    }
+}
+
+static void dashboard_report(void)
+{
+    uint32_t elapsed = NOW_MS() - g_dash.stat_start;
+
+    if (!elapsed)
+        return;
+
+    wm_log_info("%u frames, %u fields redrawn, render %u ms, xfer %u ms, lcd load %u.%02u%%",
+                g_dash.frames, g_dash.fields, g_dash.render_ms, g_dash.xfer_ms,
+                (g_dash.render_ms + g_dash.xfer_ms) * 100 / elapsed,
+                ((g_dash.render_ms + g_dash.xfer_ms) * 10000 / elapsed) % 100);
+
+    g_dash.frames     = 0;
+    g_dash.fields     = 0;
+    g_dash.render_ms  = 0;
+    g_dash.xfer_ms    = 0;
+    g_dash.stat_start = NOW_MS();
+}
+
+/* the handle is cleared in a critical section, so a stop that still sees it can notify the task */
+static void dashboard_task_exit(void)
+{
+    taskENTER_CRITICAL();
+    g_dash.running = false;
+    g_dash.task    = NULL;
+    taskEXIT_CRITICAL();
+
+    vTaskDelete(NULL);
+}
+
+static void dashboard_task(void *param)
+{
+    wm_device_t *dev = param;
+    char value[DASHBOARD_FIELD_MAX][DASHBOARD_VALUE_CHARS + 1];
+    uint32_t buf_len = DASHBOARD_VALUE_CHARS * DASHBOARD_CHAR_W * DASHBOARD_CHAR_H * WM_CFG_TFT_LCD_PIXEL_WIDTH;
+    uint8_t *buf;
+    TickType_t last_wake;
+    TickType_t wait;
+
+    buf = malloc(buf_len);
+    if (!buf) {
+        wm_log_error("mem err");
+        dashboard_task_exit();
+        return;
+    }
+
+    /* the sampler reads the sensors, the panel only shows their latest samples */
+    sht30_start();
+    ntc_sample_start();
+
+    display_lock();
+    dashboard_layout(dev, buf, buf_len);
+    display_unlock();
+
+    g_dash.stat_start = NOW_MS();
+    last_wake         = xTaskGetTickCount();
+
+    while (g_dash.running) {
+        uint32_t render_ms = g_dash.render_ms;
+        uint32_t xfer_ms   = g_dash.xfer_ms;
+        int changed        = 0;
+
+        dashboard_collect(value);
+
+        /* the fields are drawn directly, keep the display service out for the whole frame */
+        display_lock();
+        for (int i = 0; i < DASHBOARD_FIELD_MAX; i++) {
+            if (strcmp(value[i], g_dash.value[i])) {
+                if (WM_ERR_SUCCESS == dashboard_draw_value(dev, buf, i, value[i])) {
+                    strcpy(g_dash.value[i], value[i]);
+                }
+                changed++;
+            }
+        }
+        display_unlock();
+
+        g_dash.frames++;
+        g_dash.fields += changed;
+
+        if (changed) {
+            wm_log_debug("frame: %d fields, render %u ms, xfer %u ms", changed,
+                         g_dash.render_ms - render_ms, g_dash.xfer_ms - xfer_ms);
+        }
+
+        if (NOW_MS() - g_dash.stat_start >= DASHBOARD_STAT_INTERVAL_MS)
+            dashboard_report();
+
+        /* the next frame on the period grid, or at once when behind; a stop notifies the wait */
+        last_wake += pdMS_TO_TICKS(g_dash.period_ms);
+        wait       = last_wake - xTaskGetTickCount();
+        if ((int32_t)wait > 0)
+            ulTaskNotifyTake(pdTRUE, wait);
+        else
+            last_wake = xTaskGetTickCount();
+    }
+
+    free(buf);
+    dashboard_task_exit();
+}
+
+static void dashboard_stop(void)
+{
+    taskENTER_CRITICAL();
+    g_dash.running = false;
+    if (g_dash.task)
+        xTaskNotifyGive(g_dash.task);
+    taskEXIT_CRITICAL();
+}
+
+static int dashboard_wait_exit(void)
+{
+    uint32_t start = NOW_MS();
+
+    while (g_dash.task) {
+        if (NOW_MS() - start > DASHBOARD_STOP_MS)
+            return WM_ERR_TIMEOUT;
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    return WM_ERR_SUCCESS;
+}
+
+static void cmd_dashboard(int argc, char *argv[])
+{
+    wm_device_t *dev;
+    uint32_t period_ms = DASHBOARD_DEFAULT_PERIOD_MS;
+
+    if (argc < 2)
+        return;
+
+    if (argc == 3) {
+        period_ms = atoi(argv[2]);
+        if (period_ms < DASHBOARD_MIN_PERIOD_MS)
+            period_ms = DASHBOARD_MIN_PERIOD_MS;
+    }
+
+    if (!strcmp("start", argv[1])) {
+        g_dash.period_ms = period_ms;
+
+        if (g_dash.task && g_dash.running)
+            return;
+
+        /* a task still stopping would clear the handle of the new one on its way out */
+        if (dashboard_wait_exit() != WM_ERR_SUCCESS) {
+            wm_log_warn("previous task still running");
+            return;
+        }
+
+        dev = lcd_get_device();
+        if (!dev)
+            return;
+
+        g_dash.running = true;
+        if (pdPASS != xTaskCreate(dashboard_task, "dashboard", DASHBOARD_TASK_STACK, dev, DASHBOARD_TASK_PRIO, &g_dash.task)) {
+            wm_log_error("create task fail");
+            g_dash.running = false;
+            g_dash.task    = NULL;
+        }
+    } else if (!strcmp("stop", argv[1])) {
+        dashboard_stop();
+        if (dashboard_wait_exit() != WM_ERR_SUCCESS)
+            wm_log_warn("task still running");
+    } else if (!strcmp("stat", argv[1])) {
+        dashboard_report();
+    }
+}
+WM_CLI_CMD_DEFINE(dashboard, cmd_dashboard, dashboard cmd, dashboard <start | stop | stat> [refresh_ms] -- show sensor dashboard on lcd);
@@ -0,0 +1,316 @@
+#include <stdio.h>
+#include <string.h>
+#include "wmsdk_config.h"
+#include "wm_drv_tft_lcd.h"
+#include "wm_cli.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "lcd.h"
+#include "display.h"
+
+#define LOG_TAG "display"
+#include "wm_log.h"
+
+#define DISPLAY_TASK_STACK             1024
+#define DISPLAY_TASK_PRIO              2
+#define DISPLAY_QUEUE_LEN              16
+
+typedef enum {
+    DISPLAY_CMD_FILL = 0,
+    DISPLAY_CMD_IMAGE,
+    DISPLAY_CMD_TEXT,
+    DISPLAY_CMD_BACKLIGHT
+} display_cmd_type_t;
+
+typedef struct {
+    uint8_t type;
+    bool on;                           /**< backlight */
+    uint8_t scale;                     /**< text */
+    uint16_t x;
+    uint16_t y;
+    uint16_t w;
+    uint16_t h;
+    uint16_t fg;                       /**< fill color or text color */
+    uint16_t bg;                       /**< text background */
+    const uint8_t *data;               /**< image */
+    char text[DISPLAY_TEXT_MAX + 1];
+} display_cmd_t;
+
+typedef struct {
+    TaskHandle_t task;
+    QueueHandle_t queue;
+    SemaphoreHandle_t mutex;
+    wm_device_t *dev;
+    lcd_band_t band;
+
+    uint32_t queued;                   /**< commands accepted */
+    uint32_t dropped;                  /**< commands refused because the queue was full */
+    uint32_t coalesced;                /**< commands skipped because a later one replaced them */
+    uint32_t drawn;                    /**< commands executed */
+} display_ctx_t;
+
+static display_ctx_t g_disp = { 0 };
+
+/* true when b paints over every pixel of a */
+static bool display_covers(const display_cmd_t *b, const display_cmd_t *a)
+{
+    if (a->type == DISPLAY_CMD_BACKLIGHT || b->type == DISPLAY_CMD_BACKLIGHT)
+        return a->type == b->type;
+
+    return (b->x <= a->x) && (b->y <= a->y) &&
+           (b->x + b->w >= a->x + a->w) && (b->y + b->h >= a->y + a->h);
+}
+
+static void display_execute(const display_cmd_t *cmd)
+{
+    image_attr_t img = { 0 };
+    int ret          = WM_ERR_SUCCESS;
+
+    if (!g_disp.band.buf && (cmd->type != DISPLAY_CMD_BACKLIGHT)) {
+        wm_log_error("cmd %d no band buffer", cmd->type);
+        return;
+    }
+
+    switch (cmd->type) {
+        case DISPLAY_CMD_FILL:
+            ret = lcd_fill_rect(g_disp.dev, g_disp.band.buf, g_disp.band.len, cmd->x, cmd->y, cmd->w, cmd->h, cmd->fg);
+            break;
+        case DISPLAY_CMD_IMAGE:
+            img.image_buf   = cmd->data;
+            img.image_width = cmd->w;
+            img.image_high  = cmd->h;
+            ret = lcd_draw_image(g_disp.dev, g_disp.band.buf, g_disp.band.len, cmd->x, cmd->y, img);
+            break;
+        case DISPLAY_CMD_TEXT:
+            ret = lcd_draw_string(g_disp.dev, g_disp.band.buf, g_disp.band.len, cmd->x, cmd->y,
+                                  cmd->text, cmd->scale, cmd->fg, cmd->bg);
+            break;
+        case DISPLAY_CMD_BACKLIGHT:
+            ret = wm_drv_tft_lcd_set_backlight(g_disp.dev, cmd->on);
+            break;
+        default:
+            break;
+    }
+
+    if (ret != WM_ERR_SUCCESS) {
+        wm_log_error("cmd %d ret=%d", cmd->type, ret);
+    }
+
+    g_disp.drawn++;
+}
+
+static void display_task(void *param)
+{
+    static display_cmd_t pending[DISPLAY_QUEUE_LEN];
+    wm_lcd_capabilitys_t cap = { 0 };
+    int count;
+
+    /* the band buffer is kept for the life of the task, draws never wait on the allocator */
+    wm_drv_tft_lcd_get_capability(g_disp.dev, &cap);
+    if (lcd_band_alloc(&g_disp.band, cap.x_resolution * WM_CFG_TFT_LCD_PIXEL_WIDTH, cap.y_resolution, 0) != WM_ERR_SUCCESS) {
+        wm_log_error("mem err, draw commands will fail");
+    }
+
+    while (1) {
+        if (xQueueReceive(g_disp.queue, &pending[0], portMAX_DELAY) != pdTRUE)
+            continue;
+
+        /* take everything queued so far, a later command may make an earlier one pointless */
+        count = 1;
+        while ((count < DISPLAY_QUEUE_LEN) && (xQueueReceive(g_disp.queue, &pending[count], 0) == pdTRUE))
+            count++;
+
+        xSemaphoreTake(g_disp.mutex, portMAX_DELAY);
+
+        for (int i = 0; i < count; i++) {
+            bool superseded = false;
+
+            for (int j = i + 1; j < count; j++) {
+                if (display_covers(&pending[j], &pending[i])) {
+                    superseded = true;
+                    break;
+                }
+            }
+
+            if (superseded) {
+                g_disp.coalesced++;
+                continue;
+            }
+
+            display_execute(&pending[i]);
+        }
+
+        xSemaphoreGive(g_disp.mutex);
+    }
+}
+
+/* the first draw can come from several tasks at once, the mutex is installed once and the task created under it */
+static int display_start(void)
+{
+    SemaphoreHandle_t mutex;
+    int ret = WM_ERR_SUCCESS;
+
+    if (g_disp.task)
+        return WM_ERR_SUCCESS;
+
+    if (!g_disp.mutex) {
+        mutex = xSemaphoreCreateMutex();
+        if (!mutex)
+            return WM_ERR_NO_MEM;
+
+        taskENTER_CRITICAL();
+        if (!g_disp.mutex) {
+            g_disp.mutex = mutex;
+            mutex        = NULL;
+        }
+        taskEXIT_CRITICAL();
+
+        if (mutex)
+            vSemaphoreDelete(mutex);
+    }
+
+    xSemaphoreTake(g_disp.mutex, portMAX_DELAY);
+
+    if (g_disp.task)
+        goto out;
+
+    g_disp.dev = lcd_get_device();
+    if (!g_disp.dev) {
+        ret = WM_ERR_FAILED;
+        goto out;
+    }
+
+    g_disp.queue = xQueueCreate(DISPLAY_QUEUE_LEN, sizeof(display_cmd_t));
+    if (!g_disp.queue) {
+        ret = WM_ERR_NO_MEM;
+        goto out;
+    }
+
+    if (pdPASS != xTaskCreate(display_task, "display", DISPLAY_TASK_STACK, NULL, DISPLAY_TASK_PRIO, &g_disp.task)) {
+        vQueueDelete(g_disp.queue);
+        g_disp.queue = NULL;
+        g_disp.task  = NULL;
+        ret          = WM_ERR_NO_MEM;
+    }
+
+out:
+    xSemaphoreGive(g_disp.mutex);
+
+    return ret;
+}
+
+static int display_post(const display_cmd_t *cmd)
+{
+    int ret = display_start();
+
+    if (ret != WM_ERR_SUCCESS)
+        return ret;
+
+    if (xQueueSend(g_disp.queue, cmd, 0) != pdTRUE) {
+        g_disp.dropped++;
+        return WM_ERR_FAILED;
+    }
+
+    g_disp.queued++;
+
+    return WM_ERR_SUCCESS;
+}
+
+int display_fill(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color)
+{
+    display_cmd_t cmd = { 0 };
+
+    cmd.type = DISPLAY_CMD_FILL;
+    cmd.x    = x;
+    cmd.y    = y;
+    cmd.w    = w;
+    cmd.h    = h;
+    cmd.fg   = color;
+
+    return display_post(&cmd);
+}
+
+int display_fill_screen(uint16_t color)
+{
+    wm_lcd_capabilitys_t cap = { 0 };
+    int ret = display_start();
+
+    if (ret != WM_ERR_SUCCESS)
+        return ret;
+
+    wm_drv_tft_lcd_get_capability(g_disp.dev, &cap);
+
+    return display_fill(0, 0, cap.x_resolution, cap.y_resolution, color);
+}
+
+int display_image(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint8_t *data)
+{
+    display_cmd_t cmd = { 0 };
+
+    if (!data)
+        return WM_ERR_INVALID_PARAM;
+
+    cmd.type = DISPLAY_CMD_IMAGE;
+    cmd.x    = x;
+    cmd.y    = y;
+    cmd.w    = w;
+    cmd.h    = h;
+    cmd.data = data;
+
+    return display_post(&cmd);
+}
+
+int display_text(uint16_t x, uint16_t y, const char *str, uint8_t scale, uint16_t fg, uint16_t bg)
+{
+    display_cmd_t cmd = { 0 };
+
+    if (!str || !scale)
+        return WM_ERR_INVALID_PARAM;
+
+    cmd.type  = DISPLAY_CMD_TEXT;
+    cmd.x     = x;
+    cmd.y     = y;
+    cmd.scale = scale;
+    cmd.fg    = fg;
+    cmd.bg    = bg;
+    strncpy(cmd.text, str, DISPLAY_TEXT_MAX);
+    cmd.w     = strlen(cmd.text) * LCD_CHAR_WIDTH * scale;
+    cmd.h     = LCD_CHAR_HEIGHT * scale;
+
+    return display_post(&cmd);
+}
+
+int display_backlight(bool on)
+{
+    display_cmd_t cmd = { 0 };
+
+    cmd.type = DISPLAY_CMD_BACKLIGHT;
+    cmd.on   = on;
+
+    return display_post(&cmd);
+}
+
+void display_lock(void)
+{
+    /* start the service so the lock exists before anyone draws directly, it is paired with the unlock
+     * whenever it exists, even when the lcd could not be opened */
+    display_start();
+    if (g_disp.mutex)
+        xSemaphoreTake(g_disp.mutex, portMAX_DELAY);
+}
+
+void display_unlock(void)
+{
+    if (g_disp.mutex)
+        xSemaphoreGive(g_disp.mutex);
+}
+
+static void cmd_display(int argc, char *argv[])
+{
+    wm_cli_printf("queued %u, dropped %u, coalesced %u, drawn %u, band %u lines in %s\r\n",
+                  g_disp.queued, g_disp.dropped, g_disp.coalesced, g_disp.drawn,
+                  g_disp.band.lines, g_disp.band.psram ? "psram" : "sram");
+}
+WM_CLI_CMD_DEFINE(display, cmd_display, display cmd, display -- show display service statistics);
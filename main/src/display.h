@@ -0,0 +1,32 @@
+#ifndef __DISPLAY_H__
+#define __DISPLAY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DISPLAY_TEXT_MAX               32
+
+/*
+ * Display service: one task owns the lcd and a persistent band buffer, the functions below
+ * only queue a command and return. The service is started by the first command.
+ * Image data is not copied, it must stay valid until drawn (flash assets, static buffers).
+ */
+int display_fill(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color);
+int display_fill_screen(uint16_t color);
+int display_image(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint8_t *data);
+int display_text(uint16_t x, uint16_t y, const char *str, uint8_t scale, uint16_t fg, uint16_t bg);
+int display_backlight(bool on);
+
+/* exclusive access to the lcd for code that drives it directly, e.g. streaming or benchmarks */
+void display_lock(void);
+void display_unlock(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DISPLAY_H__ */
@@ -0,0 +1,495 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wmsdk_config.h"
+#include "wm_drv_eeprom.h"
+#include "wm_cli.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "i2c_bus.h"
+#include "eecache.h"
+
+#define LOG_TAG "eecache"
+#include "wm_log.h"
+
+#define EECACHE_NONE                   0xFFFF
+
+/* the top of the lower half, clear of the settings at its start and of eelog */
+#define EECACHE_BENCH_ADDR             (16384 - EECACHE_BENCH_PAGES * EECACHE_PAGE_SIZE)
+#define EECACHE_BENCH_PAGES            16
+#define EECACHE_BENCH_LOAD             4096
+#define EECACHE_BENCH_READS            1000
+
+#define EECACHE_POLL_TICKS             1
+
+#define NOW_MS()                       (xTaskGetTickCount() * portTICK_PERIOD_MS)
+
+typedef struct {
+    uint16_t page;                     /**< EECACHE_NONE when the line is free */
+    bool dirty;
+    uint32_t used;                     /**< lru clock at the last access */
+    uint8_t data[EECACHE_PAGE_SIZE];
+} eecache_line_t;
+
+static struct {
+    bool opened;
+    SemaphoreHandle_t lock;
+
+    bool busy;                         /**< a write cycle may still be running */
+    uint32_t write_ms;                 /**< when it started */
+
+    uint32_t clock;
+    eecache_line_t line[EECACHE_PAGES];
+
+    eecache_stat_t stat;
+} g_eecache = { 0 };
+
+static void eecache_addr(uint32_t addr, uint8_t *buf)
+{
+    buf[0] = (uint8_t)(addr >> 8);
+    buf[1] = (uint8_t)(addr & 0xFF);
+}
+
+/*
+ * the eeprom does not acknowledge its address during a write cycle, so poll it until it does;
+ * a write of the address alone is the poll, and leaves nothing behind
+ */
+static int eecache_wait_ready(void)
+{
+    uint8_t addr[2] = { 0, 0 };
+    uint32_t ms;
+
+    if (!g_eecache.busy)
+        return WM_ERR_SUCCESS;
+
+    while (WM_ERR_SUCCESS != i2c_bus_write(EECACHE_I2C_ADDR, EECACHE_SPEED_HZ, addr, sizeof(addr), NULL, 0)) {
+        g_eecache.stat.polls++;
+        if (NOW_MS() - g_eecache.write_ms > EECACHE_WRITE_TIMEOUT_MS) {
+            g_eecache.stat.timeouts++;
+            g_eecache.busy = false;
+            return WM_ERR_TIMEOUT;
+        }
+        /* a write cycle is milliseconds, a tick between polls keeps the bus and the cpu for the others */
+        vTaskDelay(EECACHE_POLL_TICKS);
+    }
+
+    ms = NOW_MS() - g_eecache.write_ms;
+    if (ms > g_eecache.stat.write_ms_max)
+        g_eecache.stat.write_ms_max = ms;
+    g_eecache.stat.write_ms_sum += ms;
+    g_eecache.busy = false;
+
+    return WM_ERR_SUCCESS;
+}
+
+/* one sequential read, the eeprom carries on across page boundaries by itself */
+static int eecache_bus_read(uint32_t addr, uint8_t *buf, uint32_t len)
+{
+    uint8_t sub[2];
+    int ret;
+
+    ret = eecache_wait_ready();
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    eecache_addr(addr, sub);
+    ret = i2c_bus_read(EECACHE_I2C_ADDR, EECACHE_SPEED_HZ, sub, sizeof(sub), buf, len);
+    if (WM_ERR_SUCCESS == ret) {
+        g_eecache.stat.bus_reads++;
+        g_eecache.stat.bus_read_bytes += len;
+    }
+
+    return ret;
+}
+
+/* start the write cycle of a page and return, the next transaction waits for it */
+static int eecache_bus_write(uint32_t page, const uint8_t *data)
+{
+    uint8_t sub[2];
+    int ret;
+
+    ret = eecache_wait_ready();
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    eecache_addr(page * EECACHE_PAGE_SIZE, sub);
+    ret = i2c_bus_write(EECACHE_I2C_ADDR, EECACHE_SPEED_HZ, sub, sizeof(sub), data, EECACHE_PAGE_SIZE);
+    if (WM_ERR_SUCCESS == ret) {
+        g_eecache.busy     = true;
+        g_eecache.write_ms = NOW_MS();
+        g_eecache.stat.page_writes++;
+    }
+
+    return ret;
+}
+
+static eecache_line_t *eecache_find(uint32_t page)
+{
+    for (int i = 0; i < EECACHE_PAGES; i++) {
+        if (g_eecache.line[i].page == page) {
+            g_eecache.line[i].used = ++g_eecache.clock;
+            return &g_eecache.line[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* the least recently used line, written back first when dirty */
+static int eecache_evict(eecache_line_t **line)
+{
+    eecache_line_t *lru = &g_eecache.line[0];
+    int ret;
+
+    for (int i = 1; i < EECACHE_PAGES; i++) {
+        if ((EECACHE_NONE == g_eecache.line[i].page) ||
+            ((EECACHE_NONE != lru->page) && (g_eecache.line[i].used < lru->used)))
+            lru = &g_eecache.line[i];
+    }
+
+    if ((EECACHE_NONE != lru->page) && lru->dirty) {
+        ret = eecache_bus_write(lru->page, lru->data);
+        if (WM_ERR_SUCCESS != ret)
+            return ret;
+        g_eecache.stat.evictions++;
+    }
+
+    lru->page  = EECACHE_NONE;
+    lru->dirty = false;
+    lru->used  = ++g_eecache.clock;
+    *line      = lru;
+
+    return WM_ERR_SUCCESS;
+}
+
+static int eecache_lock_init(void)
+{
+    SemaphoreHandle_t lock;
+
+    if (g_eecache.lock)
+        return WM_ERR_SUCCESS;
+
+    lock = xSemaphoreCreateMutex();
+    if (!lock)
+        return WM_ERR_NO_MEM;
+
+    taskENTER_CRITICAL();
+    if (!g_eecache.lock) {
+        g_eecache.lock = lock;
+        lock           = NULL;
+    }
+    taskEXIT_CRITICAL();
+
+    if (lock)
+        vSemaphoreDelete(lock);
+
+    return WM_ERR_SUCCESS;
+}
+
+int eecache_open(void)
+{
+    int ret;
+
+    if (g_eecache.opened)
+        return WM_ERR_SUCCESS;
+
+    ret = eecache_lock_init();
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    ret = i2c_bus_start();
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    xSemaphoreTake(g_eecache.lock, portMAX_DELAY);
+
+    /* another task may have opened it meanwhile, its lines must not be dropped */
+    if (!g_eecache.opened) {
+        for (int i = 0; i < EECACHE_PAGES; i++)
+            g_eecache.line[i].page = EECACHE_NONE;
+
+        g_eecache.opened = true;
+    }
+
+    xSemaphoreGive(g_eecache.lock);
+
+    return WM_ERR_SUCCESS;
+}
+
+int eecache_read(uint32_t addr, void *buf, uint32_t len)
+{
+    uint8_t *out = buf;
+    eecache_line_t *line;
+    uint32_t page;
+    uint32_t offset;
+    uint32_t n;
+    uint32_t run;
+    int ret;
+
+    if (!buf || (addr + len > EECACHE_SIZE) || (addr + len < addr))
+        return WM_ERR_INVALID_PARAM;
+
+    ret = eecache_open();
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    xSemaphoreTake(g_eecache.lock, portMAX_DELAY);
+
+    while ((WM_ERR_SUCCESS == ret) && len) {
+        page   = addr / EECACHE_PAGE_SIZE;
+        offset = addr % EECACHE_PAGE_SIZE;
+        n      = EECACHE_PAGE_SIZE - offset;
+        if (n > len)
+            n = len;
+
+        line = eecache_find(page);
+        if (!line && (len < EECACHE_PAGE_SIZE) && (offset + len <= EECACHE_PAGE_SIZE)) {
+            /* a read of part of a page keeps the page for the next one */
+            g_eecache.stat.misses++;
+            ret = eecache_evict(&line);
+            if (WM_ERR_SUCCESS == ret)
+                ret = eecache_bus_read(page * EECACHE_PAGE_SIZE, line->data, EECACHE_PAGE_SIZE);
+            if (WM_ERR_SUCCESS != ret)
+                break;
+            line->page = page;
+        } else if (line) {
+            g_eecache.stat.hits++;
+        }
+
+        if (line) {
+            memcpy(out, &line->data[offset], n);
+        } else {
+            /* the run of pages up to the next cached one in one transaction */
+            run = n;
+            while ((run < len) && !eecache_find((addr + run) / EECACHE_PAGE_SIZE)) {
+                run += (len - run > EECACHE_PAGE_SIZE) ? EECACHE_PAGE_SIZE : len - run;
+                g_eecache.stat.misses++;
+            }
+            g_eecache.stat.misses++;
+
+            ret = eecache_bus_read(addr, out, run);
+            n   = run;
+        }
+
+        addr += n;
+        out  += n;
+        len  -= n;
+    }
+
+    xSemaphoreGive(g_eecache.lock);
+
+    return ret;
+}
+
+int eecache_write(uint32_t addr, const void *buf, uint32_t len)
+{
+    const uint8_t *in = buf;
+    eecache_line_t *line;
+    uint32_t page;
+    uint32_t offset;
+    uint32_t n;
+    int ret;
+
+    if (!buf || (addr + len > EECACHE_SIZE) || (addr + len < addr))
+        return WM_ERR_INVALID_PARAM;
+
+    ret = eecache_open();
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    xSemaphoreTake(g_eecache.lock, portMAX_DELAY);
+
+    while ((WM_ERR_SUCCESS == ret) && len) {
+        page   = addr / EECACHE_PAGE_SIZE;
+        offset = addr % EECACHE_PAGE_SIZE;
+        n      = EECACHE_PAGE_SIZE - offset;
+        if (n > len)
+            n = len;
+
+        line = eecache_find(page);
+        if (line) {
+            g_eecache.stat.hits++;
+        } else {
+            g_eecache.stat.misses++;
+            ret = eecache_evict(&line);
+            /* a whole page is overwritten, only a part of one needs the rest from the eeprom */
+            if ((WM_ERR_SUCCESS == ret) && (EECACHE_PAGE_SIZE != n))
+                ret = eecache_bus_read(page * EECACHE_PAGE_SIZE, line->data, EECACHE_PAGE_SIZE);
+            if (WM_ERR_SUCCESS != ret)
+                break;
+            line->page = page;
+        }
+
+        memcpy(&line->data[offset], in, n);
+        line->dirty = true;
+
+        addr += n;
+        in   += n;
+        len  -= n;
+    }
+
+    xSemaphoreGive(g_eecache.lock);
+
+    return ret;
+}
+
+int eecache_flush(void)
+{
+    eecache_line_t *next;
+    int ret = WM_ERR_SUCCESS;
+
+    if (!g_eecache.opened)
+        return WM_ERR_SUCCESS;
+
+    xSemaphoreTake(g_eecache.lock, portMAX_DELAY);
+
+    /* in address order, as they would have been written without the cache */
+    while (WM_ERR_SUCCESS == ret) {
+        next = NULL;
+        for (int i = 0; i < EECACHE_PAGES; i++) {
+            if (g_eecache.line[i].dirty && (!next || (g_eecache.line[i].page < next->page)))
+                next = &g_eecache.line[i];
+        }
+        if (!next)
+            break;
+
+        ret = eecache_bus_write(next->page, next->data);
+        if (WM_ERR_SUCCESS == ret)
+            next->dirty = false;
+    }
+
+    if (WM_ERR_SUCCESS == ret)
+        ret = eecache_wait_ready();
+
+    xSemaphoreGive(g_eecache.lock);
+
+    return ret;
+}
+
+int eecache_get_stat(eecache_stat_t *stat)
+{
+    if (!stat)
+        return WM_ERR_INVALID_PARAM;
+
+    if (!g_eecache.opened)
+        return WM_ERR_NO_INITED;
+
+    xSemaphoreTake(g_eecache.lock, portMAX_DELAY);
+    *stat = g_eecache.stat;
+    xSemaphoreGive(g_eecache.lock);
+
+    return WM_ERR_SUCCESS;
+}
+
+/* write back and forget every page, so the bench starts from the eeprom */
+static int eecache_drop(void)
+{
+    int ret;
+
+    ret = eecache_flush();
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    xSemaphoreTake(g_eecache.lock, portMAX_DELAY);
+    for (int i = 0; i < EECACHE_PAGES; i++)
+        g_eecache.line[i].page = EECACHE_NONE;
+    xSemaphoreGive(g_eecache.lock);
+
+    return WM_ERR_SUCCESS;
+}
+
+static void eecache_bench(void)
+{
+    uint8_t *buf;
+    wm_device_t *dev;
+    uint32_t start;
+    uint32_t ms;
+    int ret;
+
+    buf = malloc(EECACHE_BENCH_LOAD);
+    if (!buf)
+        return;
+
+    dev = wm_dt_get_device_by_name("eeprom0");
+    if (!(dev && (WM_DEV_ST_INITED == dev->state)))
+        dev = wm_drv_eeprom_init("eeprom0");
+
+    ret = eecache_drop();
+    if (!dev || (WM_ERR_SUCCESS != ret)) {
+        wm_cli_printf("open failed\r\n");
+        free(buf);
+        return;
+    }
+
+    /* before: the eeprom driver, a fixed wait after every page, on the controller behind the bus task's back */
+    start = NOW_MS();
+    ret   = wm_drv_eeprom_read(dev, 0, buf, EECACHE_BENCH_LOAD);
+    wm_cli_printf("driver: load %u bytes in %u ms, ret=%d\r\n", EECACHE_BENCH_LOAD, NOW_MS() - start, ret);
+
+    start = NOW_MS();
+    for (uint32_t i = 0; (WM_ERR_SUCCESS == ret) && (i < EECACHE_BENCH_PAGES); i++)
+        ret = wm_drv_eeprom_write(dev, EECACHE_BENCH_ADDR + i * EECACHE_PAGE_SIZE, buf, EECACHE_PAGE_SIZE);
+    ms = NOW_MS() - start;
+    wm_cli_printf("driver: %u page writes in %u ms, %.2f ms each, ret=%d\r\n", EECACHE_BENCH_PAGES, ms,
+                  (float)ms / EECACHE_BENCH_PAGES, ret);
+
+    start = NOW_MS();
+    for (uint32_t i = 0; (WM_ERR_SUCCESS == ret) && (i < EECACHE_BENCH_READS); i++)
+        ret = wm_drv_eeprom_read(dev, EECACHE_BENCH_ADDR + (i % EECACHE_PAGES) * EECACHE_PAGE_SIZE, buf, 16);
+    wm_cli_printf("driver: %u reads of 16 bytes over %u pages in %u ms, ret=%d\r\n", EECACHE_BENCH_READS,
+                  EECACHE_PAGES, NOW_MS() - start, ret);
+
+    /* after: one sequential read, and page writes that end on the acknowledge */
+    eecache_drop();
+    memset(&g_eecache.stat, 0, sizeof(g_eecache.stat));
+
+    start = NOW_MS();
+    ret   = eecache_read(0, buf, EECACHE_BENCH_LOAD);
+    wm_cli_printf("cache: load %u bytes in %u ms with %u transactions, ret=%d\r\n", EECACHE_BENCH_LOAD,
+                  NOW_MS() - start, g_eecache.stat.bus_reads, ret);
+
+    start = NOW_MS();
+    for (uint32_t i = 0; (WM_ERR_SUCCESS == ret) && (i < EECACHE_BENCH_PAGES); i++) {
+        ret = eecache_write(EECACHE_BENCH_ADDR + i * EECACHE_PAGE_SIZE, buf, EECACHE_PAGE_SIZE);
+        if (WM_ERR_SUCCESS == ret)
+            ret = eecache_flush();
+    }
+    ms = NOW_MS() - start;
+    wm_cli_printf("cache: %u page writes in %u ms, %.2f ms each, %u polls, ret=%d\r\n", EECACHE_BENCH_PAGES, ms,
+                  (float)ms / EECACHE_BENCH_PAGES, g_eecache.stat.polls, ret);
+
+    start = NOW_MS();
+    for (uint32_t i = 0; (WM_ERR_SUCCESS == ret) && (i < EECACHE_BENCH_READS); i++)
+        ret = eecache_read(EECACHE_BENCH_ADDR + (i % EECACHE_PAGES) * EECACHE_PAGE_SIZE, buf, 16);
+    wm_cli_printf("cache: %u reads of 16 bytes over %u pages in %u ms, ret=%d\r\n", EECACHE_BENCH_READS,
+                  EECACHE_PAGES, NOW_MS() - start, ret);
+
+    free(buf);
+}
+
+static void cmd_eecache(int argc, char *argv[])
+{
+    eecache_stat_t stat;
+    int ret;
+
+    ret = eecache_open();
+    if (WM_ERR_SUCCESS != ret) {
+        wm_cli_printf("open ret=%d\r\n", ret);
+        return;
+    }
+
+    if ((argc > 1) && !strcmp("bench", argv[1])) {
+        eecache_bench();
+    } else if ((argc > 1) && !strcmp("flush", argv[1])) {
+        wm_cli_printf("flush ret=%d\r\n", eecache_flush());
+    } else {
+        eecache_get_stat(&stat);
+        wm_cli_printf("%u hits, %u misses, %u reads of %u bytes, %u page writes, %u write backs\r\n", stat.hits,
+                      stat.misses, stat.bus_reads, stat.bus_read_bytes, stat.page_writes, stat.evictions);
+        wm_cli_printf("write cycle %u ms max, %.2f ms average, %u polls, %u timeouts\r\n", stat.write_ms_max,
+                      stat.page_writes ? (float)stat.write_ms_sum / stat.page_writes : 0.0f, stat.polls,
+                      stat.timeouts);
+    }
+}
+WM_CLI_CMD_DEFINE(eecache, cmd_eecache, eecache cmd, eecache [flush | bench] -- eeprom page cache);
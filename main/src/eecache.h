@@ -0,0 +1,61 @@
+#ifndef __EECACHE_H__
+#define __EECACHE_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Write back page cache in front of the at24c256, talking to it over i2c through the bus task.
+ *
+ * Writes land in a cached page and reach the eeprom when the page is evicted or on eecache_flush.
+ * A page write does not sleep the worst case write time: the next transaction first polls the
+ * device address until the eeprom acknowledges again, so the write cycle overlaps whatever the
+ * caller does in between. Reads of cached pages do not touch the bus; a read of pages not cached
+ * is one sequential read however many pages it spans. Only reads of part of a page fill the cache,
+ * so a bulk load, or a reader of whole pages keeping its own copy, does not push out the pages in use.
+ *
+ * Everything reaching eeprom0 must go through here, or the cache goes stale.
+ */
+
+/* as eeprom0 in device_table.toml */
+#define EECACHE_I2C_ADDR               0x50
+#define EECACHE_SPEED_HZ               400000
+#define EECACHE_SIZE                   32768
+#define EECACHE_PAGE_SIZE              64
+
+#define EECACHE_PAGES                  8
+
+/* a write cycle is 5 ms at most, give up polling well after */
+#define EECACHE_WRITE_TIMEOUT_MS       20
+
+typedef struct {
+    uint32_t hits;                     /**< pages read or written in the cache */
+    uint32_t misses;
+    uint32_t bus_reads;                /**< sequential read transactions */
+    uint32_t bus_read_bytes;
+    uint32_t page_writes;
+    uint32_t evictions;                /**< of dirty pages, written back */
+    uint32_t polls;                    /**< address polls not acknowledged */
+    uint32_t write_ms_max;             /**< from a page write to its acknowledge */
+    uint32_t write_ms_sum;
+    uint32_t timeouts;
+} eecache_stat_t;
+
+int eecache_open(void);
+
+int eecache_read(uint32_t addr, void *buf, uint32_t len);
+int eecache_write(uint32_t addr, const void *buf, uint32_t len);
+
+/* write every dirty page and wait for the last to complete */
+int eecache_flush(void);
+
+int eecache_get_stat(eecache_stat_t *stat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __EECACHE_H__ */
@@ -0,0 +1,754 @@
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wmsdk_config.h"
+#include "wm_cli.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "crc.h"
+#include "eecache.h"
+#include "eekv.h"
+
+#define LOG_TAG "eekv"
+#include "wm_log.h"
+
+#define EEKV_MAGIC                     0x564B4545 /* "EEKV" */
+#define EEKV_HEADER_SIZE               8
+#define EEKV_RECORD_HEADER_SIZE        4
+#define EEKV_RECORD_MAX                (EEKV_RECORD_HEADER_SIZE + EEKV_KEY_MAX + EEKV_VALUE_MAX)
+
+/* key length of space never written, value length of a deleted key */
+#define EEKV_ERASED                    0xFF
+#define EEKV_DELETED                   0xFF
+
+#define EEKV_INDEX_SLOTS               128
+
+#define EEKV_BENCH_KEYS                64
+#define EEKV_BENCH_VALUE               32
+#define EEKV_BENCH_GETS                200
+
+#define NOW_MS()                       (xTaskGetTickCount() * portTICK_PERIOD_MS)
+
+typedef struct {
+    uint32_t magic;
+    uint16_t generation;
+    uint16_t crc;                      /**< crc16 of the fields before */
+} eekv_bank_header_t;
+
+typedef struct {
+    uint8_t key_len;
+    uint8_t value_len;                 /**< EEKV_DELETED for a deleted key */
+    uint16_t crc;                      /**< crc16 of the lengths, the key and the value */
+} eekv_record_header_t;
+
+/* linear probing, deletes shift the rest of the cluster back so there are no tombstones */
+typedef struct {
+    uint16_t offset;                   /**< of the newest record of the key in the live bank, 0 when free */
+    uint16_t tag;                      /**< upper half of the key hash */
+    uint8_t size;                      /**< of the record */
+    uint8_t home;                      /**< slot the key hashes to */
+} eekv_slot_t;
+
+static struct {
+    bool opened;
+    SemaphoreHandle_t lock;
+
+    uint32_t bank;                     /**< the live one */
+    uint16_t generation;
+    uint32_t end;                      /**< where the next record goes in it */
+
+    eekv_slot_t slot[EEKV_INDEX_SLOTS];
+    eekv_stat_t stat;
+} g_eekv = { 0 };
+
+static uint32_t eekv_hash(const char *key, uint32_t len)
+{
+    uint32_t h = 2166136261u;
+
+    while (len--) {
+        h ^= (uint8_t)*key++;
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+static uint32_t eekv_bank_addr(uint32_t bank)
+{
+    return EEKV_START + bank * EEKV_BANK_SIZE;
+}
+
+static uint32_t eekv_record_size(const eekv_record_header_t *hdr)
+{
+    return EEKV_RECORD_HEADER_SIZE + hdr->key_len + ((EEKV_DELETED == hdr->value_len) ? 0 : hdr->value_len);
+}
+
+/* records sit at any byte offset in a bank, the header is copied out rather than read in place */
+static void eekv_record_header(const uint8_t *record, eekv_record_header_t *hdr)
+{
+    memcpy(hdr, record, sizeof(*hdr));
+}
+
+static uint16_t eekv_record_crc(const uint8_t *record)
+{
+    eekv_record_header_t hdr;
+    uint16_t crc = crc16(CRC16_INIT, record, 2);
+
+    eekv_record_header(record, &hdr);
+
+    return crc16(crc, record + EEKV_RECORD_HEADER_SIZE, eekv_record_size(&hdr) - EEKV_RECORD_HEADER_SIZE);
+}
+
+/* a good record of a plausible size at the start of record, at most max bytes long */
+static bool eekv_record_valid(const uint8_t *record, uint32_t max)
+{
+    eekv_record_header_t hdr;
+
+    if (max < EEKV_RECORD_HEADER_SIZE)
+        return false;
+
+    eekv_record_header(record, &hdr);
+    if (!hdr.key_len || (hdr.key_len > EEKV_KEY_MAX) ||
+        ((hdr.value_len > EEKV_VALUE_MAX) && (EEKV_DELETED != hdr.value_len)))
+        return false;
+
+    return (eekv_record_size(&hdr) <= max) && (hdr.crc == eekv_record_crc(record));
+}
+
+static uint16_t eekv_bank_crc(const eekv_bank_header_t *hdr)
+{
+    return crc16(CRC16_INIT, hdr, offsetof(eekv_bank_header_t, crc));
+}
+
+/*
+ * the slot of key, -1 when it has none; the candidate records are read from image when there is
+ * one, the live bank as read at open, else from the eeprom into record
+ */
+static int eekv_lookup(const char *key, uint32_t key_len, uint32_t hash, const uint8_t *image, uint8_t *record)
+{
+    eekv_record_header_t hdr;
+    eekv_slot_t *slot;
+    uint32_t i = hash % EEKV_INDEX_SLOTS;
+
+    for (uint32_t n = 0; (n < EEKV_INDEX_SLOTS) && g_eekv.slot[i].offset; n++, i = (i + 1) % EEKV_INDEX_SLOTS) {
+        slot = &g_eekv.slot[i];
+        if (slot->tag != (uint16_t)(hash >> 16))
+            continue;
+
+        if (image) {
+            memcpy(record, image + slot->offset, slot->size);
+        } else {
+            g_eekv.stat.get_reads++;
+            if (WM_ERR_SUCCESS != eecache_read(eekv_bank_addr(g_eekv.bank) + slot->offset, record, slot->size))
+                continue;
+        }
+
+        if (!eekv_record_valid(record, slot->size))
+            continue;
+
+        eekv_record_header(record, &hdr);
+        if ((hdr.key_len == key_len) && !memcmp(record + EEKV_RECORD_HEADER_SIZE, key, key_len))
+            return i;
+    }
+
+    return -1;
+}
+
+static void eekv_index_remove(uint32_t i)
+{
+    uint32_t j = i;
+    uint32_t k;
+
+    g_eekv.slot[i].offset = 0;
+
+    for (;;) {
+        j = (j + 1) % EEKV_INDEX_SLOTS;
+        if (!g_eekv.slot[j].offset)
+            return;
+
+        /* the entry at j may move back to i unless its home lies cyclically in (i, j] */
+        k = g_eekv.slot[j].home;
+        if ((i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j)))
+            continue;
+
+        g_eekv.slot[i]        = g_eekv.slot[j];
+        g_eekv.slot[j].offset = 0;
+        i                     = j;
+    }
+}
+
+/* point slot i, or a new one when i < 0, at the record at offset, or drop the key when the record deletes it */
+static int eekv_index_set(int i, uint32_t hash, const uint8_t *record, uint32_t offset)
+{
+    eekv_record_header_t hdr;
+
+    eekv_record_header(record, &hdr);
+    if (EEKV_DELETED == hdr.value_len) {
+        if (i >= 0) {
+            g_eekv.stat.live -= g_eekv.slot[i].size;
+            eekv_index_remove(i);
+            g_eekv.stat.keys--;
+        }
+        return WM_ERR_SUCCESS;
+    }
+
+    if (i < 0) {
+        if (g_eekv.stat.keys >= EEKV_MAX_KEYS)
+            return WM_ERR_NO_MEM;
+
+        i = hash % EEKV_INDEX_SLOTS;
+        while (g_eekv.slot[i].offset)
+            i = (i + 1) % EEKV_INDEX_SLOTS;
+
+        g_eekv.slot[i].tag  = (uint16_t)(hash >> 16);
+        g_eekv.slot[i].home = (uint8_t)(hash % EEKV_INDEX_SLOTS);
+        g_eekv.stat.keys++;
+    } else {
+        g_eekv.stat.live -= g_eekv.slot[i].size;
+    }
+
+    g_eekv.slot[i].offset = (uint16_t)offset;
+    g_eekv.slot[i].size   = (uint8_t)eekv_record_size(&hdr);
+    g_eekv.stat.live     += g_eekv.slot[i].size;
+
+    return WM_ERR_SUCCESS;
+}
+
+static void eekv_reset_index(void)
+{
+    memset(g_eekv.slot, 0, sizeof(g_eekv.slot));
+    g_eekv.stat.keys = 0;
+    g_eekv.stat.live = 0;
+}
+
+/* the bank image with its header, written header last so it only goes live when complete */
+static int eekv_write_bank(uint32_t bank, uint8_t *image, uint16_t generation)
+{
+    eekv_bank_header_t *hdr = (eekv_bank_header_t *)image;
+    int ret;
+
+    ret = eecache_write(eekv_bank_addr(bank) + EEKV_HEADER_SIZE, image + EEKV_HEADER_SIZE,
+                        EEKV_BANK_SIZE - EEKV_HEADER_SIZE);
+    if (WM_ERR_SUCCESS == ret)
+        ret = eecache_flush();
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    hdr->magic      = EEKV_MAGIC;
+    hdr->generation = generation;
+    hdr->crc        = eekv_bank_crc(hdr);
+
+    ret = eecache_write(eekv_bank_addr(bank), image, EEKV_HEADER_SIZE);
+    if (WM_ERR_SUCCESS == ret)
+        ret = eecache_flush();
+
+    return ret;
+}
+
+static int eekv_do_format(void)
+{
+    eekv_bank_header_t hdr;
+    uint8_t *image;
+    int ret;
+
+    image = malloc(EEKV_BANK_SIZE);
+    if (!image)
+        return WM_ERR_NO_MEM;
+
+    memset(image, EEKV_ERASED, EEKV_BANK_SIZE);
+    ret = eekv_write_bank(0, image, 0);
+    free(image);
+
+    /* the other bank must not win over it */
+    memset(&hdr, EEKV_ERASED, sizeof(hdr));
+    if (WM_ERR_SUCCESS == ret)
+        ret = eecache_write(eekv_bank_addr(1), &hdr, sizeof(hdr));
+    if (WM_ERR_SUCCESS == ret)
+        ret = eecache_flush();
+
+    if (WM_ERR_SUCCESS == ret) {
+        eekv_reset_index();
+        g_eekv.bank       = 0;
+        g_eekv.generation = 0;
+        g_eekv.end        = EEKV_HEADER_SIZE;
+    }
+
+    return ret;
+}
+
+/* the live bank in one read, its records replayed into the index */
+static int eekv_scan(void)
+{
+    eekv_bank_header_t hdr[EEKV_BANKS];
+    eekv_record_header_t rec;
+    uint8_t record[EEKV_RECORD_MAX];
+    uint8_t *image;
+    const char *key;
+    bool valid[EEKV_BANKS];
+    uint32_t hash;
+    uint32_t end;
+    int ret;
+
+    for (uint32_t b = 0; b < EEKV_BANKS; b++) {
+        ret = eecache_read(eekv_bank_addr(b), &hdr[b], sizeof(hdr[b]));
+        if (WM_ERR_SUCCESS != ret)
+            return ret;
+        valid[b] = (EEKV_MAGIC == hdr[b].magic) && (hdr[b].crc == eekv_bank_crc(&hdr[b]));
+    }
+
+    if (!valid[0] && !valid[1]) {
+        wm_log_info("no store, formatting");
+        return eekv_do_format();
+    }
+
+    /* generations wrap, the newer is the one a little ahead */
+    g_eekv.bank = (valid[1] && (!valid[0] || ((int16_t)(hdr[1].generation - hdr[0].generation) > 0))) ? 1 : 0;
+    g_eekv.generation = hdr[g_eekv.bank].generation;
+
+    image = malloc(EEKV_BANK_SIZE);
+    if (!image)
+        return WM_ERR_NO_MEM;
+
+    ret = eecache_read(eekv_bank_addr(g_eekv.bank), image, EEKV_BANK_SIZE);
+    if (WM_ERR_SUCCESS != ret) {
+        free(image);
+        return ret;
+    }
+
+    /* up to space never written or a record torn by a reset, the next put goes over it */
+    eekv_reset_index();
+    end = EEKV_HEADER_SIZE;
+    while (end + EEKV_RECORD_HEADER_SIZE <= EEKV_BANK_SIZE) {
+        eekv_record_header(image + end, &rec);
+        if ((EEKV_ERASED == rec.key_len) || !eekv_record_valid(image + end, EEKV_BANK_SIZE - end))
+            break;
+
+        key  = (const char *)image + end + EEKV_RECORD_HEADER_SIZE;
+        hash = eekv_hash(key, rec.key_len);
+        if (WM_ERR_SUCCESS != eekv_index_set(eekv_lookup(key, rec.key_len, hash, image, record), hash, image + end, end))
+            wm_log_warn("index full at %u", end);
+        end += eekv_record_size(&rec);
+    }
+
+    g_eekv.end = end;
+    free(image);
+
+    return WM_ERR_SUCCESS;
+}
+
+static int eekv_do_compact(void)
+{
+    eekv_slot_t slot[EEKV_INDEX_SLOTS];
+    uint32_t bank = g_eekv.bank ^ 1;
+    uint32_t end  = EEKV_HEADER_SIZE;
+    uint8_t *image;
+    int ret = WM_ERR_SUCCESS;
+
+    image = malloc(EEKV_BANK_SIZE);
+    if (!image)
+        return WM_ERR_NO_MEM;
+
+    /* the newest record of every key, packed; what is left stays erased */
+    memset(image, EEKV_ERASED, EEKV_BANK_SIZE);
+    memcpy(slot, g_eekv.slot, sizeof(slot));
+    for (uint32_t i = 0; (WM_ERR_SUCCESS == ret) && (i < EEKV_INDEX_SLOTS); i++) {
+        if (!slot[i].offset)
+            continue;
+
+        ret            = eecache_read(eekv_bank_addr(g_eekv.bank) + slot[i].offset, image + end, slot[i].size);
+        slot[i].offset = (uint16_t)end;
+        end           += slot[i].size;
+    }
+
+    if (WM_ERR_SUCCESS == ret)
+        ret = eekv_write_bank(bank, image, g_eekv.generation + 1);
+    free(image);
+
+    if (WM_ERR_SUCCESS != ret) {
+        wm_log_error("compact ret=%d", ret);
+        return ret;
+    }
+
+    memcpy(g_eekv.slot, slot, sizeof(slot));
+    g_eekv.bank = bank;
+    g_eekv.generation++;
+    g_eekv.end = end;
+    g_eekv.stat.compactions++;
+
+    return WM_ERR_SUCCESS;
+}
+
+/* append a record, compacting first when it does not fit; a NULL value deletes the key */
+static int eekv_append(const char *key, uint32_t key_len, const void *value, uint32_t value_len)
+{
+    uint8_t record[EEKV_RECORD_MAX];
+    uint8_t old[EEKV_RECORD_MAX];
+    eekv_record_header_t hdr;
+    uint32_t hash = eekv_hash(key, key_len);
+    uint32_t size;
+    int ret;
+    int i;
+
+    /* the slot stays put through a compaction, only the offsets in it change */
+    i = eekv_lookup(key, key_len, hash, NULL, old);
+    if (!value && (i < 0))
+        return WM_ERR_FAILED;
+    if (value && (i < 0) && (g_eekv.stat.keys >= EEKV_MAX_KEYS))
+        return WM_ERR_NO_MEM;
+
+    hdr.key_len   = (uint8_t)key_len;
+    hdr.value_len = value ? (uint8_t)value_len : EEKV_DELETED;
+    hdr.crc       = 0;
+    memcpy(record, &hdr, sizeof(hdr));
+    memcpy(record + EEKV_RECORD_HEADER_SIZE, key, key_len);
+    if (value)
+        memcpy(record + EEKV_RECORD_HEADER_SIZE + key_len, value, value_len);
+    hdr.crc = eekv_record_crc(record);
+    memcpy(record, &hdr, sizeof(hdr));
+    size = eekv_record_size(&hdr);
+
+    if (g_eekv.end + size > EEKV_BANK_SIZE) {
+        ret = eekv_do_compact();
+        if (WM_ERR_SUCCESS != ret)
+            return ret;
+        if (g_eekv.end + size > EEKV_BANK_SIZE)
+            return WM_ERR_NO_MEM;
+    }
+
+    ret = eecache_write(eekv_bank_addr(g_eekv.bank) + g_eekv.end, record, size);
+    if (WM_ERR_SUCCESS == ret)
+        ret = eecache_flush();
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    ret = eekv_index_set(i, hash, record, g_eekv.end);
+    g_eekv.end += size;
+    g_eekv.stat.puts++;
+
+    return ret;
+}
+
+static int eekv_lock_init(void)
+{
+    SemaphoreHandle_t lock;
+
+    if (g_eekv.lock)
+        return WM_ERR_SUCCESS;
+
+    lock = xSemaphoreCreateMutex();
+    if (!lock)
+        return WM_ERR_NO_MEM;
+
+    taskENTER_CRITICAL();
+    if (!g_eekv.lock) {
+        g_eekv.lock = lock;
+        lock        = NULL;
+    }
+    taskEXIT_CRITICAL();
+
+    if (lock)
+        vSemaphoreDelete(lock);
+
+    return WM_ERR_SUCCESS;
+}
+
+int eekv_open(void)
+{
+    uint32_t start = NOW_MS();
+    int ret;
+
+    if (g_eekv.opened)
+        return WM_ERR_SUCCESS;
+
+    ret = eekv_lock_init();
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    ret = eecache_open();
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    xSemaphoreTake(g_eekv.lock, portMAX_DELAY);
+
+    if (g_eekv.opened) {
+        xSemaphoreGive(g_eekv.lock);
+        return WM_ERR_SUCCESS;
+    }
+
+    ret = eekv_scan();
+    if (WM_ERR_SUCCESS == ret) {
+        g_eekv.opened       = true;
+        g_eekv.stat.open_ms = NOW_MS() - start;
+    }
+
+    xSemaphoreGive(g_eekv.lock);
+
+    wm_log_debug("open bank %u generation %u, %u keys, %u bytes used, ret=%d", g_eekv.bank, g_eekv.generation,
+                 g_eekv.stat.keys, g_eekv.end, ret);
+
+    return ret;
+}
+
+int eekv_format(void)
+{
+    int ret;
+
+    ret = eekv_lock_init();
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    xSemaphoreTake(g_eekv.lock, portMAX_DELAY);
+    ret           = eekv_do_format();
+    g_eekv.opened = (WM_ERR_SUCCESS == ret);
+    xSemaphoreGive(g_eekv.lock);
+
+    return ret;
+}
+
+static uint32_t eekv_key_len(const char *key)
+{
+    uint32_t len = key ? strlen(key) : 0;
+
+    return (len <= EEKV_KEY_MAX) ? len : 0;
+}
+
+int eekv_get(const char *key, void *buf, uint32_t size, uint32_t *len)
+{
+    uint8_t record[EEKV_RECORD_MAX];
+    eekv_record_header_t hdr;
+    uint32_t key_len = eekv_key_len(key);
+    int ret;
+    int i;
+
+    if (!key_len || (!buf && size))
+        return WM_ERR_INVALID_PARAM;
+
+    ret = eekv_open();
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    xSemaphoreTake(g_eekv.lock, portMAX_DELAY);
+
+    g_eekv.stat.gets++;
+    i = eekv_lookup(key, key_len, eekv_hash(key, key_len), NULL, record);
+    if (i >= 0) {
+        eekv_record_header(record, &hdr);
+        if (len)
+            *len = hdr.value_len;
+        memcpy(buf, record + EEKV_RECORD_HEADER_SIZE + key_len, (hdr.value_len < size) ? hdr.value_len : size);
+    }
+
+    xSemaphoreGive(g_eekv.lock);
+
+    return (i >= 0) ? WM_ERR_SUCCESS : WM_ERR_FAILED;
+}
+
+int eekv_put(const char *key, const void *value, uint32_t len)
+{
+    uint32_t key_len = eekv_key_len(key);
+    int ret;
+
+    if (!key_len || (len > EEKV_VALUE_MAX) || (!value && len))
+        return WM_ERR_INVALID_PARAM;
+
+    ret = eekv_open();
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    xSemaphoreTake(g_eekv.lock, portMAX_DELAY);
+    ret = eekv_append(key, key_len, value ? value : "", len);
+    xSemaphoreGive(g_eekv.lock);
+
+    return ret;
+}
+
+int eekv_del(const char *key)
+{
+    uint32_t key_len = eekv_key_len(key);
+    int ret;
+
+    if (!key_len)
+        return WM_ERR_INVALID_PARAM;
+
+    ret = eekv_open();
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    xSemaphoreTake(g_eekv.lock, portMAX_DELAY);
+    ret = eekv_append(key, key_len, NULL, 0);
+    xSemaphoreGive(g_eekv.lock);
+
+    return ret;
+}
+
+int eekv_compact(void)
+{
+    int ret;
+
+    ret = eekv_open();
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    xSemaphoreTake(g_eekv.lock, portMAX_DELAY);
+    ret = eekv_do_compact();
+    xSemaphoreGive(g_eekv.lock);
+
+    return ret;
+}
+
+int eekv_foreach(void (*visit)(const char *key, const uint8_t *value, uint32_t len, void *arg), void *arg)
+{
+    uint8_t record[EEKV_RECORD_MAX];
+    eekv_record_header_t hdr;
+    char key[EEKV_KEY_MAX + 1];
+    int ret;
+
+    if (!visit)
+        return WM_ERR_INVALID_PARAM;
+
+    ret = eekv_open();
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    xSemaphoreTake(g_eekv.lock, portMAX_DELAY);
+
+    for (uint32_t i = 0; i < EEKV_INDEX_SLOTS; i++) {
+        if (!g_eekv.slot[i].offset ||
+            (WM_ERR_SUCCESS != eecache_read(eekv_bank_addr(g_eekv.bank) + g_eekv.slot[i].offset, record,
+                                            g_eekv.slot[i].size)) ||
+            !eekv_record_valid(record, g_eekv.slot[i].size))
+            continue;
+
+        eekv_record_header(record, &hdr);
+        memcpy(key, record + EEKV_RECORD_HEADER_SIZE, hdr.key_len);
+        key[hdr.key_len] = '\0';
+        visit(key, record + EEKV_RECORD_HEADER_SIZE + hdr.key_len, hdr.value_len, arg);
+    }
+
+    xSemaphoreGive(g_eekv.lock);
+
+    return WM_ERR_SUCCESS;
+}
+
+int eekv_get_stat(eekv_stat_t *stat)
+{
+    if (!stat)
+        return WM_ERR_INVALID_PARAM;
+
+    if (!g_eekv.opened)
+        return WM_ERR_NO_INITED;
+
+    xSemaphoreTake(g_eekv.lock, portMAX_DELAY);
+    *stat            = g_eekv.stat;
+    stat->used       = g_eekv.end;
+    stat->live      += EEKV_HEADER_SIZE;
+    stat->generation = g_eekv.generation;
+    xSemaphoreGive(g_eekv.lock);
+
+    return WM_ERR_SUCCESS;
+}
+
+static void eekv_print(const char *key, const uint8_t *value, uint32_t len, void *arg)
+{
+    wm_cli_printf("%-*s  %.*s\r\n", EEKV_KEY_MAX / 2, key, (int)len, value);
+}
+
+/* fill the bank to the end with updates of a set of keys, then time opening and reading it */
+static void eekv_bench(void)
+{
+    uint8_t value[EEKV_BENCH_VALUE];
+    char key[16];
+    eekv_stat_t stat;
+    uint32_t start;
+    uint32_t puts = 0;
+    uint32_t len;
+    int ret;
+
+    ret = eekv_format();
+    if (WM_ERR_SUCCESS != ret) {
+        wm_cli_printf("format ret=%d\r\n", ret);
+        return;
+    }
+
+    start = NOW_MS();
+    for (uint32_t i = 0; WM_ERR_SUCCESS == ret; i++) {
+        snprintf(key, sizeof(key), "bench%02u", i % EEKV_BENCH_KEYS);
+        memset(value, 'a' + i % 26, sizeof(value));
+        if (g_eekv.end + EEKV_RECORD_HEADER_SIZE + strlen(key) + sizeof(value) > EEKV_BANK_SIZE)
+            break;
+        ret = eekv_put(key, value, sizeof(value));
+        puts++;
+    }
+    wm_cli_printf("fill %u puts in %u ms, %u bytes used, ret=%d\r\n", puts, NOW_MS() - start, g_eekv.end, ret);
+
+    /* as after a reset */
+    eecache_flush();
+    g_eekv.opened = false;
+    ret           = eekv_open();
+    eekv_get_stat(&stat);
+    wm_cli_printf("open %u keys from %u bytes in %u ms, ret=%d\r\n", stat.keys, stat.used, stat.open_ms, ret);
+
+    g_eekv.stat.gets      = 0;
+    g_eekv.stat.get_reads = 0;
+    start                 = NOW_MS();
+    for (uint32_t i = 0; (WM_ERR_SUCCESS == ret) && (i < EEKV_BENCH_GETS); i++) {
+        snprintf(key, sizeof(key), "bench%02u", i % EEKV_BENCH_KEYS);
+        ret = eekv_get(key, value, sizeof(value), &len);
+    }
+    wm_cli_printf("%u gets in %u ms, %u eeprom reads, ret=%d\r\n", EEKV_BENCH_GETS, NOW_MS() - start,
+                  g_eekv.stat.get_reads, ret);
+
+    start = NOW_MS();
+    ret   = eekv_compact();
+    wm_cli_printf("compact to %u bytes in %u ms, ret=%d\r\n", g_eekv.end, NOW_MS() - start, ret);
+}
+
+static void cmd_eekv(int argc, char *argv[])
+{
+    uint8_t value[EEKV_VALUE_MAX];
+    eekv_stat_t stat;
+    uint32_t len;
+    int ret;
+
+    if ((argc > 1) && !strcmp("format", argv[1])) {
+        wm_cli_printf("format ret=%d\r\n", eekv_format());
+        return;
+    }
+
+    if ((argc > 1) && !strcmp("bench", argv[1])) {
+        eekv_bench();
+        return;
+    }
+
+    ret = eekv_open();
+    if (WM_ERR_SUCCESS != ret) {
+        wm_cli_printf("open ret=%d\r\n", ret);
+        return;
+    }
+
+    if ((argc > 2) && !strcmp("get", argv[1])) {
+        ret = eekv_get(argv[2], value, sizeof(value), &len);
+        if (WM_ERR_SUCCESS == ret)
+            wm_cli_printf("%s = %.*s\r\n", argv[2], (int)len, value);
+        else
+            wm_cli_printf("get ret=%d\r\n", ret);
+    } else if ((argc > 3) && !strcmp("put", argv[1])) {
+        wm_cli_printf("put ret=%d\r\n", eekv_put(argv[2], argv[3], strlen(argv[3])));
+    } else if ((argc > 2) && !strcmp("del", argv[1])) {
+        wm_cli_printf("del ret=%d\r\n", eekv_del(argv[2]));
+    } else if ((argc > 1) && !strcmp("list", argv[1])) {
+        eekv_foreach(eekv_print, NULL);
+    } else if ((argc > 1) && !strcmp("compact", argv[1])) {
+        wm_cli_printf("compact ret=%d\r\n", eekv_compact());
+    } else {
+        eekv_get_stat(&stat);
+        wm_cli_printf("bank %u generation %u, %u keys, %u of %u bytes used, %u live, %u compactions\r\n",
+                      g_eekv.bank, stat.generation, stat.keys, stat.used, EEKV_BANK_SIZE, stat.live,
+                      stat.compactions);
+        wm_cli_printf("%u gets with %u reads, %u puts, opened in %u ms\r\n", stat.gets, stat.get_reads, stat.puts,
+                      stat.open_ms);
+    }
+}
+WM_CLI_CMD_DEFINE(eekv, cmd_eekv, eekv cmd, eekv [get <key> | put <key> <value> | del <key> | list | compact | format | bench] -- key value store in the eeprom);
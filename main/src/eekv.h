@@ -0,0 +1,65 @@
+#ifndef __EEKV_H__
+#define __EEKV_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Key value store for calibration constants and counters in the lower half of the eeprom.
+ *
+ * The range is split in two banks, one of them live: a header with a generation number, then
+ * records appended one after the other, each its key and value lengths, a crc16, the key and the
+ * value; a record with no value deletes the key. Opening the store reads the live bank in one
+ * sequential read and builds a hash index in ram from it, so a get is one read of the record.
+ * When the bank is full the live records are copied to the other bank, whose header is written
+ * last with the next generation, so a crash during compaction leaves the old bank live.
+ */
+#define EEKV_START                     0
+#define EEKV_BANK_SIZE                 7680
+#define EEKV_BANKS                     2
+
+#define EEKV_KEY_MAX                   32
+#define EEKV_VALUE_MAX                 64
+#define EEKV_MAX_KEYS                  96
+
+typedef struct {
+    uint32_t keys;
+    uint32_t used;                     /**< bytes of the live bank taken by records */
+    uint32_t live;                     /**< of those, by the newest record of every key */
+    uint32_t generation;
+    uint32_t compactions;
+    uint32_t gets;
+    uint32_t get_reads;                /**< eeprom reads for them, more than gets on hash collisions */
+    uint32_t puts;
+    uint32_t open_ms;
+} eekv_stat_t;
+
+int eekv_open(void);
+
+/* an empty store, whatever was there is lost */
+int eekv_format(void);
+
+/* the value of key into buf, its length in *len, WM_ERR_FAILED when there is no such key */
+int eekv_get(const char *key, void *buf, uint32_t size, uint32_t *len);
+
+/* WM_ERR_NO_MEM when the live records fill the bank even after compaction */
+int eekv_put(const char *key, const void *value, uint32_t len);
+
+int eekv_del(const char *key);
+
+/* copy the live records to the other bank now */
+int eekv_compact(void);
+
+/* every key with its value, in no particular order */
+int eekv_foreach(void (*visit)(const char *key, const uint8_t *value, uint32_t len, void *arg), void *arg);
+
+int eekv_get_stat(eekv_stat_t *stat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __EEKV_H__ */
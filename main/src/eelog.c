@@ -0,0 +1,489 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wmsdk_config.h"
+#include "wm_cli.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "crc.h"
+#include "eecache.h"
+#include "sampler.h"
+#include "sht30.h"
+#include "ntc.h"
+#include "tsdb.h"
+#include "eelog.h"
+
+#define LOG_TAG "eelog"
+#include "wm_log.h"
+
+#define EELOG_MAGIC                    0xE1
+#define EELOG_CRC_OFFSET               6
+
+#define EELOG_LOG_DEFAULT_PERIOD_S     60
+#define EELOG_LOG_FLUSH_S              600
+
+#define EELOG_PRINT_DEFAULT            32
+
+#define NOW_MS()                       (xTaskGetTickCount() * portTICK_PERIOD_MS)
+
+typedef struct {
+    uint32_t seq;
+    uint8_t magic;
+    uint8_t count;                     /**< records in the page */
+    uint16_t crc;                      /**< crc16 of the page with this field left out */
+} eelog_header_t;
+
+static struct {
+    bool opened;
+    SemaphoreHandle_t lock;
+
+    uint32_t seq;                      /**< sequence number of the page being filled */
+    uint8_t page[EELOG_PAGE_SIZE];     /**< the page being filled */
+    uint32_t count;                    /**< records in it */
+    bool dirty;                        /**< it holds records not yet in the eeprom */
+
+    uint32_t last_time;
+    uint32_t time_base;
+    uint32_t open_time_ms;
+
+    uint32_t reads;
+    uint16_t writes[EELOG_PAGES];      /**< per page since boot */
+    eelog_stat_t stat;
+} g_eelog = { 0 };
+
+/* the page buffers are plain bytes, headers and records are copied in and out rather than cast */
+static void eelog_page_header(const uint8_t *page, eelog_header_t *hdr)
+{
+    memcpy(hdr, page, sizeof(*hdr));
+}
+
+static void eelog_record_get(const uint8_t *page, uint32_t i, eelog_record_t *rec)
+{
+    memcpy(rec, page + EELOG_HEADER_SIZE + i * EELOG_RECORD_SIZE, sizeof(*rec));
+}
+
+static void eelog_record_put(uint8_t *page, uint32_t i, const eelog_record_t *rec)
+{
+    memcpy(page + EELOG_HEADER_SIZE + i * EELOG_RECORD_SIZE, rec, sizeof(*rec));
+}
+
+static uint16_t eelog_crc(const uint8_t *page)
+{
+    uint16_t crc = crc16(CRC16_INIT, page, EELOG_CRC_OFFSET);
+
+    return crc16(crc, page + EELOG_HEADER_SIZE, EELOG_PAGE_SIZE - EELOG_HEADER_SIZE);
+}
+
+static uint32_t eelog_page_addr(uint32_t seq)
+{
+    return (EELOG_FIRST_PAGE + seq % EELOG_PAGES) * EELOG_PAGE_SIZE;
+}
+
+static int eelog_read_page(uint32_t n, uint8_t *page)
+{
+    g_eelog.reads++;
+
+    return eecache_read((EELOG_FIRST_PAGE + n) * EELOG_PAGE_SIZE, page, EELOG_PAGE_SIZE);
+}
+
+/* the sequence number of page n, false when it does not hold a good page */
+static bool eelog_page_seq(uint32_t n, uint8_t *page, uint32_t *seq)
+{
+    eelog_header_t hdr;
+
+    if (WM_ERR_SUCCESS != eelog_read_page(n, page))
+        return false;
+
+    eelog_page_header(page, &hdr);
+    if ((EELOG_MAGIC != hdr.magic) || (hdr.count > EELOG_PAGE_RECORDS) || (hdr.crc != eelog_crc(page)))
+        return false;
+
+    *seq = hdr.seq;
+
+    return true;
+}
+
+static int eelog_write_page(void)
+{
+    eelog_header_t hdr = { 0 };
+    uint32_t n         = g_eelog.seq % EELOG_PAGES;
+    uint32_t ms;
+    int ret;
+
+    /* the crc covers the rest of the header, it goes in first */
+    hdr.seq   = g_eelog.seq;
+    hdr.magic = EELOG_MAGIC;
+    hdr.count = g_eelog.count;
+    memcpy(g_eelog.page, &hdr, sizeof(hdr));
+    hdr.crc = eelog_crc(g_eelog.page);
+    memcpy(g_eelog.page, &hdr, sizeof(hdr));
+
+    /* through the cache and straight out, the page is only written when it has to be */
+    ret = eecache_write(eelog_page_addr(g_eelog.seq), g_eelog.page, EELOG_PAGE_SIZE);
+    if (WM_ERR_SUCCESS == ret)
+        ret = eecache_flush();
+    if (WM_ERR_SUCCESS != ret) {
+        g_eelog.stat.errors++;
+        return ret;
+    }
+
+    g_eelog.dirty = false;
+    g_eelog.stat.page_writes++;
+    if (g_eelog.writes[n] < UINT16_MAX)
+        g_eelog.writes[n]++;
+    if (g_eelog.writes[n] > g_eelog.stat.page_writes_max)
+        g_eelog.stat.page_writes_max = g_eelog.writes[n];
+
+    /* the ring wears every page alike, so the range's cycles divide by the rate */
+    ms = NOW_MS() - g_eelog.open_time_ms;
+    if (ms) {
+        g_eelog.stat.writes_per_hour = (uint64_t)g_eelog.stat.page_writes * 3600000 / ms;
+        if (g_eelog.stat.writes_per_hour)
+            g_eelog.stat.lifetime_days =
+                (uint64_t)EELOG_ENDURANCE * EELOG_PAGES / g_eelog.stat.writes_per_hour / 24;
+    }
+
+    return WM_ERR_SUCCESS;
+}
+
+static void eelog_new_page(uint32_t seq)
+{
+    memset(g_eelog.page, 0, sizeof(g_eelog.page));
+    g_eelog.seq   = seq;
+    g_eelog.count = 0;
+}
+
+/*
+ * page 0 holds a multiple of EELOG_PAGES, pages up to the newest follow it by one, the ones after
+ * are from the lap before or were never written, so the newest is the last that follows page 0
+ */
+static void eelog_recover(void)
+{
+    uint8_t page[EELOG_PAGE_SIZE];
+    eelog_header_t hdr;
+    eelog_record_t rec = { 0 };
+    uint32_t first;
+    uint32_t seq;
+    uint32_t lo;
+    uint32_t hi;
+    uint32_t mid;
+
+    if (!eelog_page_seq(0, page, &first) || (first % EELOG_PAGES)) {
+        eelog_new_page(0);
+        return;
+    }
+
+    lo = 0;
+    hi = EELOG_PAGES;
+    while (hi - lo > 1) {
+        mid = lo + (hi - lo) / 2;
+        if (eelog_page_seq(mid, page, &seq) && (seq == first + mid))
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    eelog_page_seq(lo, page, &seq);
+    eelog_page_header(page, &hdr);
+    if (hdr.count)
+        eelog_record_get(page, hdr.count - 1, &rec);
+    g_eelog.last_time = rec.time;
+
+    if (hdr.count < EELOG_PAGE_RECORDS) {
+        memcpy(g_eelog.page, page, sizeof(page));
+        g_eelog.seq   = seq;
+        g_eelog.count = hdr.count;
+    } else {
+        eelog_new_page(seq + 1);
+    }
+}
+
+static void eelog_set_time_base(void)
+{
+    g_eelog.time_base = (g_eelog.last_time ? g_eelog.last_time + 1 : 0) - NOW_MS() / 1000;
+}
+
+static int eelog_lock_init(void)
+{
+    SemaphoreHandle_t lock;
+
+    if (g_eelog.lock)
+        return WM_ERR_SUCCESS;
+
+    lock = xSemaphoreCreateMutex();
+    if (!lock)
+        return WM_ERR_NO_MEM;
+
+    taskENTER_CRITICAL();
+    if (!g_eelog.lock) {
+        g_eelog.lock = lock;
+        lock         = NULL;
+    }
+    taskEXIT_CRITICAL();
+
+    if (lock)
+        vSemaphoreDelete(lock);
+
+    return WM_ERR_SUCCESS;
+}
+
+int eelog_open(void)
+{
+    uint32_t start = NOW_MS();
+    int ret;
+
+    if (g_eelog.opened)
+        return WM_ERR_SUCCESS;
+
+    ret = eelog_lock_init();
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    ret = eecache_open();
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    xSemaphoreTake(g_eelog.lock, portMAX_DELAY);
+
+    /* a second opener must not recover over the page the first one is filling */
+    if (g_eelog.opened) {
+        xSemaphoreGive(g_eelog.lock);
+        return WM_ERR_SUCCESS;
+    }
+
+    g_eelog.opened = true;
+    eelog_recover();
+    eelog_set_time_base();
+    g_eelog.open_time_ms    = NOW_MS();
+    g_eelog.stat.open_ms    = g_eelog.open_time_ms - start;
+    g_eelog.stat.open_reads = g_eelog.reads;
+
+    xSemaphoreGive(g_eelog.lock);
+
+    wm_log_debug("open seq %u, %u records in page, %u reads", g_eelog.seq, g_eelog.count, g_eelog.stat.open_reads);
+
+    return WM_ERR_SUCCESS;
+}
+
+int eelog_format(void)
+{
+    uint8_t page[EELOG_PAGE_SIZE];
+    int ret;
+
+    ret = eelog_open();
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    xSemaphoreTake(g_eelog.lock, portMAX_DELAY);
+
+    /* no page may be left that would follow page 0, clearing them all is simplest */
+    memset(page, 0xFF, sizeof(page));
+    for (uint32_t n = 0; (WM_ERR_SUCCESS == ret) && (n < EELOG_PAGES); n++)
+        ret = eecache_write((EELOG_FIRST_PAGE + n) * EELOG_PAGE_SIZE, page, EELOG_PAGE_SIZE);
+    if (WM_ERR_SUCCESS == ret)
+        ret = eecache_flush();
+
+    eelog_new_page(0);
+    g_eelog.dirty     = false;
+    g_eelog.last_time = 0;
+    eelog_set_time_base();
+
+    xSemaphoreGive(g_eelog.lock);
+
+    return ret;
+}
+
+int eelog_append(uint32_t time, uint16_t series, int16_t value)
+{
+    eelog_record_t rec;
+    int ret;
+
+    ret = eelog_open();
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    xSemaphoreTake(g_eelog.lock, portMAX_DELAY);
+
+    if (time < g_eelog.last_time) {
+        xSemaphoreGive(g_eelog.lock);
+        return WM_ERR_INVALID_PARAM;
+    }
+
+    rec.time   = time;
+    rec.series = series;
+    rec.value  = value;
+    eelog_record_put(g_eelog.page, g_eelog.count++, &rec);
+
+    g_eelog.last_time = time;
+    g_eelog.dirty     = true;
+    g_eelog.stat.appends++;
+
+    if (EELOG_PAGE_RECORDS == g_eelog.count) {
+        ret = eelog_write_page();
+        if (WM_ERR_SUCCESS == ret)
+            eelog_new_page(g_eelog.seq + 1);
+        else
+            g_eelog.count--;
+    }
+
+    xSemaphoreGive(g_eelog.lock);
+
+    return ret;
+}
+
+int eelog_flush(void)
+{
+    int ret = WM_ERR_SUCCESS;
+
+    if (!g_eelog.opened)
+        return WM_ERR_NO_INITED;
+
+    xSemaphoreTake(g_eelog.lock, portMAX_DELAY);
+    if (g_eelog.dirty && g_eelog.count)
+        ret = eelog_write_page();
+    xSemaphoreGive(g_eelog.lock);
+
+    return ret;
+}
+
+static bool eelog_visit_page(const uint8_t *page, uint32_t count, eelog_visit_t visit, void *arg)
+{
+    eelog_record_t rec;
+
+    while (count--) {
+        eelog_record_get(page, count, &rec);
+        if (!visit(&rec, arg))
+            return false;
+    }
+
+    return true;
+}
+
+int eelog_walk(eelog_visit_t visit, void *arg)
+{
+    uint8_t page[EELOG_PAGE_SIZE];
+    eelog_header_t hdr;
+    uint32_t seq;
+    uint32_t want;
+    int ret;
+
+    ret = eelog_open();
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    xSemaphoreTake(g_eelog.lock, portMAX_DELAY);
+
+    memcpy(page, g_eelog.page, sizeof(page));
+    if (eelog_visit_page(page, g_eelog.count, visit, arg)) {
+        /* back round the ring while the pages are one lap's worth in order */
+        for (uint32_t i = 1; (i < EELOG_PAGES) && (i <= g_eelog.seq); i++) {
+            want = g_eelog.seq - i;
+            if (!eelog_page_seq(want % EELOG_PAGES, page, &seq) || (seq != want))
+                break;
+            eelog_page_header(page, &hdr);
+            if (!eelog_visit_page(page, hdr.count, visit, arg))
+                break;
+        }
+    }
+
+    xSemaphoreGive(g_eelog.lock);
+
+    return WM_ERR_SUCCESS;
+}
+
+uint32_t eelog_now(void)
+{
+    return g_eelog.time_base + NOW_MS() / 1000;
+}
+
+int eelog_get_stat(eelog_stat_t *stat)
+{
+    if (!stat)
+        return WM_ERR_INVALID_PARAM;
+
+    if (!g_eelog.opened)
+        return WM_ERR_NO_INITED;
+
+    xSemaphoreTake(g_eelog.lock, portMAX_DELAY);
+    *stat = g_eelog.stat;
+    xSemaphoreGive(g_eelog.lock);
+
+    return WM_ERR_SUCCESS;
+}
+
+/* the latest sensor samples into the log, runs in the sampler task */
+static int eelog_log_sample(sampler_sample_t *sample, void *arg)
+{
+    static uint32_t last_flush = 0;
+    sht30_reading_t reading;
+    uint32_t now = eelog_now();
+    uint32_t n   = 0;
+    float temp;
+
+    if ((WM_ERR_SUCCESS == sht30_get(&reading)) && (NOW_MS() - reading.time_ms <= SHT30_STALE_MS)) {
+        n += (WM_ERR_SUCCESS == eelog_append(now, TSDB_SERIES_SHT30_TEMP, (int16_t)(reading.temp * 100)));
+        n += (WM_ERR_SUCCESS == eelog_append(now, TSDB_SERIES_SHT30_HUMI, (int16_t)(reading.humi * 100)));
+    }
+
+    if (WM_ERR_SUCCESS == ntc_get(&temp))
+        n += (WM_ERR_SUCCESS == eelog_append(now, TSDB_SERIES_NTC_TEMP, (int16_t)(temp * 100)));
+
+    if (now - last_flush >= EELOG_LOG_FLUSH_S) {
+        eelog_flush();
+        last_flush = now;
+    }
+
+    sample->value[0] = n;
+
+    return n ? WM_ERR_SUCCESS : WM_ERR_FAILED;
+}
+
+static bool eelog_print_record(const eelog_record_t *record, void *arg)
+{
+    uint32_t *left = arg;
+
+    wm_cli_printf("%10u  %u  %d.%02d\r\n", record->time, record->series, record->value / 100,
+                  abs(record->value % 100));
+
+    return --*left > 0;
+}
+
+static void cmd_eelog(int argc, char *argv[])
+{
+    eelog_stat_t stat;
+    uint32_t left;
+    int ret;
+
+    ret = eelog_open();
+    if (WM_ERR_SUCCESS != ret) {
+        wm_cli_printf("open ret=%d\r\n", ret);
+        return;
+    }
+
+    if ((argc > 1) && !strcmp("log", argv[1])) {
+        ret = sampler_register("eelog", ((argc > 2) ? strtoul(argv[2], NULL, 0) : EELOG_LOG_DEFAULT_PERIOD_S) * 1000,
+                               SAMPLER_PHASE_AUTO, eelog_log_sample, NULL);
+        sht30_start();
+        ntc_sample_start();
+        wm_cli_printf("log ret=%d\r\n", (ret < 0) ? ret : WM_ERR_SUCCESS);
+    } else if ((argc > 1) && !strcmp("flush", argv[1])) {
+        wm_cli_printf("flush ret=%d\r\n", eelog_flush());
+    } else if ((argc > 1) && !strcmp("format", argv[1])) {
+        wm_cli_printf("format ret=%d\r\n", eelog_format());
+    } else if ((argc > 1) && !strcmp("read", argv[1])) {
+        left = (argc > 2) ? strtoul(argv[2], NULL, 0) : EELOG_PRINT_DEFAULT;
+        if (left)
+            eelog_walk(eelog_print_record, &left);
+    } else {
+        eelog_get_stat(&stat);
+        wm_cli_printf("pages %u + %u of %u bytes, seq %u, %u records in ram, last time %u, now %u\r\n",
+                      EELOG_FIRST_PAGE, EELOG_PAGES, EELOG_PAGE_SIZE, g_eelog.seq, g_eelog.count, g_eelog.last_time,
+                      eelog_now());
+        wm_cli_printf("%u appends, %u page writes, %u errors, opened in %u ms with %u reads\r\n", stat.appends,
+                      stat.page_writes, stat.errors, stat.open_ms, stat.open_reads);
+        wm_cli_printf("%u page writes/h, most written page %u, %u pages a lap, lifetime %u days at %u cycles\r\n",
+                      stat.writes_per_hour, stat.page_writes_max, EELOG_PAGES, stat.lifetime_days, EELOG_ENDURANCE);
+    }
+}
+WM_CLI_CMD_DEFINE(eelog, cmd_eelog, eelog cmd, eelog [log [period_s] | flush | read [count] | format] -- sensor ring log in the eeprom);
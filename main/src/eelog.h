@@ -0,0 +1,77 @@
+#ifndef __EELOG_H__
+#define __EELOG_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Ring log of sensor records in the at24c256, for when there is no sd card.
+ *
+ * Records are batched in ram and written a whole 64 byte page at a time, aligned to the page, so a
+ * write costs the eeprom one page cycle. Pages are written strictly in turn round the range, which
+ * spreads the wear evenly over it. Every page starts with its sequence number and ends in a crc16;
+ * sequence numbers rise along the range up to the newest page, so opening the log finds it with a
+ * binary search. eelog_flush writes a partial page, which the next flush or the page filling up
+ * writes again.
+ */
+#define EELOG_PAGE_SIZE                64
+
+/* the upper half of the eeprom, the lower half is left to settings */
+#define EELOG_FIRST_PAGE               256
+#define EELOG_PAGES                    256
+
+#define EELOG_HEADER_SIZE              8
+#define EELOG_RECORD_SIZE              8
+#define EELOG_PAGE_RECORDS             ((EELOG_PAGE_SIZE - EELOG_HEADER_SIZE) / EELOG_RECORD_SIZE)
+
+/* write cycles the at24c256 is rated for */
+#define EELOG_ENDURANCE                1000000
+
+typedef struct {
+    uint32_t time;                     /**< seconds, see eelog_now */
+    uint16_t series;                   /**< as the tsdb series */
+    int16_t value;
+} eelog_record_t;
+
+typedef struct {
+    uint32_t appends;
+    uint32_t page_writes;              /**< including rewrites of a flushed partial page */
+    uint32_t page_writes_max;          /**< of the most written page since boot */
+    uint32_t writes_per_hour;          /**< since boot */
+    uint32_t lifetime_days;            /**< at that rate, spread over the range */
+    uint32_t open_reads;               /**< pages read to open the log */
+    uint32_t open_ms;
+    uint32_t errors;
+} eelog_stat_t;
+
+/* true to go on, false to stop */
+typedef bool (*eelog_visit_t)(const eelog_record_t *record, void *arg);
+
+/* find the newest page, opened on first use by the calls below too */
+int eelog_open(void);
+
+/* an empty log, whatever was there is lost */
+int eelog_format(void);
+
+/* time must not go backwards, WM_ERR_INVALID_PARAM when it does */
+int eelog_append(uint32_t time, uint16_t series, int16_t value);
+
+int eelog_flush(void);
+
+/* records newest first, the ones still in ram included */
+int eelog_walk(eelog_visit_t visit, void *arg);
+
+/* seconds since boot, offset so that they carry on after the newest record */
+uint32_t eelog_now(void);
+
+int eelog_get_stat(eelog_stat_t *stat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __EELOG_H__ */
@@ -46,6 +46,7 @@
 
 static QueueHandle_t work_queue = NULL;
 static wm_mqtt_client_handle_t mqtt_client;
+static int mqtt_connected = 0;
 
 static int get_value_from_json(const char *json_string)
 {
@@ -110,6 +111,8 @@ static void event_handler_mqtt_connected(wm_mqtt_event_data_t *data, void *priv)
 
     wm_log_info("MQTTS connected");
 
+    mqtt_connected = 1;
+
     xQueueSend(work_queue, &msg, 0);
 }
 
@@ -119,6 +122,8 @@ static void event_handler_mqtt_disconnected(wm_mqtt_event_data_t *data, void *pr
 
     wm_log_info("MQTTS disconnected");
 
+    mqtt_connected = 0;
+
     xQueueSend(work_queue, &msg, 0);
 }
 
@@ -274,6 +279,11 @@ static void work_task(void *param)
     }
 }
 
+int fastbee_mqtt_state(void)
+{
+    return mqtt_connected;
+}
+
 void send_key_to_fastbee(void)
 {
     int msg = QUEUE_MSG_TYPE_KEY;
@@ -6,6 +6,7 @@ extern "C" {
 #endif
 
 void send_key_to_fastbee(void);
+int fastbee_mqtt_state(void);
 
 void led_on(void);
 void led_off(void);
@@ -0,0 +1,308 @@
+#include <stdio.h>
+#include <string.h>
+#include "wmsdk_config.h"
+#include "wm_drv_i2c.h"
+#include "wm_cli.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "i2c_bus.h"
+
+#define LOG_TAG "i2c_bus"
+#include "wm_log.h"
+
+#define I2C_BUS_TASK_STACK             512
+/* above the sampler and the display, a queued transaction should not wait for their work */
+#define I2C_BUS_TASK_PRIO              4
+
+#define NOW_MS()                       (xTaskGetTickCount() * portTICK_PERIOD_MS)
+
+static struct {
+    TaskHandle_t task;
+    QueueHandle_t queue;
+    SemaphoreHandle_t lock;            /**< start and stat */
+    wm_device_t *dev;
+
+    uint16_t last_addr;                /**< device of the previous transaction */
+    uint32_t start_ms;
+
+    i2c_bus_stat_t stat;
+} g_bus = { 0 };
+
+/* clock cycles of xfer: start, address byte and each byte with its ack, a repeated start before reading */
+static uint32_t i2c_bus_bits(const i2c_bus_xfer_t *xfer)
+{
+    uint32_t bytes = 1 + xfer->sub_len + xfer->len;
+
+    if (xfer->read && xfer->sub_len)
+        bytes++;
+
+    return bytes * 9 + ((xfer->read && xfer->sub_len) ? 2 : 1);
+}
+
+static void i2c_bus_execute(i2c_bus_xfer_t *xfer)
+{
+    wm_drv_i2c_config_t config;
+    uint32_t start = NOW_MS();
+    uint32_t wait  = start - xfer->queued_ms;
+    uint32_t ms;
+
+    config.addr     = xfer->addr;
+    config.speed_hz = xfer->speed_hz;
+
+    if (xfer->read)
+        xfer->ret = wm_drv_i2c_read(g_bus.dev, &config, xfer->sub, xfer->sub_len, xfer->data, xfer->len);
+    else
+        xfer->ret = wm_drv_i2c_write(g_bus.dev, &config, xfer->sub, xfer->sub_len, xfer->data, xfer->len);
+
+    ms = NOW_MS() - start;
+
+    xSemaphoreTake(g_bus.lock, portMAX_DELAY);
+
+    g_bus.stat.xfers++;
+    if (WM_ERR_SUCCESS != xfer->ret)
+        g_bus.stat.errors++;
+    if ((g_bus.stat.xfers > 1) && (xfer->addr != g_bus.last_addr))
+        g_bus.stat.switches++;
+    g_bus.last_addr = xfer->addr;
+
+    g_bus.stat.bytes   += xfer->sub_len + xfer->len;
+    g_bus.stat.wire_us += (uint64_t)i2c_bus_bits(xfer) * 1000000 / xfer->speed_hz;
+    g_bus.stat.busy_ms += ms;
+
+    if (wait > g_bus.stat.wait_ms_max)
+        g_bus.stat.wait_ms_max = wait;
+    g_bus.stat.wait_ms_sum += wait;
+
+    xSemaphoreGive(g_bus.lock);
+
+    if (xfer->done)
+        xfer->done(xfer);
+    else
+        xTaskNotifyGive(xfer->waiter);
+}
+
+static void i2c_bus_task(void *param)
+{
+    static i2c_bus_xfer_t *pending[I2C_BUS_QUEUE_LEN];
+    uint16_t addr;
+    int count;
+    int left;
+
+    while (1) {
+        if (xQueueReceive(g_bus.queue, &pending[0], portMAX_DELAY) != pdTRUE)
+            continue;
+
+        /* take everything queued so far, it runs grouped by device */
+        count = 1;
+        while ((count < I2C_BUS_QUEUE_LEN) && (xQueueReceive(g_bus.queue, &pending[count], 0) == pdTRUE))
+            count++;
+
+        xSemaphoreTake(g_bus.lock, portMAX_DELAY);
+        g_bus.stat.batches++;
+        if (count > g_bus.stat.batch_max)
+            g_bus.stat.batch_max = count;
+        xSemaphoreGive(g_bus.lock);
+
+        /* the device of the previous transaction first, then in order of the oldest transaction of each */
+        addr = g_bus.last_addr;
+        left = count;
+        while (left) {
+            bool found = false;
+
+            for (int i = 0; i < count; i++) {
+                if (pending[i] && (pending[i]->addr == addr)) {
+                    i2c_bus_execute(pending[i]);
+                    pending[i] = NULL;
+                    found      = true;
+                    left--;
+                }
+            }
+
+            if (!found) {
+                for (int i = 0; i < count; i++) {
+                    if (pending[i]) {
+                        addr = pending[i]->addr;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+int i2c_bus_start(void)
+{
+    SemaphoreHandle_t lock;
+    wm_device_t *dev;
+    int ret = WM_ERR_SUCCESS;
+
+    if (g_bus.task)
+        return WM_ERR_SUCCESS;
+
+    /* every device opens the bus on first use, from whatever task that happens in */
+    if (!g_bus.lock) {
+        lock = xSemaphoreCreateMutex();
+        if (!lock)
+            return WM_ERR_NO_MEM;
+
+        taskENTER_CRITICAL();
+        if (!g_bus.lock) {
+            g_bus.lock = lock;
+            lock       = NULL;
+        }
+        taskEXIT_CRITICAL();
+
+        if (lock)
+            vSemaphoreDelete(lock);
+    }
+
+    xSemaphoreTake(g_bus.lock, portMAX_DELAY);
+
+    if (g_bus.task)
+        goto out;
+
+    dev = wm_dt_get_device_by_name("i2c");
+    if (!(dev && (WM_DEV_ST_INITED == dev->state)))
+        dev = wm_drv_i2c_init("i2c");
+
+    if (!dev) {
+        ret = WM_ERR_FAILED;
+        goto out;
+    }
+
+    g_bus.dev   = dev;
+    g_bus.queue = xQueueCreate(I2C_BUS_QUEUE_LEN, sizeof(i2c_bus_xfer_t *));
+    if (!g_bus.queue) {
+        ret = WM_ERR_NO_MEM;
+        goto out;
+    }
+
+    g_bus.start_ms = NOW_MS();
+
+    if (pdPASS != xTaskCreate(i2c_bus_task, "i2c_bus", I2C_BUS_TASK_STACK, NULL, I2C_BUS_TASK_PRIO, &g_bus.task)) {
+        vQueueDelete(g_bus.queue);
+        g_bus.queue = NULL;
+        g_bus.task  = NULL;
+        ret         = WM_ERR_NO_MEM;
+    }
+
+out:
+    xSemaphoreGive(g_bus.lock);
+
+    return ret;
+}
+
+int i2c_bus_submit(i2c_bus_xfer_t *xfer)
+{
+    int ret;
+
+    if (!xfer || !xfer->speed_hz || (xfer->len && !xfer->data) || (xfer->sub_len && !xfer->sub))
+        return WM_ERR_INVALID_PARAM;
+
+    ret = i2c_bus_start();
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    xfer->ret       = WM_ERR_BUSY;
+    xfer->waiter    = xTaskGetCurrentTaskHandle();
+    xfer->queued_ms = NOW_MS();
+
+    if (xQueueSend(g_bus.queue, &xfer, 0) != pdTRUE) {
+        xSemaphoreTake(g_bus.lock, portMAX_DELAY);
+        g_bus.stat.dropped++;
+        xSemaphoreGive(g_bus.lock);
+        return WM_ERR_BUSY;
+    }
+
+    return WM_ERR_SUCCESS;
+}
+
+static int i2c_bus_wait(i2c_bus_xfer_t *xfer)
+{
+    int ret;
+
+    /* the queue only fills with asynchronous transactions, wait for room rather than fail */
+    while (WM_ERR_BUSY == (ret = i2c_bus_submit(xfer)))
+        vTaskDelay(1);
+
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    return xfer->ret;
+}
+
+int i2c_bus_read(uint16_t addr, uint32_t speed_hz, const void *sub, uint32_t sub_len, void *buf, uint32_t len)
+{
+    i2c_bus_xfer_t xfer = { 0 };
+
+    xfer.addr     = addr;
+    xfer.speed_hz = speed_hz;
+    xfer.read     = true;
+    xfer.sub      = sub;
+    xfer.sub_len  = sub_len;
+    xfer.data     = buf;
+    xfer.len      = len;
+
+    return i2c_bus_wait(&xfer);
+}
+
+int i2c_bus_write(uint16_t addr, uint32_t speed_hz, const void *sub, uint32_t sub_len, const void *data,
+                  uint32_t len)
+{
+    i2c_bus_xfer_t xfer = { 0 };
+
+    xfer.addr     = addr;
+    xfer.speed_hz = speed_hz;
+    xfer.sub      = sub;
+    xfer.sub_len  = sub_len;
+    xfer.data     = (void *)data;
+    xfer.len      = len;
+
+    return i2c_bus_wait(&xfer);
+}
+
+int i2c_bus_get_stat(i2c_bus_stat_t *stat)
+{
+    if (!stat)
+        return WM_ERR_INVALID_PARAM;
+
+    if (!g_bus.task)
+        return WM_ERR_NO_INITED;
+
+    xSemaphoreTake(g_bus.lock, portMAX_DELAY);
+    *stat            = g_bus.stat;
+    stat->elapsed_ms = NOW_MS() - g_bus.start_ms;
+    xSemaphoreGive(g_bus.lock);
+
+    return WM_ERR_SUCCESS;
+}
+
+static void cmd_i2cbus(int argc, char *argv[])
+{
+    i2c_bus_stat_t stat;
+
+    if (WM_ERR_SUCCESS != i2c_bus_get_stat(&stat)) {
+        wm_cli_printf("i2c bus not started\r\n");
+        return;
+    }
+
+    wm_cli_printf("%u transactions, %u errors, %u bytes, %u dropped\r\n", stat.xfers, stat.errors, stat.bytes,
+                  stat.dropped);
+    wm_cli_printf("%u batches, largest %u, %u device switches\r\n", stat.batches, stat.batch_max, stat.switches);
+    if (stat.elapsed_ms) {
+        wm_cli_printf("in the driver %u ms, %u.%02u%% of %u ms, on the wire %u.%02u%%\r\n", stat.busy_ms,
+                      (uint32_t)((uint64_t)stat.busy_ms * 100 / stat.elapsed_ms),
+                      (uint32_t)((uint64_t)stat.busy_ms * 10000 / stat.elapsed_ms % 100), stat.elapsed_ms,
+                      (uint32_t)(stat.wire_us / 10 / stat.elapsed_ms),
+                      (uint32_t)(stat.wire_us * 10 / stat.elapsed_ms % 100));
+    }
+    if (stat.xfers) {
+        wm_cli_printf("queue wait max %u ms, avg %u.%02u ms\r\n", stat.wait_ms_max, stat.wait_ms_sum / stat.xfers,
+                      (uint32_t)((uint64_t)stat.wait_ms_sum * 100 / stat.xfers % 100));
+    }
+}
+WM_CLI_CMD_DEFINE(i2cbus, cmd_i2cbus, i2cbus cmd, i2cbus -- show i2c bus utilization and queue wait time);
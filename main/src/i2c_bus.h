@@ -0,0 +1,77 @@
+#ifndef __I2C_BUS_H__
+#define __I2C_BUS_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * I2c bus service: one task owns the controller and runs queued transactions, each with the
+ * address and speed of its device. The task takes everything queued at once and runs the
+ * transactions of one device back to back, in the order they were queued, before moving to the
+ * next device.
+ *
+ * A transaction is its sub address or command bytes, then a read or a write of data; a write of
+ * no data is an address poll. It finishes with its done callback in the bus task, which must not
+ * wait on the bus itself, or with a notification of the task that queued it when there is none.
+ * i2c_bus_read / i2c_bus_write queue one and wait for that notification.
+ */
+#define I2C_BUS_QUEUE_LEN              16
+
+typedef struct i2c_bus_xfer i2c_bus_xfer_t;
+
+typedef void (*i2c_bus_done_t)(i2c_bus_xfer_t *xfer);
+
+struct i2c_bus_xfer {
+    uint16_t addr;
+    uint32_t speed_hz;
+    bool read;
+    const void *sub;                   /**< sent first, may be NULL */
+    uint32_t sub_len;
+    void *data;                        /**< read into or written from */
+    uint32_t len;
+    i2c_bus_done_t done;               /**< NULL to notify the queuing task instead */
+    void *arg;
+
+    int ret;                           /**< valid once done */
+
+    TaskHandle_t waiter;               /**< set by i2c_bus_submit */
+    uint32_t queued_ms;
+};
+
+typedef struct {
+    uint32_t xfers;
+    uint32_t errors;
+    uint32_t bytes;                    /**< sub address and data */
+    uint32_t batches;                  /**< times the task woke to a non empty queue */
+    uint32_t batch_max;
+    uint32_t switches;                 /**< consecutive transactions to different devices */
+    uint64_t wire_us;                  /**< time on the wire, from the bits and speeds */
+    uint32_t busy_ms;                  /**< in the driver */
+    uint32_t elapsed_ms;               /**< since the task started */
+    uint32_t wait_ms_max;              /**< from queuing to starting */
+    uint32_t wait_ms_sum;
+    uint32_t dropped;                  /**< refused with the queue full */
+} i2c_bus_stat_t;
+
+int i2c_bus_start(void);
+
+/* queue xfer, which must stay valid until done; WM_ERR_BUSY when the queue is full */
+int i2c_bus_submit(i2c_bus_xfer_t *xfer);
+
+int i2c_bus_read(uint16_t addr, uint32_t speed_hz, const void *sub, uint32_t sub_len, void *buf, uint32_t len);
+int i2c_bus_write(uint16_t addr, uint32_t speed_hz, const void *sub, uint32_t sub_len, const void *data,
+                  uint32_t len);
+
+int i2c_bus_get_stat(i2c_bus_stat_t *stat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __I2C_BUS_H__ */
@@ -0,0 +1,721 @@
+#include <stdio.h>
+#include <string.h>
+#include "wmsdk_config.h"
+#include "jpeg.h"
+
+#define LOG_TAG "jpeg"
+#include "wm_log.h"
+
+#define JPEG_M_SOF0                    0xC0
+#define JPEG_M_SOF1                    0xC1
+#define JPEG_M_DHT                     0xC4
+#define JPEG_M_RST0                    0xD0
+#define JPEG_M_RST7                    0xD7
+#define JPEG_M_SOI                     0xD8
+#define JPEG_M_EOI                     0xD9
+#define JPEG_M_SOS                     0xDA
+#define JPEG_M_DQT                     0xDB
+#define JPEG_M_DRI                     0xDD
+
+/* integer idct, the islow method of the ijg library */
+#define JPEG_CONST_BITS                13
+#define JPEG_PASS1_BITS                2
+#define JPEG_DESCALE(x, n)             (((x) + (1 << ((n) - 1))) >> (n))
+
+#define JPEG_FIX_0_298631336           2446
+#define JPEG_FIX_0_390180644           3196
+#define JPEG_FIX_0_541196100           4433
+#define JPEG_FIX_0_765366865           6270
+#define JPEG_FIX_0_899976223           7373
+#define JPEG_FIX_1_175875602           9633
+#define JPEG_FIX_1_501321110           12299
+#define JPEG_FIX_1_847759065           15137
+#define JPEG_FIX_1_961570560           16069
+#define JPEG_FIX_2_053119869           16819
+#define JPEG_FIX_2_562915447           20995
+#define JPEG_FIX_3_072711026           25172
+
+/* ycbcr to rgb in 16.16 fixed point */
+#define JPEG_CR_R                      91881
+#define JPEG_CB_G                      22554
+#define JPEG_CR_G                      46802
+#define JPEG_CB_B                      116130
+#define JPEG_ONE_HALF                  32768
+
+/* natural position of the n-th coefficient in zigzag order */
+static const uint8_t jpeg_zigzag[64] = {
+     0,  1,  8, 16,  9,  2,  3, 10,
+    17, 24, 32, 25, 18, 11,  4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34,
+    27, 20, 13,  6,  7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36,
+    29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46,
+    53, 60, 61, 54, 47, 55, 62, 63
+};
+
+static int jpeg_byte(jpeg_dec_t *dec)
+{
+    int n;
+
+    if (dec->in_pos == dec->in_len) {
+        if (dec->in_end)
+            return -1;
+
+        n = dec->read(dec->arg, dec->in, sizeof(dec->in));
+        if (n <= 0) {
+            dec->in_end = true;
+            return -1;
+        }
+
+        dec->in_pos = 0;
+        dec->in_len = n;
+    }
+
+    return dec->in[dec->in_pos++];
+}
+
+static int jpeg_word(jpeg_dec_t *dec)
+{
+    int hi = jpeg_byte(dec);
+    int lo = jpeg_byte(dec);
+
+    if ((hi < 0) || (lo < 0))
+        return -1;
+
+    return (hi << 8) | lo;
+}
+
+static int jpeg_skip(jpeg_dec_t *dec, int len)
+{
+    while (len-- > 0) {
+        if (jpeg_byte(dec) < 0)
+            return WM_ERR_FAILED;
+    }
+
+    return WM_ERR_SUCCESS;
+}
+
+static int jpeg_parse_dqt(jpeg_dec_t *dec, int len)
+{
+    int pq_tq;
+    int v;
+
+    while (len > 0) {
+        pq_tq = jpeg_byte(dec);
+        if ((pq_tq < 0) || ((pq_tq & 0x0F) > 3))
+            return WM_ERR_INVALID_PARAM;
+
+        for (int i = 0; i < 64; i++) {
+            v = (pq_tq >> 4) ? jpeg_word(dec) : jpeg_byte(dec);
+            if (v < 0)
+                return WM_ERR_FAILED;
+            dec->qt[pq_tq & 0x0F][i] = v;
+        }
+
+        len -= 1 + ((pq_tq >> 4) ? 128 : 64);
+    }
+
+    return WM_ERR_SUCCESS;
+}
+
+static int jpeg_parse_dht(jpeg_dec_t *dec, int len)
+{
+    uint8_t counts[17];
+    jpeg_huff_t *huff;
+    int tc_th;
+    int total;
+    int code;
+    int k;
+    int v;
+
+    while (len > 0) {
+        tc_th = jpeg_byte(dec);
+        if ((tc_th < 0) || ((tc_th >> 4) > 1) || ((tc_th & 0x0F) > 1))
+            return WM_ERR_INVALID_PARAM;
+
+        huff  = &dec->huff[(tc_th >> 4) * 2 + (tc_th & 0x0F)];
+        total = 0;
+        for (int l = 1; l <= 16; l++) {
+            v = jpeg_byte(dec);
+            if (v < 0)
+                return WM_ERR_FAILED;
+            counts[l] = v;
+            total    += v;
+        }
+
+        if (total > 256)
+            return WM_ERR_INVALID_PARAM;
+
+        for (int i = 0; i < total; i++) {
+            v = jpeg_byte(dec);
+            if (v < 0)
+                return WM_ERR_FAILED;
+            huff->val[i] = v;
+        }
+
+        /* canonical codes: consecutive within a length, doubled when the length grows */
+        memset(huff->look_len, 0, sizeof(huff->look_len));
+        code = 0;
+        k    = 0;
+        for (int l = 1; l <= 16; l++) {
+            huff->valoff[l] = k - code;
+
+            /* more codes than the length can hold, the table is corrupt */
+            if (code + counts[l] > (1 << l))
+                return WM_ERR_INVALID_PARAM;
+
+            for (int i = 0; i < counts[l]; i++, code++, k++) {
+                if (l <= JPEG_LOOKAHEAD_BITS) {
+                    int shift = JPEG_LOOKAHEAD_BITS - l;
+
+                    for (int s = 0; s < (1 << shift); s++) {
+                        huff->look_len[(code << shift) | s] = l;
+                        huff->look_val[(code << shift) | s] = huff->val[k];
+                    }
+                }
+            }
+
+            huff->maxcode[l] = counts[l] ? (code - 1) : -1;
+            code <<= 1;
+        }
+
+        len -= 17 + total;
+    }
+
+    return WM_ERR_SUCCESS;
+}
+
+static int jpeg_parse_sof(jpeg_dec_t *dec)
+{
+    jpeg_comp_t *c;
+    int v;
+
+    if (jpeg_byte(dec) != 8) {
+        wm_log_error("only 8-bit samples");
+        return WM_ERR_INVALID_PARAM;
+    }
+
+    dec->height = jpeg_word(dec);
+    dec->width  = jpeg_word(dec);
+    dec->ncomp  = jpeg_byte(dec);
+
+    if (!dec->width || !dec->height || ((dec->ncomp != 1) && (dec->ncomp != 3)))
+        return WM_ERR_INVALID_PARAM;
+
+    for (int i = 0; i < dec->ncomp; i++) {
+        c     = &dec->comp[i];
+        c->id = jpeg_byte(dec);
+        v     = jpeg_byte(dec);
+        c->tq = jpeg_byte(dec) & 0x03;
+        c->h  = (v >> 4) & 0x0F;
+        c->v  = v & 0x0F;
+    }
+
+    /* a single component scan has one block per mcu, whatever its sampling factors */
+    if (dec->ncomp == 1) {
+        dec->comp[0].h = 1;
+        dec->comp[0].v = 1;
+    }
+
+    /* luma 1x1, 2x1 or 2x2, chroma always 1x1: 4:4:4, 4:2:2 and 4:2:0 */
+    if ((dec->comp[0].h < 1) || (dec->comp[0].h > 2) || (dec->comp[0].v < 1) || (dec->comp[0].v > 2))
+        return WM_ERR_INVALID_PARAM;
+    for (int i = 1; i < dec->ncomp; i++) {
+        if ((dec->comp[i].h != 1) || (dec->comp[i].v != 1)) {
+            wm_log_error("unsupported chroma sampling");
+            return WM_ERR_INVALID_PARAM;
+        }
+    }
+
+    dec->mcu_w = dec->comp[0].h * 8;
+    dec->mcu_h = dec->comp[0].v * 8;
+
+    return WM_ERR_SUCCESS;
+}
+
+static int jpeg_parse_sos(jpeg_dec_t *dec)
+{
+    int n = jpeg_byte(dec);
+    int id;
+    int t;
+
+    if (n != dec->ncomp) {
+        wm_log_error("only single scan images");
+        return WM_ERR_INVALID_PARAM;
+    }
+
+    for (int i = 0; i < n; i++) {
+        id = jpeg_byte(dec);
+        t  = jpeg_byte(dec);
+        if ((id < 0) || (t < 0))
+            return WM_ERR_FAILED;
+
+        for (int j = 0; j < dec->ncomp; j++) {
+            if (dec->comp[j].id == id) {
+                dec->comp[j].td = (t >> 4) & 0x01;
+                dec->comp[j].ta = t & 0x01;
+            }
+        }
+    }
+
+    /* spectral selection and successive approximation, fixed for baseline */
+    return jpeg_skip(dec, 3);
+}
+
+int jpeg_decode_header(jpeg_dec_t *dec, jpeg_read_t read, void *arg)
+{
+    bool frame = false;
+    int marker;
+    int len;
+    int ret;
+
+    memset(dec, 0, sizeof(*dec));
+    dec->read = read;
+    dec->arg  = arg;
+
+    if ((jpeg_byte(dec) != 0xFF) || (jpeg_byte(dec) != JPEG_M_SOI))
+        return WM_ERR_INVALID_PARAM;
+
+    while (1) {
+        /* markers may be padded with any number of 0xff */
+        do {
+            marker = jpeg_byte(dec);
+        } while (marker == 0xFF);
+
+        if (marker < 0)
+            return WM_ERR_FAILED;
+
+        len = jpeg_word(dec);
+        if (len < 2)
+            return WM_ERR_INVALID_PARAM;
+        len -= 2;
+
+        switch (marker) {
+            case JPEG_M_SOF0:
+            case JPEG_M_SOF1:
+                ret   = jpeg_parse_sof(dec);
+                frame = true;
+                break;
+            case JPEG_M_DHT:
+                ret = jpeg_parse_dht(dec, len);
+                break;
+            case JPEG_M_DQT:
+                ret = jpeg_parse_dqt(dec, len);
+                break;
+            case JPEG_M_DRI:
+                dec->restart_interval = jpeg_word(dec);
+                ret = jpeg_skip(dec, len - 2);
+                break;
+            case JPEG_M_SOS:
+                if (!frame)
+                    return WM_ERR_INVALID_PARAM;
+                return jpeg_parse_sos(dec);
+            default:
+                /* other frame types are progressive, lossless or arithmetic coded */
+                if ((marker >= 0xC2) && (marker <= 0xCF) && (marker != JPEG_M_DHT) && (marker != 0xC8) && (marker != 0xCC)) {
+                    wm_log_error("unsupported frame type 0x%02x", marker);
+                    return WM_ERR_INVALID_PARAM;
+                }
+                ret = jpeg_skip(dec, len);
+                break;
+        }
+
+        if (ret != WM_ERR_SUCCESS)
+            return ret;
+    }
+}
+
+/* keep at least 25 bits in the buffer, a marker stops the data and zeros are fed after it */
+static void jpeg_fill_bits(jpeg_dec_t *dec)
+{
+    int b;
+    int next;
+
+    while (dec->nbits <= 24) {
+        b = 0;
+        if (!dec->marker) {
+            b = jpeg_byte(dec);
+            if (b == 0xFF) {
+                next = jpeg_byte(dec);
+                if (next != 0) {
+                    dec->marker = (next < 0) ? JPEG_M_EOI : next;
+                    b           = 0;
+                }
+            } else if (b < 0) {
+                dec->marker = JPEG_M_EOI;
+                b           = 0;
+            }
+        }
+
+        dec->bits   = (dec->bits << 8) | b;
+        dec->nbits += 8;
+    }
+}
+
+static inline uint32_t jpeg_get_bits(jpeg_dec_t *dec, int n)
+{
+    uint32_t v;
+
+    if (!n)
+        return 0;
+
+    if (dec->nbits < n)
+        jpeg_fill_bits(dec);
+
+    dec->nbits -= n;
+    v = (dec->bits >> dec->nbits) & ((1u << n) - 1);
+
+    return v;
+}
+
+static int jpeg_huff_decode(jpeg_dec_t *dec, const jpeg_huff_t *huff)
+{
+    uint32_t look;
+    int32_t code;
+    int len;
+
+    if (dec->nbits < 16)
+        jpeg_fill_bits(dec);
+
+    look = (dec->bits >> (dec->nbits - JPEG_LOOKAHEAD_BITS)) & ((1 << JPEG_LOOKAHEAD_BITS) - 1);
+    len  = huff->look_len[look];
+    if (len) {
+        dec->nbits -= len;
+        return huff->look_val[look];
+    }
+
+    for (len = JPEG_LOOKAHEAD_BITS + 1; len <= 16; len++) {
+        code = (dec->bits >> (dec->nbits - len)) & ((1 << len) - 1);
+        if (code <= huff->maxcode[len]) {
+            dec->nbits -= len;
+            return huff->val[huff->valoff[len] + code];
+        }
+    }
+
+    return -1;
+}
+
+/* the value of s extra bits, negative when the first bit is 0 */
+static inline int jpeg_extend(jpeg_dec_t *dec, int s)
+{
+    int v = jpeg_get_bits(dec, s);
+
+    return (v < (1 << (s - 1))) ? (v - (1 << s) + 1) : v;
+}
+
+/* entropy decode and dequantize one block into coef, natural order */
+static int jpeg_decode_block(jpeg_dec_t *dec, jpeg_comp_t *c)
+{
+    const uint16_t *qt = dec->qt[c->tq];
+    int s;
+    int r;
+
+    memset(dec->coef, 0, sizeof(dec->coef));
+
+    s = jpeg_huff_decode(dec, &dec->huff[c->td]);
+    if (s < 0)
+        return WM_ERR_INVALID_PARAM;
+
+    c->dc_pred   += s ? jpeg_extend(dec, s) : 0;
+    dec->coef[0]  = c->dc_pred * qt[0];
+
+    for (int k = 1; k < 64; k++) {
+        s = jpeg_huff_decode(dec, &dec->huff[2 + c->ta]);
+        if (s < 0)
+            return WM_ERR_INVALID_PARAM;
+
+        r = s >> 4;
+        s &= 0x0F;
+
+        if (!s) {
+            /* end of block, or a run of 16 zeros */
+            if (r != 15)
+                break;
+            k += 15;
+            continue;
+        }
+
+        k += r;
+        if (k > 63)
+            return WM_ERR_INVALID_PARAM;
+
+        dec->coef[jpeg_zigzag[k]] = jpeg_extend(dec, s) * qt[k];
+    }
+
+    return WM_ERR_SUCCESS;
+}
+
+static inline uint8_t jpeg_clamp(int v)
+{
+    return (v < 0) ? 0 : ((v > 255) ? 255 : v);
+}
+
+static void jpeg_idct(const int16_t *in, uint8_t *out)
+{
+    int32_t ws[64];
+    int32_t tmp0, tmp1, tmp2, tmp3;
+    int32_t tmp10, tmp11, tmp12, tmp13;
+    int32_t z1, z2, z3, z4, z5;
+
+    /* columns, the result is scaled up by 2^PASS1_BITS */
+    for (int col = 0; col < 8; col++) {
+        const int16_t *p = in + col;
+        int32_t *w       = ws + col;
+
+        if (!p[8] && !p[16] && !p[24] && !p[32] && !p[40] && !p[48] && !p[56]) {
+            int32_t dc = p[0] * (1 << JPEG_PASS1_BITS);
+
+            for (int i = 0; i < 8; i++)
+                w[i * 8] = dc;
+            continue;
+        }
+
+        z2   = p[16];
+        z3   = p[48];
+        z1   = (z2 + z3) * JPEG_FIX_0_541196100;
+        tmp2 = z1 - z3 * JPEG_FIX_1_847759065;
+        tmp3 = z1 + z2 * JPEG_FIX_0_765366865;
+
+        z2   = p[0];
+        z3   = p[32];
+        tmp0 = (z2 + z3) * (1 << JPEG_CONST_BITS);
+        tmp1 = (z2 - z3) * (1 << JPEG_CONST_BITS);
+
+        tmp10 = tmp0 + tmp3;
+        tmp13 = tmp0 - tmp3;
+        tmp11 = tmp1 + tmp2;
+        tmp12 = tmp1 - tmp2;
+
+        tmp0 = p[56];
+        tmp1 = p[40];
+        tmp2 = p[24];
+        tmp3 = p[8];
+
+        z1 = tmp0 + tmp3;
+        z2 = tmp1 + tmp2;
+        z3 = tmp0 + tmp2;
+        z4 = tmp1 + tmp3;
+        z5 = (z3 + z4) * JPEG_FIX_1_175875602;
+
+        tmp0 *= JPEG_FIX_0_298631336;
+        tmp1 *= JPEG_FIX_2_053119869;
+        tmp2 *= JPEG_FIX_3_072711026;
+        tmp3 *= JPEG_FIX_1_501321110;
+        z1   *= -JPEG_FIX_0_899976223;
+        z2   *= -JPEG_FIX_2_562915447;
+        z3   *= -JPEG_FIX_1_961570560;
+        z4   *= -JPEG_FIX_0_390180644;
+
+        z3 += z5;
+        z4 += z5;
+
+        tmp0 += z1 + z3;
+        tmp1 += z2 + z4;
+        tmp2 += z2 + z3;
+        tmp3 += z1 + z4;
+
+        w[0]  = JPEG_DESCALE(tmp10 + tmp3, JPEG_CONST_BITS - JPEG_PASS1_BITS);
+        w[56] = JPEG_DESCALE(tmp10 - tmp3, JPEG_CONST_BITS - JPEG_PASS1_BITS);
+        w[8]  = JPEG_DESCALE(tmp11 + tmp2, JPEG_CONST_BITS - JPEG_PASS1_BITS);
+        w[48] = JPEG_DESCALE(tmp11 - tmp2, JPEG_CONST_BITS - JPEG_PASS1_BITS);
+        w[16] = JPEG_DESCALE(tmp12 + tmp1, JPEG_CONST_BITS - JPEG_PASS1_BITS);
+        w[40] = JPEG_DESCALE(tmp12 - tmp1, JPEG_CONST_BITS - JPEG_PASS1_BITS);
+        w[24] = JPEG_DESCALE(tmp13 + tmp0, JPEG_CONST_BITS - JPEG_PASS1_BITS);
+        w[32] = JPEG_DESCALE(tmp13 - tmp0, JPEG_CONST_BITS - JPEG_PASS1_BITS);
+    }
+
+    /* rows, remove the pass 1 scaling and the 8x of the transform, then level shift */
+    for (int row = 0; row < 8; row++) {
+        const int32_t *w = ws + row * 8;
+        uint8_t *o       = out + row * 8;
+
+        z2   = w[2];
+        z3   = w[6];
+        z1   = (z2 + z3) * JPEG_FIX_0_541196100;
+        tmp2 = z1 - z3 * JPEG_FIX_1_847759065;
+        tmp3 = z1 + z2 * JPEG_FIX_0_765366865;
+
+        tmp0 = (w[0] + w[4]) * (1 << JPEG_CONST_BITS);
+        tmp1 = (w[0] - w[4]) * (1 << JPEG_CONST_BITS);
+
+        tmp10 = tmp0 + tmp3;
+        tmp13 = tmp0 - tmp3;
+        tmp11 = tmp1 + tmp2;
+        tmp12 = tmp1 - tmp2;
+
+        tmp0 = w[7];
+        tmp1 = w[5];
+        tmp2 = w[3];
+        tmp3 = w[1];
+
+        z1 = tmp0 + tmp3;
+        z2 = tmp1 + tmp2;
+        z3 = tmp0 + tmp2;
+        z4 = tmp1 + tmp3;
+        z5 = (z3 + z4) * JPEG_FIX_1_175875602;
+
+        tmp0 *= JPEG_FIX_0_298631336;
+        tmp1 *= JPEG_FIX_2_053119869;
+        tmp2 *= JPEG_FIX_3_072711026;
+        tmp3 *= JPEG_FIX_1_501321110;
+        z1   *= -JPEG_FIX_0_899976223;
+        z2   *= -JPEG_FIX_2_562915447;
+        z3   *= -JPEG_FIX_1_961570560;
+        z4   *= -JPEG_FIX_0_390180644;
+
+        z3 += z5;
+        z4 += z5;
+
+        tmp0 += z1 + z3;
+        tmp1 += z2 + z4;
+        tmp2 += z2 + z3;
+        tmp3 += z1 + z4;
+
+        o[0] = jpeg_clamp(JPEG_DESCALE(tmp10 + tmp3, JPEG_CONST_BITS + JPEG_PASS1_BITS + 3) + 128);
+        o[7] = jpeg_clamp(JPEG_DESCALE(tmp10 - tmp3, JPEG_CONST_BITS + JPEG_PASS1_BITS + 3) + 128);
+        o[1] = jpeg_clamp(JPEG_DESCALE(tmp11 + tmp2, JPEG_CONST_BITS + JPEG_PASS1_BITS + 3) + 128);
+        o[6] = jpeg_clamp(JPEG_DESCALE(tmp11 - tmp2, JPEG_CONST_BITS + JPEG_PASS1_BITS + 3) + 128);
+        o[2] = jpeg_clamp(JPEG_DESCALE(tmp12 + tmp1, JPEG_CONST_BITS + JPEG_PASS1_BITS + 3) + 128);
+        o[5] = jpeg_clamp(JPEG_DESCALE(tmp12 - tmp1, JPEG_CONST_BITS + JPEG_PASS1_BITS + 3) + 128);
+        o[3] = jpeg_clamp(JPEG_DESCALE(tmp13 + tmp0, JPEG_CONST_BITS + JPEG_PASS1_BITS + 3) + 128);
+        o[4] = jpeg_clamp(JPEG_DESCALE(tmp13 - tmp0, JPEG_CONST_BITS + JPEG_PASS1_BITS + 3) + 128);
+    }
+}
+
+/* convert the decoded mcu into rgb565 at dst, clipped to w x h pixels, pitch bytes per line */
+static void jpeg_mcu_to_rgb565(jpeg_dec_t *dec, uint8_t *dst, uint32_t pitch, uint16_t w, uint16_t h)
+{
+    uint8_t hs = dec->comp[0].h;
+    uint8_t vs = dec->comp[0].v;
+    int y, cb, cr, r, g, b;
+
+    for (uint16_t py = 0; py < h; py++) {
+        uint8_t *d = dst + py * pitch;
+
+        for (uint16_t px = 0; px < w; px++) {
+            /* luma blocks are stored left to right, top to bottom, chroma is upsampled by repetition */
+            y = dec->sample[(py >> 3) * hs + (px >> 3)][(py & 7) * 8 + (px & 7)];
+
+            if (dec->ncomp == 1) {
+                r = g = b = y;
+            } else {
+                int ci = (py >> (vs - 1)) * 8 + (px >> (hs - 1));
+
+                cb = dec->sample[hs * vs][ci] - 128;
+                cr = dec->sample[hs * vs + 1][ci] - 128;
+
+                r = jpeg_clamp(y + ((JPEG_CR_R * cr + JPEG_ONE_HALF) >> 16));
+                g = jpeg_clamp(y + ((-JPEG_CB_G * cb - JPEG_CR_G * cr + JPEG_ONE_HALF) >> 16));
+                b = jpeg_clamp(y + ((JPEG_CB_B * cb + JPEG_ONE_HALF) >> 16));
+            }
+
+            d[0] = (uint8_t)((r & 0xF8) | (g >> 5));
+            d[1] = (uint8_t)(((g & 0x1C) << 3) | (b >> 3));
+            d   += 2;
+        }
+    }
+}
+
+static int jpeg_decode_mcu(jpeg_dec_t *dec)
+{
+    jpeg_comp_t *c;
+    int block = 0;
+    int ret;
+
+    for (int i = 0; i < dec->ncomp; i++) {
+        c = &dec->comp[i];
+
+        for (int n = 0; n < c->h * c->v; n++) {
+            ret = jpeg_decode_block(dec, c);
+            if (ret != WM_ERR_SUCCESS)
+                return ret;
+
+            jpeg_idct(dec->coef, dec->sample[block++]);
+        }
+    }
+
+    return WM_ERR_SUCCESS;
+}
+
+/* at a restart interval: drop the rest of the byte, expect RSTn and reset the predictions */
+static int jpeg_restart(jpeg_dec_t *dec)
+{
+    int b;
+
+    dec->nbits = 0;
+    dec->bits  = 0;
+
+    if (!dec->marker) {
+        /* the marker has not been met by the bit reader yet */
+        do {
+            b = jpeg_byte(dec);
+        } while ((b >= 0) && (b != 0xFF));
+
+        do {
+            b = jpeg_byte(dec);
+        } while (b == 0xFF);
+
+        dec->marker = (b < 0) ? JPEG_M_EOI : b;
+    }
+
+    if ((dec->marker < JPEG_M_RST0) || (dec->marker > JPEG_M_RST7))
+        return WM_ERR_INVALID_PARAM;
+
+    dec->marker = 0;
+    for (int i = 0; i < dec->ncomp; i++)
+        dec->comp[i].dc_pred = 0;
+
+    return WM_ERR_SUCCESS;
+}
+
+int jpeg_decode(jpeg_dec_t *dec, uint8_t *buf, uint32_t buf_len, jpeg_output_t output, void *arg)
+{
+    uint32_t pitch     = dec->width * 2;
+    uint16_t mcus_x    = (dec->width + dec->mcu_w - 1) / dec->mcu_w;
+    uint16_t mcus_y    = (dec->height + dec->mcu_h - 1) / dec->mcu_h;
+    uint16_t band_rows = buf_len / (pitch * dec->mcu_h);
+    uint16_t restarts  = dec->restart_interval;
+    uint16_t y0        = 0;
+    uint16_t row_y;
+    uint16_t w;
+    uint16_t h;
+    int ret;
+
+    if (!band_rows)
+        return WM_ERR_NO_MEM;
+
+    for (uint16_t my = 0; my < mcus_y; my++) {
+        row_y = my * dec->mcu_h;
+        h     = (row_y + dec->mcu_h > dec->height) ? (dec->height - row_y) : dec->mcu_h;
+
+        for (uint16_t mx = 0; mx < mcus_x; mx++) {
+            if (dec->restart_interval) {
+                if (!restarts) {
+                    ret = jpeg_restart(dec);
+                    if (ret != WM_ERR_SUCCESS)
+                        return ret;
+                    restarts = dec->restart_interval;
+                }
+                restarts--;
+            }
+
+            ret = jpeg_decode_mcu(dec);
+            if (ret != WM_ERR_SUCCESS)
+                return ret;
+
+            w = (mx * dec->mcu_w + dec->mcu_w > dec->width) ? (dec->width - mx * dec->mcu_w) : dec->mcu_w;
+            jpeg_mcu_to_rgb565(dec, buf + (row_y - y0) * pitch + mx * dec->mcu_w * 2, pitch, w, h);
+        }
+
+        /* hand the band over when it is full or the image is done */
+        if ((row_y + h - y0 + dec->mcu_h > band_rows * dec->mcu_h) || (my == mcus_y - 1)) {
+            ret = output(arg, y0, row_y + h - y0, buf);
+            if (ret != WM_ERR_SUCCESS)
+                return ret;
+            y0 = row_y + h;
+        }
+    }
+
+    return WM_ERR_SUCCESS;
+}
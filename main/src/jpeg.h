@@ -0,0 +1,77 @@
+#ifndef __JPEG_H__
+#define __JPEG_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* input is pulled through a buffer of this size, one sd block */
+#define JPEG_INBUF_SIZE                512
+/* huffman codes up to this length are decoded with one table lookup */
+#define JPEG_LOOKAHEAD_BITS            8
+
+/* fill buf with up to len bytes of the file, return the count, 0 at the end or a negative error */
+typedef int (*jpeg_read_t)(void *arg, uint8_t *buf, uint32_t len);
+/* lines [y, y + lines) of the image are ready in buf, rgb565 high byte first, image width pixels per line */
+typedef int (*jpeg_output_t)(void *arg, uint16_t y, uint16_t lines, const uint8_t *buf);
+
+typedef struct {
+    uint8_t look_len[1 << JPEG_LOOKAHEAD_BITS]; /**< 0 when the code is longer than the lookahead */
+    uint8_t look_val[1 << JPEG_LOOKAHEAD_BITS];
+    int32_t maxcode[17];               /**< largest code of each length, -1 when there is none */
+    int32_t valoff[17];                /**< index into val of a code of each length, minus the code */
+    uint8_t val[256];
+} jpeg_huff_t;
+
+typedef struct {
+    uint8_t id;
+    uint8_t h;                         /**< sampling factors */
+    uint8_t v;
+    uint8_t tq;                        /**< quantization table */
+    uint8_t td;                        /**< dc and ac huffman tables */
+    uint8_t ta;
+    int16_t dc_pred;
+} jpeg_comp_t;
+
+/* the whole decoder state, about 5 KB, the output lines go to a buffer given by the caller */
+typedef struct {
+    uint16_t width;
+    uint16_t height;
+    uint8_t mcu_w;                     /**< pixels of one mcu, 8 or 16 */
+    uint8_t mcu_h;
+
+    /* internal */
+    jpeg_read_t read;
+    void *arg;
+    uint8_t in[JPEG_INBUF_SIZE];
+    uint16_t in_pos;
+    uint16_t in_len;
+    bool in_end;
+
+    uint32_t bits;                     /**< bit buffer, the valid bits are the lowest nbits */
+    int8_t nbits;
+    uint8_t marker;                    /**< marker met inside entropy data, 0 when none */
+
+    uint8_t ncomp;
+    uint16_t restart_interval;
+    jpeg_comp_t comp[3];
+    uint16_t qt[4][64];                /**< in zigzag order */
+    jpeg_huff_t huff[4];               /**< dc 0, dc 1, ac 0, ac 1 */
+    int16_t coef[64];
+    uint8_t sample[6][64];             /**< idct output of the blocks of one mcu */
+} jpeg_dec_t;
+
+/* read the headers up to the start of scan, fills width, height and the mcu size */
+int jpeg_decode_header(jpeg_dec_t *dec, jpeg_read_t read, void *arg);
+
+/* decode the image, buf gets as many mcu rows as fit before each output call, it must hold at least one */
+int jpeg_decode(jpeg_dec_t *dec, uint8_t *buf, uint32_t buf_len, jpeg_output_t output, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JPEG_H__ */
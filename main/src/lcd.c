@@ -0,0 +1,569 @@
+#include <stdio.h>
+#include <string.h>
+#include "wmsdk_config.h"
+#include "wm_drv_tft_lcd.h"
+#include "wm_drv_sdh_spi.h"
+#include "wm_heap.h"
+#include "freertos/FreeRTOS.h"
+#include "wm_cli.h"
+#include "image.h"
+#include "font.h"
+#include "lcd.h"
+#include "pixel.h"
+#include "display.h"
+#include "sdio.h"
+
+#define LOG_TAG "lcd"
+#include "wm_log.h"
+
+/* panel commands used to stream one window, standard for the nv3041a and other mipi dbi panels */
+#define LCD_CMD_CASET                  0x2A
+#define LCD_CMD_RASET                  0x2B
+#define LCD_CMD_RAMWR                  0x2C
+#define LCD_CMD_RAMWRC                 0x3C
+#define LCD_CMD_VSCRDEF                0x33
+#define LCD_CMD_VSCRSADD               0x37
+
+wm_device_t *lcd_get_device(void)
+{
+    int ret;
+    wm_device_t *dev;
+
+    dev = wm_dt_get_device_by_name("sdspi");
+    if (!(dev && (WM_DEV_ST_INITED == dev->state)))
+        dev = wm_drv_sdh_spi_init("sdspi");
+
+    if (!dev) {
+        wm_log_error("init sdspi fail.");
+        return NULL;
+    }
+
+    dev = wm_dt_get_device_by_name("nv3041a_spi");
+    if (!(dev && (WM_DEV_ST_INITED == dev->state))) {
+        dev = wm_drv_tft_lcd_init("nv3041a_spi");
+        if (dev) {
+            ret = wm_drv_tft_lcd_set_backlight(dev, true);
+            if (ret != WM_ERR_SUCCESS) {
+                wm_log_error("lcd bl set fail.");
+            }
+        } else {
+            wm_log_error("init lcd fail.");
+        }
+    }
+
+    return dev;
+}
+
+static void *lcd_band_try_alloc(uint32_t size, bool *psram)
+{
+    void *buf = NULL;
+
+#if CONFIG_COMPONENT_DRIVER_PSRAM_ENABLED
+    /* keep the internal heap for the rest of the system when psram is there */
+    buf = wm_heap_caps_alloc(size, WM_HEAP_CAP_SPIRAM);
+    if (buf) {
+        *psram = true;
+        return buf;
+    }
+#endif
+
+    *psram = false;
+
+    return malloc(size);
+}
+
+/* back to the heap it came from */
+static void lcd_band_release(void *buf, bool psram)
+{
+#if CONFIG_COMPONENT_DRIVER_PSRAM_ENABLED
+    if (psram) {
+        wm_heap_caps_free(buf);
+        return;
+    }
+#endif
+
+    free(buf);
+}
+
+int lcd_band_alloc(lcd_band_t *band, uint32_t line_size, uint16_t max_lines, uint32_t extra)
+{
+    uint32_t budget;
+    uint16_t lines;
+
+    memset(band, 0, sizeof(*band));
+
+    if (!line_size || !max_lines)
+        return WM_ERR_INVALID_PARAM;
+
+    /* one transfer never needs more than the dma can move at once */
+    lines = max_lines;
+    if (lines * line_size > LCD_DMA_MAX_BYTES)
+        lines = LCD_DMA_MAX_BYTES / line_size;
+    if (!lines)
+        lines = 1;
+
+    while (lines) {
+        band->buf = lcd_band_try_alloc(lines * line_size + extra, &band->psram);
+        if (band->buf && !band->psram) {
+            /* the largest free block may be big, but the band must not eat the heap */
+            budget = (xPortGetFreeHeapSize() + lines * line_size + extra) * LCD_BAND_HEAP_BUDGET_PCT / 100;
+            if ((lines * line_size + extra > budget) && (lines > 1)) {
+                lcd_band_release(band->buf, band->psram);
+                band->buf = NULL;
+            }
+        }
+
+        if (band->buf)
+            break;
+
+        lines /= 2;
+    }
+
+    if (!band->buf) {
+        wm_log_error("no memory for a %u bytes band", line_size + extra);
+        return WM_ERR_NO_MEM;
+    }
+
+    band->lines = lines;
+    band->len   = lines * line_size + extra;
+
+    wm_log_debug("band %u lines, %u bytes in %s", band->lines, band->len, band->psram ? "psram" : "sram");
+
+    return WM_ERR_SUCCESS;
+}
+
+void lcd_band_free(lcd_band_t *band)
+{
+    if (band->buf)
+        lcd_band_release(band->buf, band->psram);
+
+    memset(band, 0, sizeof(*band));
+}
+
+/* every transfer to the panel holds the sdio lock, the card is on the same controller */
+static int lcd_set_cmd(wm_device_t *dev, uint8_t cmd, uint8_t *param, uint32_t len)
+{
+    int ret;
+
+    sdio_lock();
+    ret = wm_drv_tft_lcd_set_cmd(dev, cmd, param, len);
+    sdio_unlock();
+
+    return ret;
+}
+
+static int lcd_draw_bitmap(wm_device_t *dev, wm_lcd_data_desc_t data_desc)
+{
+    int ret;
+
+    sdio_lock();
+    ret = wm_drv_tft_lcd_draw_bitmap(dev, data_desc);
+    sdio_unlock();
+
+    return ret;
+}
+
+static int lcd_set_window(wm_device_t *dev, uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+    uint8_t param[4];
+    int ret;
+
+    param[0] = (uint8_t)(x >> 8);
+    param[1] = (uint8_t)(x & 0x00FF);
+    param[2] = (uint8_t)((x + w - 1) >> 8);
+    param[3] = (uint8_t)((x + w - 1) & 0x00FF);
+
+    ret = lcd_set_cmd(dev, LCD_CMD_CASET, param, sizeof(param));
+    if (ret != WM_ERR_SUCCESS)
+        return ret;
+
+    param[0] = (uint8_t)(y >> 8);
+    param[1] = (uint8_t)(y & 0x00FF);
+    param[2] = (uint8_t)((y + h - 1) >> 8);
+    param[3] = (uint8_t)((y + h - 1) & 0x00FF);
+
+    return lcd_set_cmd(dev, LCD_CMD_RASET, param, sizeof(param));
+}
+
+int lcd_stream_begin(lcd_stream_t *stream, wm_device_t *dev, uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+    if (!stream || !dev || !w || !h)
+        return WM_ERR_INVALID_PARAM;
+
+    memset(stream, 0, sizeof(*stream));
+
+    stream->dev       = dev;
+    stream->x         = x;
+    stream->y         = y;
+    stream->w         = w;
+    stream->h         = h;
+    stream->line_size = w * WM_CFG_TFT_LCD_PIXEL_WIDTH;
+
+    if (stream->line_size > LCD_DMA_MAX_BYTES)
+        return WM_ERR_INVALID_PARAM;
+
+    /* the window is set once here, the writes only carry pixels */
+    stream->window = (lcd_set_window(dev, x, y, w, h) == WM_ERR_SUCCESS);
+    if (!stream->window) {
+        wm_log_debug("raw window refused, one window per band");
+    }
+
+    return WM_ERR_SUCCESS;
+}
+
+int lcd_stream_write(lcd_stream_t *stream, const uint8_t *data, uint32_t len)
+{
+    wm_lcd_data_desc_t data_desc = { 0 };
+    uint16_t lines;
+    uint16_t chunk;
+    uint16_t n;
+    int ret                      = WM_ERR_SUCCESS;
+
+    if (!stream->line_size || !data || !len || (len % stream->line_size))
+        return WM_ERR_INVALID_PARAM;
+
+    lines = len / stream->line_size;
+    chunk = LCD_DMA_MAX_BYTES / stream->line_size;
+    if (stream->row + lines > stream->h)
+        return WM_ERR_INVALID_PARAM;
+
+    while (lines) {
+        n = (lines > chunk) ? chunk : lines;
+
+        if (stream->window) {
+            /* the first write restarts at the window origin, the others continue where the panel stopped */
+            ret = lcd_set_cmd(stream->dev, stream->row ? LCD_CMD_RAMWRC : LCD_CMD_RAMWR, (uint8_t *)data,
+                              n * stream->line_size);
+            if (ret != WM_ERR_SUCCESS) {
+                if (stream->row)
+                    return ret;
+                wm_log_debug("raw write refused, one window per band");
+                stream->window = false;
+            }
+        }
+
+        if (!stream->window) {
+            data_desc.x_start  = stream->x;
+            data_desc.x_end    = stream->x + stream->w - 1;
+            data_desc.y_start  = stream->y + stream->row;
+            data_desc.y_end    = stream->y + stream->row + n - 1;
+            data_desc.buf      = (uint8_t *)data;
+            data_desc.buf_size = n * stream->line_size;
+
+            ret = lcd_draw_bitmap(stream->dev, data_desc);
+            if (ret != WM_ERR_SUCCESS)
+                return ret;
+        }
+
+        data        += n * stream->line_size;
+        stream->row += n;
+        lines       -= n;
+    }
+
+    return ret;
+}
+
+int lcd_stream_end(lcd_stream_t *stream)
+{
+    if (stream->row != stream->h) {
+        wm_log_warn("stream ended at line %u of %u", stream->row, stream->h);
+        return WM_ERR_FAILED;
+    }
+
+    return WM_ERR_SUCCESS;
+}
+
+int lcd_set_scroll_area(wm_device_t *dev, uint16_t top, uint16_t height, uint16_t bottom)
+{
+    uint8_t param[6];
+
+    param[0] = (uint8_t)(top >> 8);
+    param[1] = (uint8_t)(top & 0x00FF);
+    param[2] = (uint8_t)(height >> 8);
+    param[3] = (uint8_t)(height & 0x00FF);
+    param[4] = (uint8_t)(bottom >> 8);
+    param[5] = (uint8_t)(bottom & 0x00FF);
+
+    return lcd_set_cmd(dev, LCD_CMD_VSCRDEF, param, sizeof(param));
+}
+
+int lcd_set_scroll_start(wm_device_t *dev, uint16_t line)
+{
+    uint8_t param[2];
+
+    param[0] = (uint8_t)(line >> 8);
+    param[1] = (uint8_t)(line & 0x00FF);
+
+    return lcd_set_cmd(dev, LCD_CMD_VSCRSADD, param, sizeof(param));
+}
+
+int lcd_clean_screen(wm_device_t *dev, uint8_t *buf, uint32_t buf_len, uint16_t bk_color)
+{
+    wm_lcd_capabilitys_t cap     = { 0 };
+
+    wm_drv_tft_lcd_get_capability(dev, &cap);
+
+    return lcd_fill_rect(dev, buf, buf_len, 0, 0, cap.x_resolution, cap.y_resolution, bk_color);
+}
+
+int lcd_draw_image(wm_device_t *dev, uint8_t *buf, uint32_t buf_len, uint16_t x, uint16_t y, image_attr_t img)
+{
+    lcd_stream_t stream;
+    uint16_t width               = 0;
+    uint16_t high                = 0;
+    uint32_t line_size           = 0;
+    uint16_t lines               = 0;
+    uint16_t n;
+    int ret                      = WM_ERR_SUCCESS;
+
+    width     = img.image_width;
+    high      = img.image_high;
+    line_size = width * WM_CFG_TFT_LCD_PIXEL_WIDTH;
+
+    ret = lcd_stream_begin(&stream, dev, x, y, width, high);
+    if (ret != WM_ERR_SUCCESS)
+        return ret;
+
+    /* an image already in ram goes out straight from its source, the stream splits it as the dma needs,
+     * otherwise it is copied through the band buffer */
+    if (LCD_DMA_CAPABLE(img.image_buf)) {
+        ret = lcd_stream_write(&stream, img.image_buf, high * line_size);
+    } else {
+        if (buf)
+            lines = buf_len / line_size;
+        if (!lines)
+            return WM_ERR_INVALID_PARAM;
+
+        for (uint16_t i = 0; (i < high) && (ret == WM_ERR_SUCCESS); i += n) {
+            n = (i + lines > high) ? (high - i) : lines;
+
+            memcpy(buf, img.image_buf + i * line_size, n * line_size);
+            wm_log_debug("buf=%p, size=%d", buf, n * line_size);
+
+            ret = lcd_stream_write(&stream, buf, n * line_size);
+        }
+    }
+
+    if (ret != WM_ERR_SUCCESS) {
+        wm_log_error("lcd_draw_image ret=%d", ret);
+        return ret;
+    }
+
+    return lcd_stream_end(&stream);
+}
+
+int lcd_show_image(wm_device_t *dev, uint8_t *buf, uint32_t buf_len, image_attr_t img)
+{
+    return lcd_draw_image(dev, buf, buf_len, 0, 0, img);
+}
+
+int lcd_fill_rect(wm_device_t *dev, uint8_t *buf, uint32_t buf_len,
+                  uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color)
+{
+    lcd_stream_t stream;
+    uint32_t line_size           = w * WM_CFG_TFT_LCD_PIXEL_WIDTH;
+    uint16_t lines;
+    uint16_t n;
+    int ret                      = WM_ERR_SUCCESS;
+
+    if (!w || !h || (buf_len < line_size))
+        return WM_ERR_INVALID_PARAM;
+
+    lines = buf_len / line_size;
+    if (lines > h)
+        lines = h;
+
+    pixel_fill(buf, color, lines * w);
+
+    ret = lcd_stream_begin(&stream, dev, x, y, w, h);
+    if (ret != WM_ERR_SUCCESS)
+        return ret;
+
+    /* the same band is sent again and again into the one window */
+    for (uint16_t i = 0; i < h; i += n) {
+        n = (i + lines > h) ? (h - i) : lines;
+
+        ret = lcd_stream_write(&stream, buf, n * line_size);
+        if (ret != WM_ERR_SUCCESS) {
+            wm_log_error("lcd_fill_rect ret=%d", ret);
+            return ret;
+        }
+    }
+
+    return lcd_stream_end(&stream);
+}
+
+/* expand the glyphs of one text band into buf, rows [row_start, row_start + rows) of the scaled text */
+void lcd_render_string(uint8_t *buf, const char *str, uint16_t len, uint8_t scale,
+                       uint16_t row_start, uint16_t rows, uint16_t fg, uint16_t bg)
+{
+    uint16_t width = len * LCD_CHAR_WIDTH * scale;
+    uint8_t *p     = buf;
+
+    for (uint16_t row = row_start; row < row_start + rows; row++) {
+        uint8_t font_row = row / scale;
+
+        for (uint16_t col = 0; col < width; col++) {
+            uint8_t ch        = (uint8_t)str[col / (LCD_CHAR_WIDTH * scale)];
+            uint8_t font_col  = (col / scale) % LCD_CHAR_WIDTH;
+            uint16_t color    = bg;
+
+            if ((font_col < FONT_WIDTH) && (ch >= FONT_FIRST_CHAR) && (ch <= FONT_LAST_CHAR)) {
+                if (font_5x7[ch - FONT_FIRST_CHAR][font_col] & (1 << font_row))
+                    color = fg;
+            }
+
+            *p++ = (uint8_t)(color >> 8);
+            *p++ = (uint8_t)(color & 0x00FF);
+        }
+    }
+}
+
+int lcd_draw_string(wm_device_t *dev, uint8_t *buf, uint32_t buf_len,
+                    uint16_t x, uint16_t y, const char *str, uint8_t scale, uint16_t fg, uint16_t bg)
+{
+    wm_lcd_data_desc_t data_desc = { 0 };
+    wm_lcd_capabilitys_t cap     = { 0 };
+    uint16_t len                 = strlen(str);
+    uint16_t high                = LCD_CHAR_HEIGHT * scale;
+    uint32_t line_size;
+    uint16_t lines;
+    int ret                      = WM_ERR_SUCCESS;
+
+    if (!len || !scale)
+        return WM_ERR_INVALID_PARAM;
+
+    wm_drv_tft_lcd_get_capability(dev, &cap);
+
+    /* clip the text at the right edge of the screen */
+    if (x >= cap.x_resolution)
+        return WM_ERR_INVALID_PARAM;
+    if (x + len * LCD_CHAR_WIDTH * scale > cap.x_resolution)
+        len = (cap.x_resolution - x) / (LCD_CHAR_WIDTH * scale);
+    if (!len)
+        return WM_ERR_INVALID_PARAM;
+
+    line_size = len * LCD_CHAR_WIDTH * scale * WM_CFG_TFT_LCD_PIXEL_WIDTH;
+    if (buf_len < line_size)
+        return WM_ERR_NO_MEM;
+
+    lines = buf_len / line_size;
+    if (lines > high)
+        lines = high;
+
+    for (uint16_t i = 0; i < high;) {
+        data_desc.x_start  = x;
+        data_desc.x_end    = x + len * LCD_CHAR_WIDTH * scale - 1;
+        data_desc.y_start  = y + i;
+        data_desc.y_end    = (i + lines > high) ? (y + high - 1) : (y + i + lines - 1);
+        data_desc.buf      = buf;
+        data_desc.buf_size = (data_desc.y_end - data_desc.y_start + 1) * line_size;
+
+        lcd_render_string(buf, str, len, scale, i, data_desc.y_end - data_desc.y_start + 1, fg, bg);
+
+        ret = lcd_draw_bitmap(dev, data_desc);
+        if (ret != WM_ERR_SUCCESS) {
+            wm_log_error("lcd_draw_string ret=%d", ret);
+            break;
+        }
+
+        i = data_desc.y_end - y + 1;
+    }
+
+    return ret;
+}
+
+int lcd_flush_area(wm_device_t *dev, uint8_t *buf, uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+    wm_lcd_data_desc_t data_desc = { 0 };
+
+    data_desc.x_start  = x;
+    data_desc.x_end    = x + w - 1;
+    data_desc.y_start  = y;
+    data_desc.y_end    = y + h - 1;
+    data_desc.buf      = buf;
+    data_desc.buf_size = w * h * WM_CFG_TFT_LCD_PIXEL_WIDTH;
+
+    return lcd_draw_bitmap(dev, data_desc);
+}
+
+static void cmd_lcd(int argc, char *argv[])
+{
+    int ret = WM_ERR_FAILED;
+    wm_device_t *dev    = NULL;
+    wm_lcd_capabilitys_t cap = { 0 };
+    uint16_t bk_color;
+
+    if (argc < 2)
+        return;
+
+    dev = lcd_get_device();
+    if (!dev)
+        return;
+
+    /* screen updates go through the display service, the command returns once they are queued */
+    if (!strcmp("on", argv[1])) {
+        /* turn on the backlight*/
+        ret = display_backlight(true);
+        if (ret != WM_ERR_SUCCESS) {
+            wm_log_error("lcd bl set on fail.");
+        }
+    } else if (!strcmp("off", argv[1])) {
+        /* turn off the backlight*/
+        ret = display_backlight(false);
+        if (ret != WM_ERR_SUCCESS) {
+            wm_log_error("lcd bl set off fail.");
+        }
+    } else if (!strcmp("show", argv[1])) {
+        /* stream an image from the sd card, [count] repeats it to measure the sustained rate */
+        if (argc < 3)
+            return;
+
+        display_lock();
+        ret = lcd_show_sd_image(dev, atoi(argv[2]), (argc > 3) ? atoi(argv[3]) : 1);
+        display_unlock();
+        if (ret != WM_ERR_SUCCESS) {
+            wm_log_error("lcd_show_sd_image ret=%d", ret);
+        }
+    }  else if (strstr("image | red | green | blue | black | white | cyan | magenta | yellow", argv[1])) {
+        /* show LCD capability */
+        wm_drv_tft_lcd_get_capability(dev, &cap);
+        wm_log_debug("LCD x_resolution = %d", cap.x_resolution);
+        wm_log_debug("LCD y_resolution = %d", cap.y_resolution);
+        wm_log_debug("LCD rotation = %d", cap.rotation);
+
+        wm_log_debug("wm_lcd_demo show %s background", argv[1]);
+
+        if (!strcmp("image", argv[1])) {
+            ret = display_image(0, 0, 480, 272, image_hello_world_480x272);//image_bluesky_480x272;
+            if (ret != WM_ERR_SUCCESS) {
+                wm_log_error("display_image ret=%d", ret);
+            }
+            return;
+        } else if (!strcmp("red", argv[1])) {
+            bk_color = LCD_RGB565_RED;
+        } else if (!strcmp("green", argv[1])) {
+            bk_color = LCD_RGB565_GREEN;
+        } else if (!strcmp("blue", argv[1])) {
+            bk_color = LCD_RGB565_BLUE;
+        } else if (!strcmp("black", argv[1])) {
+            bk_color = LCD_RGB565_BLACK;
+        } else if (!strcmp("white", argv[1])) {
+            bk_color = LCD_RGB565_WHITE;
+        } else if (!strcmp("cyan", argv[1])) {
+            bk_color = LCD_RGB565_CYAN;
+        } else if (!strcmp("magenta", argv[1])) {
+            bk_color = LCD_RGB565_MAGENTA;
+        } else if (!strcmp("yellow", argv[1])) {
+            bk_color = LCD_RGB565_YELLOW;
+        } else {
+            return;
+        }
+
+        ret = display_fill_screen(bk_color);
+        if (ret != WM_ERR_SUCCESS) {
+            wm_log_error("display_fill_screen ret=%d", ret);
+        }
+    }
+}
+WM_CLI_CMD_DEFINE(lcd, cmd_lcd, lcd cmd, lcd <on | off | image | red | green | blue | black | white | cyan | magenta | yellow | show <start_block> [count]> -- toggle screen or clear screen and display solid color or image on sd card);
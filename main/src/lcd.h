@@ -0,0 +1,104 @@
+#ifndef __LCD_H__
+#define __LCD_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "wm_dt.h"
+#include "jpeg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* divide the image as many blocks, allocate one application buffer to send them one by one
+ * this is in order to use less memory for the screen refresh*/
+#define LCD_DATA_DRAW_LINE_UNIT        (40)
+
+/* largest single transfer handed to the lcd driver */
+#define LCD_DMA_MAX_BYTES              (65535)
+/* share of the free internal heap a band buffer may take */
+#define LCD_BAND_HEAP_BUDGET_PCT       (50)
+
+/* sram and psram can feed the dma directly, flash contents must be copied first */
+#define LCD_DMA_CAPABLE(p)             (((uintptr_t)(p) >= 0x20000000) && ((uintptr_t)(p) < 0x40000000))
+
+#define LCD_RGB565_BLACK               0x0000
+#define LCD_RGB565_BLUE                0x001F
+#define LCD_RGB565_RED                 0xF800
+#define LCD_RGB565_GREEN               0x07E0
+#define LCD_RGB565_CYAN                0x07FF
+#define LCD_RGB565_MAGENTA             0xF81F
+#define LCD_RGB565_YELLOW              0xFFE0
+#define LCD_RGB565_WHITE               0xFFFF
+#define LCD_RGB565_GRAY                0x8410
+
+/* character cell of the built-in font, before scaling */
+#define LCD_CHAR_WIDTH                 6
+#define LCD_CHAR_HEIGHT                8
+
+typedef struct {
+    const uint8_t *image_buf;
+    uint16_t image_width;
+    uint16_t image_high;
+    uint16_t image_size;
+} image_attr_t;
+
+/* built-in 480x272 images, defined in image.h */
+extern const unsigned char image_bluesky_480x272[];
+extern const unsigned char image_hello_world_480x272[];
+
+typedef struct {
+    uint8_t *buf;
+    uint32_t len;
+    uint16_t lines;                    /**< whole lines that fit in buf, not counting the extra bytes */
+    bool psram;
+} lcd_band_t;
+
+/* one address window filled by consecutive writes, the panel advances its own write pointer */
+typedef struct {
+    wm_device_t *dev;
+    uint16_t x;
+    uint16_t y;
+    uint16_t w;
+    uint16_t h;
+    uint16_t row;                      /**< lines written so far */
+    uint32_t line_size;
+    bool window;                       /**< false when raw commands are refused, bands then get their own window */
+} lcd_stream_t;
+
+wm_device_t *lcd_get_device(void);
+
+/* open a window once, then write it top to bottom in whole lines of any band height */
+int lcd_stream_begin(lcd_stream_t *stream, wm_device_t *dev, uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+int lcd_stream_write(lcd_stream_t *stream, const uint8_t *data, uint32_t len);
+int lcd_stream_end(lcd_stream_t *stream);
+
+/* hardware vertical scrolling, lines in panel rows: fixed top area, scrolled area and fixed bottom area
+ * must add up to the panel height, the start line is the memory row shown first in the scrolled area */
+int lcd_set_scroll_area(wm_device_t *dev, uint16_t top, uint16_t height, uint16_t bottom);
+int lcd_set_scroll_start(wm_device_t *dev, uint16_t line);
+
+int lcd_band_alloc(lcd_band_t *band, uint32_t line_size, uint16_t max_lines, uint32_t extra);
+void lcd_band_free(lcd_band_t *band);
+
+int lcd_clean_screen(wm_device_t *dev, uint8_t *buf, uint32_t buf_len, uint16_t bk_color);
+int lcd_show_image(wm_device_t *dev, uint8_t *buf, uint32_t buf_len, image_attr_t img);
+int lcd_draw_image(wm_device_t *dev, uint8_t *buf, uint32_t buf_len, uint16_t x, uint16_t y, image_attr_t img);
+int lcd_show_sd_image(wm_device_t *dev, uint32_t start_block, uint32_t count);
+/* decode a baseline jpeg pulled through read and show it centered, one band of mcu rows at a time */
+int lcd_show_jpeg(wm_device_t *dev, jpeg_read_t read, void *arg);
+
+int lcd_fill_rect(wm_device_t *dev, uint8_t *buf, uint32_t buf_len,
+                  uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color);
+int lcd_flush_area(wm_device_t *dev, uint8_t *buf, uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+
+void lcd_render_string(uint8_t *buf, const char *str, uint16_t len, uint8_t scale,
+                       uint16_t row_start, uint16_t rows, uint16_t fg, uint16_t bg);
+int lcd_draw_string(wm_device_t *dev, uint8_t *buf, uint32_t buf_len,
+                    uint16_t x, uint16_t y, const char *str, uint8_t scale, uint16_t fg, uint16_t bg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LCD_H__ */
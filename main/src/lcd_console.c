@@ -0,0 +1,387 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <reent.h>
+#include "wmsdk_config.h"
+#include "wm_drv_tft_lcd.h"
+#include "wm_cli.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "lcd.h"
+#include "display.h"
+#include "lcd_console.h"
+
+#define LOG_TAG "lcdcon"
+#include "wm_log.h"
+
+#define LCD_CONSOLE_TASK_STACK         1024
+#define LCD_CONSOLE_TASK_PRIO          1
+#define LCD_CONSOLE_QUEUE_LEN          16
+/* captured log and cli output waits here for the task, which looks every poll */
+#define LCD_CONSOLE_OUT_SIZE           1024
+#define LCD_CONSOLE_OUT_CHUNK          64
+#define LCD_CONSOLE_POLL_MS            50
+#define LCD_CONSOLE_STOP_MS            1000
+
+#define LCD_CONSOLE_FG_COLOR           LCD_RGB565_WHITE
+#define LCD_CONSOLE_BG_COLOR           LCD_RGB565_BLACK
+
+#define NOW_MS()                       (xTaskGetTickCount() * portTICK_PERIOD_MS)
+
+typedef struct {
+    char text[LCD_CONSOLE_COLS_MAX + 1]; /**< empty text with stop set wakes the task to exit */
+} lcd_console_line_t;
+
+typedef struct {
+    TaskHandle_t task;
+    QueueHandle_t queue;
+    volatile bool running;
+    wm_device_t *dev;
+
+    uint8_t scale;
+    uint16_t cols;
+    uint16_t rows;                     /**< text lines in the scrolled area */
+    uint16_t line_high;                /**< panel rows per text line */
+    uint16_t head;                     /**< text line in panel memory the next line goes to */
+    uint16_t filled;                   /**< text lines written since the start, up to rows */
+
+    char out[LCD_CONSOLE_OUT_SIZE];    /**< captured output, filled with interrupts masked */
+    uint16_t out_head;
+    uint16_t out_tail;
+    char partial[LCD_CONSOLE_COLS_MAX + 1]; /**< output line still waiting for its '\n' */
+    uint16_t partial_len;
+
+    uint32_t lines;                    /**< lines drawn */
+    uint32_t dropped;                  /**< lines lost because the queue was full */
+    uint32_t out_dropped;              /**< output bytes lost because the buffer was full */
+    uint32_t draw_ms;                  /**< time spent drawing lines */
+} lcd_console_ctx_t;
+
+static lcd_console_ctx_t g_con = { 0 };
+
+static int lcd_console_draw(lcd_band_t *band, const char *text)
+{
+    char line[LCD_CONSOLE_COLS_MAX + 1];
+    lcd_stream_t stream;
+    uint32_t line_size = g_con.cols * LCD_CHAR_WIDTH * g_con.scale * WM_CFG_TFT_LCD_PIXEL_WIDTH;
+    uint16_t n;
+    int ret;
+
+    /* pad to the full width so that the old line is overwritten */
+    snprintf(line, sizeof(line), "%-*.*s", g_con.cols, g_con.cols, text);
+
+    ret = lcd_stream_begin(&stream, g_con.dev, 0, g_con.head * g_con.line_high,
+                           g_con.cols * LCD_CHAR_WIDTH * g_con.scale, g_con.line_high);
+    if (ret != WM_ERR_SUCCESS)
+        return ret;
+
+    for (uint16_t row = 0; row < g_con.line_high; row += n) {
+        n = (row + band->lines > g_con.line_high) ? (g_con.line_high - row) : band->lines;
+
+        lcd_render_string(band->buf, line, g_con.cols, g_con.scale, row, n, LCD_CONSOLE_FG_COLOR, LCD_CONSOLE_BG_COLOR);
+
+        ret = lcd_stream_write(&stream, band->buf, n * line_size);
+        if (ret != WM_ERR_SUCCESS)
+            return ret;
+    }
+
+    ret = lcd_stream_end(&stream);
+    if (ret != WM_ERR_SUCCESS)
+        return ret;
+
+    /* once the area is full the line just drawn replaced the oldest one, scroll it to the bottom */
+    g_con.head = (g_con.head + 1) % g_con.rows;
+    if (g_con.filled < g_con.rows) {
+        g_con.filled++;
+        if (g_con.filled < g_con.rows)
+            return WM_ERR_SUCCESS;
+    }
+
+    return lcd_set_scroll_start(g_con.dev, g_con.head * g_con.line_high);
+}
+
+static void lcd_console_put(lcd_band_t *band, const char *text)
+{
+    uint32_t start = NOW_MS();
+    int ret;
+
+    display_lock();
+    ret = lcd_console_draw(band, text);
+    display_unlock();
+
+    g_con.draw_ms += NOW_MS() - start;
+    g_con.lines++;
+
+    if (ret != WM_ERR_SUCCESS) {
+        wm_log_error("draw line ret=%d", ret);
+    }
+}
+
+/* draw the captured output, a line goes out on its '\n' or when it reaches the console width */
+static void lcd_console_drain(lcd_band_t *band)
+{
+    char chunk[LCD_CONSOLE_OUT_CHUNK];
+    UBaseType_t mask;
+    uint32_t n;
+
+    do {
+        mask = taskENTER_CRITICAL_FROM_ISR();
+        for (n = 0; (n < sizeof(chunk)) && (g_con.out_tail != g_con.out_head); n++) {
+            chunk[n]       = g_con.out[g_con.out_tail];
+            g_con.out_tail = (g_con.out_tail + 1) % LCD_CONSOLE_OUT_SIZE;
+        }
+        taskEXIT_CRITICAL_FROM_ISR(mask);
+
+        for (uint32_t i = 0; i < n; i++) {
+            if ((chunk[i] != '\n') && (chunk[i] != '\r'))
+                g_con.partial[g_con.partial_len++] = chunk[i];
+
+            if ((chunk[i] == '\n') || (g_con.partial_len == g_con.cols)) {
+                g_con.partial[g_con.partial_len] = '\0';
+                g_con.partial_len                = 0;
+                lcd_console_put(band, g_con.partial);
+            }
+        }
+    } while (n == sizeof(chunk));
+}
+
+static void lcd_console_task(void *param)
+{
+    wm_lcd_capabilitys_t cap = { 0 };
+    lcd_console_line_t item;
+    lcd_band_t band          = { 0 };
+    int ret;
+
+    wm_drv_tft_lcd_get_capability(g_con.dev, &cap);
+
+    ret = lcd_band_alloc(&band, cap.x_resolution * WM_CFG_TFT_LCD_PIXEL_WIDTH, g_con.line_high, 0);
+    if (ret != WM_ERR_SUCCESS) {
+        wm_log_error("mem err");
+        goto exit;
+    }
+
+    /* scroll the text lines only, rows left below the last whole line stay fixed */
+    display_lock();
+    lcd_fill_rect(g_con.dev, band.buf, band.len, 0, 0, cap.x_resolution, cap.y_resolution, LCD_CONSOLE_BG_COLOR);
+    ret = lcd_set_scroll_area(g_con.dev, 0, g_con.rows * g_con.line_high, cap.y_resolution - g_con.rows * g_con.line_high);
+    if (ret == WM_ERR_SUCCESS)
+        ret = lcd_set_scroll_start(g_con.dev, 0);
+    display_unlock();
+
+    if (ret != WM_ERR_SUCCESS) {
+        wm_log_error("scroll setup ret=%d", ret);
+        goto exit;
+    }
+
+    while (g_con.running) {
+        if (xQueueReceive(g_con.queue, &item, pdMS_TO_TICKS(LCD_CONSOLE_POLL_MS)) == pdTRUE) {
+            if (!g_con.running)
+                break;
+            lcd_console_put(&band, item.text);
+        }
+
+        lcd_console_drain(&band);
+    }
+
+    /* leave the panel unscrolled for the other users */
+    display_lock();
+    lcd_set_scroll_start(g_con.dev, 0);
+    lcd_fill_rect(g_con.dev, band.buf, band.len, 0, 0, cap.x_resolution, cap.y_resolution, LCD_CONSOLE_BG_COLOR);
+    display_unlock();
+
+exit:
+    lcd_band_free(&band);
+    vQueueDelete(g_con.queue);
+    g_con.queue = NULL;
+
+    taskENTER_CRITICAL();
+    g_con.running = false;
+    g_con.task    = NULL;
+    taskEXIT_CRITICAL();
+
+    vTaskDelete(NULL);
+}
+
+static int lcd_console_wait_exit(void)
+{
+    uint32_t start = NOW_MS();
+
+    while (g_con.task) {
+        if (NOW_MS() - start > LCD_CONSOLE_STOP_MS)
+            return WM_ERR_TIMEOUT;
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    return WM_ERR_SUCCESS;
+}
+
+int lcd_console_start(uint8_t scale)
+{
+    wm_lcd_capabilitys_t cap = { 0 };
+
+    if (g_con.running)
+        return WM_ERR_SUCCESS;
+
+    /* a stopped console may still be clearing the panel */
+    if (lcd_console_wait_exit() != WM_ERR_SUCCESS)
+        return WM_ERR_BUSY;
+
+    if (!scale)
+        scale = 1;
+
+    g_con.dev = lcd_get_device();
+    if (!g_con.dev)
+        return WM_ERR_FAILED;
+
+    wm_drv_tft_lcd_get_capability(g_con.dev, &cap);
+
+    g_con.scale       = scale;
+    g_con.line_high   = LCD_CHAR_HEIGHT * scale;
+    g_con.cols        = cap.x_resolution / (LCD_CHAR_WIDTH * scale);
+    g_con.rows        = cap.y_resolution / g_con.line_high;
+    g_con.head        = 0;
+    g_con.filled      = 0;
+    g_con.out_head    = 0;
+    g_con.out_tail    = 0;
+    g_con.partial_len = 0;
+    if (g_con.cols > LCD_CONSOLE_COLS_MAX)
+        g_con.cols = LCD_CONSOLE_COLS_MAX;
+    if (!g_con.cols || (g_con.rows < 2))
+        return WM_ERR_INVALID_PARAM;
+
+    g_con.queue = xQueueCreate(LCD_CONSOLE_QUEUE_LEN, sizeof(lcd_console_line_t));
+    if (!g_con.queue)
+        return WM_ERR_NO_MEM;
+
+    g_con.running = true;
+    if (pdPASS != xTaskCreate(lcd_console_task, "lcdcon", LCD_CONSOLE_TASK_STACK, NULL, LCD_CONSOLE_TASK_PRIO, &g_con.task)) {
+        vQueueDelete(g_con.queue);
+        g_con.queue   = NULL;
+        g_con.running = false;
+        g_con.task    = NULL;
+        return WM_ERR_NO_MEM;
+    }
+
+    return WM_ERR_SUCCESS;
+}
+
+int lcd_console_stop(void)
+{
+    lcd_console_line_t item = { 0 };
+
+    if (g_con.running) {
+        g_con.running = false;
+        xQueueSend(g_con.queue, &item, 0);
+    }
+
+    return lcd_console_wait_exit();
+}
+
+int lcd_console_write(const char *str, uint32_t len)
+{
+    lcd_console_line_t item;
+    uint32_t n = 0;
+
+    if (!g_con.running || !g_con.queue)
+        return WM_ERR_FAILED;
+
+    while (len) {
+        /* one line per '\n', '\r' is dropped, longer lines are wrapped at the console width */
+        if ((*str == '\n') || (n == g_con.cols)) {
+            item.text[n] = '\0';
+            if (xQueueSend(g_con.queue, &item, 0) != pdTRUE)
+                g_con.dropped++;
+            n = 0;
+            if (*str == '\n') {
+                str++;
+                len--;
+            }
+            continue;
+        }
+
+        if (*str != '\r')
+            item.text[n++] = *str;
+        str++;
+        len--;
+    }
+
+    if (n) {
+        item.text[n] = '\0';
+        if (xQueueSend(g_con.queue, &item, 0) != pdTRUE)
+            g_con.dropped++;
+    }
+
+    return WM_ERR_SUCCESS;
+}
+
+int lcd_console_output(const char *str, uint32_t len)
+{
+    UBaseType_t mask;
+    uint16_t next;
+
+    if (!g_con.running)
+        return WM_ERR_FAILED;
+
+    mask = taskENTER_CRITICAL_FROM_ISR();
+    for (uint32_t i = 0; i < len; i++) {
+        next = (g_con.out_head + 1) % LCD_CONSOLE_OUT_SIZE;
+        if (next == g_con.out_tail) {
+            g_con.out_dropped += len - i;
+            break;
+        }
+        g_con.out[g_con.out_head] = str[i];
+        g_con.out_head            = next;
+    }
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+
+    return WM_ERR_SUCCESS;
+}
+
+/*
+ * Everything printed to stdout, wm_log and wm_cli_printf included, passes through newlib's
+ * _write_r; the link wraps it (-Wl,--wrap=_write_r in main/CMakeLists.txt) so the console sees
+ * a copy of it while it runs.
+ */
+_ssize_t __real__write_r(struct _reent *r, int fd, const void *buf, size_t len);
+
+_ssize_t __wrap__write_r(struct _reent *r, int fd, const void *buf, size_t len)
+{
+    /* not the console's own output, a line it fails to draw would log an error to draw */
+    if (((fd == STDOUT_FILENO) || (fd == STDERR_FILENO)) && g_con.running &&
+        (xTaskGetCurrentTaskHandle() != g_con.task))
+        lcd_console_output(buf, len);
+
+    return __real__write_r(r, fd, buf, len);
+}
+
+static void cmd_lcdcon(int argc, char *argv[])
+{
+    char line[LCD_CONSOLE_COLS_MAX + 1] = { 0 };
+    int ret;
+
+    if (argc < 2)
+        return;
+
+    if (!strcmp("on", argv[1])) {
+        ret = lcd_console_start((argc > 2) ? atoi(argv[2]) : 1);
+        if (ret != WM_ERR_SUCCESS) {
+            wm_log_error("lcd_console_start ret=%d", ret);
+        }
+    } else if (!strcmp("off", argv[1])) {
+        if (lcd_console_stop() != WM_ERR_SUCCESS)
+            wm_log_warn("task still running");
+    } else if (!strcmp("print", argv[1])) {
+        for (int i = 2; i < argc; i++) {
+            strncat(line, argv[i], sizeof(line) - strlen(line) - 1);
+            if (i < argc - 1)
+                strncat(line, " ", sizeof(line) - strlen(line) - 1);
+        }
+        lcd_console_write(line, strlen(line));
+    } else if (!strcmp("stat", argv[1])) {
+        wm_cli_printf("%ux%u chars, %u lines drawn, %u dropped, %u output bytes dropped, %u ms per line\r\n",
+                      g_con.cols, g_con.rows, g_con.lines, g_con.dropped, g_con.out_dropped,
+                      g_con.lines ? g_con.draw_ms / g_con.lines : 0);
+    }
+}
+WM_CLI_CMD_DEFINE(lcdcon, cmd_lcdcon, lcdcon cmd, lcdcon <on [scale] | off | print <text> | stat> -- scrolling text console on lcd);
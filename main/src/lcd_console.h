@@ -0,0 +1,35 @@
+#ifndef __LCD_CONSOLE_H__
+#define __LCD_CONSOLE_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* widest console, 480 pixels of 6-pixel characters at scale 1 */
+#define LCD_CONSOLE_COLS_MAX           80
+
+/*
+ * Scrolling text console on the lcd. New lines are drawn over the oldest one in panel memory
+ * and the hardware scroll start is moved, so a line costs one text band and one register write.
+ */
+int lcd_console_start(uint8_t scale);
+
+/* stop the console and wait for its task to clear the panel, WM_ERR_TIMEOUT if it does not */
+int lcd_console_stop(void);
+
+/* queue text for the console, every '\n' ends a line, text after the last '\n' is a line of its own.
+ * Never blocks, lines that do not fit in the queue are dropped and counted. */
+int lcd_console_write(const char *str, uint32_t len);
+
+/* copy printed output for the console, a line is drawn once its '\n' arrives. Safe from interrupts,
+ * it only copies into a buffer the task polls; what does not fit is dropped and counted.
+ * All stdout output, wm_log and wm_cli_printf, is passed here while the console runs. */
+int lcd_console_output(const char *str, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LCD_CONSOLE_H__ */
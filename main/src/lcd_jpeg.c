@@ -0,0 +1,286 @@
+#include <stdio.h>
+#include <string.h>
+#include "wmsdk_config.h"
+#include "wm_drv_tft_lcd.h"
+#include "wm_drv_sdh_sdmmc.h"
+#include "wm_cli.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+#include "lcd.h"
+#include "display.h"
+#include "jpeg.h"
+#include "sdio.h"
+
+#define LOG_TAG "lcd_jpeg"
+#include "wm_log.h"
+
+#define LCD_JPEG_SD_BLOCK_SIZE         512
+#define LCD_JPEG_HTTP_TIMEOUT_MS       5000
+#define LCD_JPEG_HTTP_HOST_MAX         64
+#define LCD_JPEG_HTTP_HEADER_MAX       1024
+
+#define NOW_MS()                       (xTaskGetTickCount() * portTICK_PERIOD_MS)
+
+typedef struct {
+    const uint8_t *data;
+    uint32_t len;
+    uint32_t pos;
+} lcd_jpeg_mem_t;
+
+typedef struct {
+    wm_device_t *sd_dev;
+    uint32_t block;                    /**< next block to read */
+} lcd_jpeg_sd_t;
+
+typedef struct {
+    wm_device_t *dev;
+    uint16_t x;                        /**< top left corner of the picture on the panel */
+    uint16_t y;
+    uint16_t w;
+    uint32_t lcd_ms;
+} lcd_jpeg_out_t;
+
+/* flash assets are memory mapped, so flash and ram share one source */
+static int lcd_jpeg_mem_read(void *arg, uint8_t *buf, uint32_t len)
+{
+    lcd_jpeg_mem_t *src = arg;
+    uint32_t n          = src->len - src->pos;
+
+    if (n > len)
+        n = len;
+
+    memcpy(buf, src->data + src->pos, n);
+    src->pos += n;
+
+    return n;
+}
+
+/* the decoder asks for one block at a time, the file ends where the decoder stops */
+static int lcd_jpeg_sd_read(void *arg, uint8_t *buf, uint32_t len)
+{
+    lcd_jpeg_sd_t *src = arg;
+    int ret;
+
+    if (len < LCD_JPEG_SD_BLOCK_SIZE)
+        return WM_ERR_INVALID_PARAM;
+
+    ret = sdio_read_blocks(src->sd_dev, buf, src->block, 1);
+    if (ret != WM_ERR_SUCCESS)
+        return ret;
+
+    src->block++;
+
+    return LCD_JPEG_SD_BLOCK_SIZE;
+}
+
+static int lcd_jpeg_http_read(void *arg, uint8_t *buf, uint32_t len)
+{
+    int s = (int)(intptr_t)arg;
+    int n = recv(s, buf, len, 0);
+
+    return (n < 0) ? WM_ERR_TIMEOUT : n;
+}
+
+/* GET url over http/1.0, return the socket positioned at the start of the body, or -1 */
+static int lcd_jpeg_http_open(const char *url)
+{
+    char host[LCD_JPEG_HTTP_HOST_MAX];
+    char port[6]             = "80";
+    char line[LCD_JPEG_HTTP_HEADER_MAX];
+    struct timeval timeout   = { LCD_JPEG_HTTP_TIMEOUT_MS / 1000, (LCD_JPEG_HTTP_TIMEOUT_MS % 1000) * 1000 };
+    struct addrinfo hint     = { 0 };
+    struct addrinfo *res     = NULL;
+    const char *path;
+    const char *p;
+    uint32_t n               = 0;
+    int s;
+
+    if (strncmp(url, "http://", 7))
+        return -1;
+    url += 7;
+
+    p    = strchr(url, '/');
+    n    = p ? (p - url) : strlen(url);
+    path = p ? p : "/";
+    if (!n || (n >= sizeof(host)))
+        return -1;
+    memcpy(host, url, n);
+    host[n] = '\0';
+
+    p = strchr(host, ':');
+    if (p) {
+        snprintf(port, sizeof(port), "%s", p + 1);
+        host[p - host] = '\0';
+    }
+
+    hint.ai_family   = AF_INET;
+    hint.ai_socktype = SOCK_STREAM;
+    if ((getaddrinfo(host, port, &hint, &res) != 0) || !res) {
+        wm_log_error("unknown host %s", host);
+        return -1;
+    }
+
+    s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s < 0) {
+        freeaddrinfo(res);
+        return -1;
+    }
+
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    if (connect(s, res->ai_addr, res->ai_addrlen) != 0) {
+        wm_log_error("connect %s:%s fail", host, port);
+        freeaddrinfo(res);
+        close(s);
+        return -1;
+    }
+    freeaddrinfo(res);
+
+    n = snprintf(line, sizeof(line), "GET %s HTTP/1.0\r\nHost: %s\r\nConnection: close\r\n\r\n", path, host);
+    if (send(s, line, n, 0) != (int)n) {
+        close(s);
+        return -1;
+    }
+
+    /* the headers are read a byte at a time so that no body byte is taken from the decoder */
+    n = 0;
+    while (n < sizeof(line) - 1) {
+        if (recv(s, &line[n], 1, 0) != 1)
+            break;
+        n++;
+        if ((n >= 4) && !memcmp(&line[n - 4], "\r\n\r\n", 4))
+            break;
+    }
+    line[n] = '\0';
+
+    if ((n < 12) || strncmp(line, "HTTP/1.", 7) || strncmp(&line[9], "200", 3) || strcmp(&line[n - 4], "\r\n\r\n")) {
+        wm_log_error("http: %.32s", line);
+        close(s);
+        return -1;
+    }
+
+    return s;
+}
+
+/* every band is its own window, the display is only held while it is sent, never while the source is read */
+static int lcd_jpeg_output(void *arg, uint16_t y, uint16_t lines, const uint8_t *buf)
+{
+    lcd_jpeg_out_t *out = arg;
+    lcd_stream_t stream;
+    uint32_t start      = NOW_MS();
+    int ret;
+
+    display_lock();
+    ret = lcd_stream_begin(&stream, out->dev, out->x, out->y + y, out->w, lines);
+    if (ret == WM_ERR_SUCCESS)
+        ret = lcd_stream_write(&stream, buf, lines * stream.line_size);
+    if (ret == WM_ERR_SUCCESS)
+        ret = lcd_stream_end(&stream);
+    display_unlock();
+
+    out->lcd_ms += NOW_MS() - start;
+
+    return ret;
+}
+
+int lcd_show_jpeg(wm_device_t *dev, jpeg_read_t read, void *arg)
+{
+    wm_lcd_capabilitys_t cap = { 0 };
+    lcd_jpeg_out_t out       = { 0 };
+    lcd_band_t band          = { 0 };
+    jpeg_dec_t *dec;
+    uint32_t start           = NOW_MS();
+    uint32_t elapsed;
+    int ret;
+
+    /* the decoder state is about 5 KB, keep it off the task stack */
+    dec = malloc(sizeof(jpeg_dec_t));
+    if (!dec)
+        return WM_ERR_NO_MEM;
+
+    ret = jpeg_decode_header(dec, read, arg);
+    if (ret != WM_ERR_SUCCESS) {
+        wm_log_error("not a baseline jpeg");
+        goto exit;
+    }
+
+    wm_drv_tft_lcd_get_capability(dev, &cap);
+    if ((dec->width > cap.x_resolution) || (dec->height > cap.y_resolution)) {
+        wm_log_error("%ux%u is larger than the screen", dec->width, dec->height);
+        ret = WM_ERR_INVALID_PARAM;
+        goto exit;
+    }
+
+    ret = lcd_band_alloc(&band, dec->width * WM_CFG_TFT_LCD_PIXEL_WIDTH,
+                         (dec->height + dec->mcu_h - 1) / dec->mcu_h * dec->mcu_h, 0);
+    if ((ret != WM_ERR_SUCCESS) || (band.lines < dec->mcu_h)) {
+        wm_log_error("mem err");
+        ret = WM_ERR_NO_MEM;
+        goto exit;
+    }
+
+    out.dev = dev;
+    out.x   = (cap.x_resolution - dec->width) / 2;
+    out.y   = (cap.y_resolution - dec->height) / 2;
+    out.w   = dec->width;
+
+    ret = jpeg_decode(dec, band.buf, band.len, lcd_jpeg_output, &out);
+
+    elapsed = NOW_MS() - start;
+    if (ret == WM_ERR_SUCCESS) {
+        wm_log_info("%ux%u %s in %u ms: decode %u ms, lcd %u ms, %u lines per band", dec->width, dec->height,
+                    (dec->ncomp == 1) ? "gray" : ((dec->mcu_h == 16) ? "4:2:0" : ((dec->mcu_w == 16) ? "4:2:2" : "4:4:4")),
+                    elapsed, elapsed - out.lcd_ms, out.lcd_ms, band.lines / dec->mcu_h * dec->mcu_h);
+    } else {
+        wm_log_error("decode ret=%d", ret);
+    }
+
+exit:
+    lcd_band_free(&band);
+    free(dec);
+
+    return ret;
+}
+
+static void cmd_jpeg(int argc, char *argv[])
+{
+    lcd_jpeg_mem_t mem = { 0 };
+    lcd_jpeg_sd_t sd   = { 0 };
+    wm_device_t *dev;
+    int s;
+
+    if (argc < 3)
+        return;
+
+    dev = lcd_get_device();
+    if (!dev)
+        return;
+
+    if (!strcmp("flash", argv[1]) && (argc > 3)) {
+        mem.data = (const uint8_t *)strtoul(argv[2], NULL, 0);
+        mem.len  = strtoul(argv[3], NULL, 0);
+        lcd_show_jpeg(dev, lcd_jpeg_mem_read, &mem);
+    } else if (!strcmp("sd", argv[1])) {
+        sd.sd_dev = wm_dt_get_device_by_name("sdmmc");
+        if (!(sd.sd_dev && (WM_DEV_ST_INITED == sd.sd_dev->state)))
+            sd.sd_dev = wm_drv_sdh_sdmmc_init("sdmmc");
+
+        if (!sd.sd_dev) {
+            wm_log_error("sdmmc init failed, maybe sd card not exist");
+            return;
+        }
+
+        sd.block = strtoul(argv[2], NULL, 0);
+        lcd_show_jpeg(dev, lcd_jpeg_sd_read, &sd);
+    } else if (!strcmp("http", argv[1])) {
+        s = lcd_jpeg_http_open(argv[2]);
+        if (s < 0)
+            return;
+
+        lcd_show_jpeg(dev, lcd_jpeg_http_read, (void *)(intptr_t)s);
+        close(s);
+    }
+}
+WM_CLI_CMD_DEFINE(jpeg, cmd_jpeg, jpeg cmd, jpeg <flash <addr> <len> | sd <start_block> | http <url>> -- decode a baseline jpeg onto lcd);
@@ -0,0 +1,334 @@
+#include <stdio.h>
+#include <string.h>
+#include "wmsdk_config.h"
+#include "wm_drv_tft_lcd.h"
+#include "wm_drv_sdh_sdmmc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "lcd.h"
+#include "pixel.h"
+#include "sdio.h"
+
+#define LOG_TAG "lcd_sd"
+#include "wm_log.h"
+
+#define LCD_SD_TASK_STACK              1024
+#define LCD_SD_TASK_PRIO               3
+
+#define LCD_SD_BLOCK_SIZE              512
+/* two bands are in flight: one being read from sd, one being sent to the lcd */
+#define LCD_SD_BAND_NUM                2
+#define LCD_SD_QUEUE_WAIT_MS           5000
+
+#define NOW_MS()                       (xTaskGetTickCount() * portTICK_PERIOD_MS)
+
+typedef struct {
+    uint32_t data_offset;              /**< byte offset of the first pixel from the start block */
+    uint16_t width;
+    uint16_t high;
+    uint16_t bpp;                      /**< bits per pixel of the source, 16 or 24 */
+    uint32_t stride;                   /**< bytes per source line, including padding */
+    bool bottom_up;                    /**< bmp lines are stored from the bottom line */
+    bool little_endian;                /**< source pixels need a byte swap for the lcd */
+} lcd_sd_image_t;
+
+typedef struct {
+    uint8_t *buf;
+    uint16_t y;
+    uint16_t lines;                    /**< 0 marks the end of the stream */
+    int ret;                           /**< result of the stream, valid in the end marker */
+} lcd_sd_band_t;
+
+typedef struct {
+    wm_device_t *sd_dev;
+    lcd_sd_image_t img;
+    uint32_t start_block;
+    uint32_t count;
+    uint16_t band_lines;
+    volatile bool stop;                /**< set by the lcd side after an error, no more bands come back */
+    QueueHandle_t free_q;
+    QueueHandle_t full_q;
+    uint32_t blocks_read;
+} lcd_sd_ctx_t;
+
+static uint16_t lcd_sd_le16(const uint8_t *p)
+{
+    return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+static uint32_t lcd_sd_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* recognize a bmp header in the first block, anything else is taken as a raw rgb565 full screen dump */
+static int lcd_sd_parse_header(const uint8_t *block, uint16_t scr_width, uint16_t scr_high, lcd_sd_image_t *img)
+{
+    int32_t high;
+    uint32_t compression;
+
+    memset(img, 0, sizeof(*img));
+
+    if ((block[0] != 'B') || (block[1] != 'M')) {
+        img->width  = scr_width;
+        img->high   = scr_high;
+        img->bpp    = 16;
+        img->stride = scr_width * 2;
+        return WM_ERR_SUCCESS;
+    }
+
+    img->data_offset = lcd_sd_le32(&block[10]);
+    img->width       = (uint16_t)lcd_sd_le32(&block[18]);
+    high             = (int32_t)lcd_sd_le32(&block[22]);
+    img->bpp         = lcd_sd_le16(&block[28]);
+    compression      = lcd_sd_le32(&block[30]);
+
+    img->bottom_up     = (high > 0);
+    img->high          = (uint16_t)(high > 0 ? high : -high);
+    img->little_endian = true;
+    img->stride        = ((img->width * img->bpp / 8) + 3) & ~3;
+
+    /* 16 bit must be rgb565 bitfields, 24 bit must be uncompressed */
+    if (!((img->bpp == 16 && compression == 3) || (img->bpp == 24 && compression == 0))) {
+        wm_log_error("unsupported bmp, bpp %u, compression %u", img->bpp, compression);
+        return WM_ERR_INVALID_PARAM;
+    }
+
+    if ((img->width > scr_width) || (img->high > scr_high)) {
+        wm_log_error("bmp %ux%u is larger than the screen", img->width, img->high);
+        return WM_ERR_INVALID_PARAM;
+    }
+
+    return WM_ERR_SUCCESS;
+}
+
+/* read the file bytes [offset, offset + len) with one multi-block read, return the skew of offset in buf */
+static int lcd_sd_read_span(lcd_sd_ctx_t *ctx, uint8_t *buf, uint32_t offset, uint32_t len, uint32_t *skew)
+{
+    uint32_t first = offset / LCD_SD_BLOCK_SIZE;
+    uint32_t last  = (offset + len - 1) / LCD_SD_BLOCK_SIZE;
+
+    *skew = offset % LCD_SD_BLOCK_SIZE;
+    ctx->blocks_read += last - first + 1;
+
+    return sdio_read_blocks(ctx->sd_dev, buf, ctx->start_block + first, last - first + 1);
+}
+
+/* convert the source lines at src into packed big-endian rgb565 at the start of buf, in place */
+static void lcd_sd_convert(const lcd_sd_image_t *img, uint8_t *buf, const uint8_t *src, uint16_t lines)
+{
+    uint8_t *dst = buf;
+
+    for (uint16_t line = 0; line < lines; line++) {
+        const uint8_t *s = src + line * img->stride;
+
+        if (img->bpp == 24) {
+            pixel_bgr888_to_rgb565(dst, s, img->width, false, 0, 0);
+        } else if (img->little_endian) {
+            pixel_swap16(dst, s, img->width);
+        } else if (dst != s) {
+            memmove(dst, s, img->width * 2);
+        }
+
+        dst += img->width * 2;
+    }
+
+    /* bmp stores the lines bottom up, flip the band so it can go out in one window */
+    if (img->bottom_up) {
+        for (uint16_t i = 0; i < lines / 2; i++) {
+            uint16_t *a = (uint16_t *)(buf + i * img->width * 2);
+            uint16_t *b = (uint16_t *)(buf + (lines - 1 - i) * img->width * 2);
+
+            for (uint16_t x = 0; x < img->width; x++) {
+                uint16_t t = a[x];
+                a[x] = b[x];
+                b[x] = t;
+            }
+        }
+    }
+}
+
+/* sd side of the pipeline: fill free bands and hand them to the lcd side */
+static void lcd_sd_reader_task(void *param)
+{
+    lcd_sd_ctx_t *ctx         = param;
+    const lcd_sd_image_t *img = &ctx->img;
+    lcd_sd_band_t band;
+    uint32_t skew;
+    int ret = WM_ERR_SUCCESS;
+
+    for (uint32_t n = 0; (n < ctx->count) && (ret == WM_ERR_SUCCESS); n++) {
+        for (uint16_t y = 0; y < img->high; y += ctx->band_lines) {
+            uint16_t lines = (y + ctx->band_lines > img->high) ? (img->high - y) : ctx->band_lines;
+            /* first source line of this band in the file */
+            uint16_t src_line = img->bottom_up ? (img->high - y - lines) : y;
+
+            if (ctx->stop) {
+                ret = WM_ERR_FAILED;
+                break;
+            }
+
+            if (xQueueReceive(ctx->free_q, &band, pdMS_TO_TICKS(LCD_SD_QUEUE_WAIT_MS)) != pdTRUE) {
+                ret = WM_ERR_TIMEOUT;
+                break;
+            }
+
+            ret = lcd_sd_read_span(ctx, band.buf, img->data_offset + src_line * img->stride, lines * img->stride, &skew);
+            if (ret != WM_ERR_SUCCESS) {
+                wm_log_error("read sd ret=%d", ret);
+                break;
+            }
+
+            lcd_sd_convert(img, band.buf, band.buf + skew, lines);
+
+            band.y     = y;
+            band.lines = lines;
+            xQueueSend(ctx->full_q, &band, portMAX_DELAY);
+        }
+    }
+
+    /* exactly one end marker, ctx belongs to the caller and must not be touched after it */
+    band.buf   = NULL;
+    band.lines = 0;
+    band.ret   = ret;
+    xQueueSend(ctx->full_q, &band, portMAX_DELAY);
+
+    vTaskDelete(NULL);
+}
+
+int lcd_show_sd_image(wm_device_t *dev, uint32_t start_block, uint32_t count)
+{
+    lcd_sd_ctx_t ctx             = { 0 };
+    wm_lcd_capabilitys_t cap     = { 0 };
+    lcd_stream_t stream          = { 0 };
+    lcd_sd_band_t band;
+    lcd_band_t bands[LCD_SD_BAND_NUM] = { 0 };
+    uint8_t *block;
+    uint32_t start;
+    uint32_t elapsed;
+    uint32_t frames = 0;
+    bool streaming  = false;
+    int end_ret;
+    int ret;
+
+    ctx.sd_dev = wm_dt_get_device_by_name("sdmmc");
+    if (!(ctx.sd_dev && (WM_DEV_ST_INITED == ctx.sd_dev->state)))
+        ctx.sd_dev = wm_drv_sdh_sdmmc_init("sdmmc");
+
+    if (!ctx.sd_dev) {
+        wm_log_error("sdmmc init failed, maybe sd card not exist");
+        return WM_ERR_FAILED;
+    }
+
+    wm_drv_tft_lcd_get_capability(dev, &cap);
+
+    block = malloc(LCD_SD_BLOCK_SIZE);
+    if (!block)
+        return WM_ERR_NO_MEM;
+
+    ret = sdio_read_blocks(ctx.sd_dev, block, start_block, 1);
+    if (ret == WM_ERR_SUCCESS)
+        ret = lcd_sd_parse_header(block, cap.x_resolution, cap.y_resolution, &ctx.img);
+    free(block);
+
+    if (ret != WM_ERR_SUCCESS)
+        return ret;
+
+    wm_log_debug("image %ux%u, %u bpp, offset %u%s", ctx.img.width, ctx.img.high, ctx.img.bpp,
+                 ctx.img.data_offset, ctx.img.bottom_up ? ", bottom up" : "");
+
+    ctx.start_block = start_block;
+    ctx.count       = count ? count : 1;
+    ctx.free_q      = xQueueCreate(LCD_SD_BAND_NUM, sizeof(lcd_sd_band_t));
+    ctx.full_q      = xQueueCreate(LCD_SD_BAND_NUM + 1, sizeof(lcd_sd_band_t));
+
+    if (!ctx.free_q || !ctx.full_q) {
+        ret = WM_ERR_NO_MEM;
+        goto exit;
+    }
+
+    /* the bands are as large as memory allows, the second one is never larger than the first,
+     * the extra blocks hold the skew of an unaligned band start */
+    ctx.band_lines = ctx.img.high;
+    for (int i = 0; i < LCD_SD_BAND_NUM; i++) {
+        ret = lcd_band_alloc(&bands[i], ctx.img.stride, ctx.band_lines, 2 * LCD_SD_BLOCK_SIZE);
+        if (ret != WM_ERR_SUCCESS) {
+            wm_log_error("mem err");
+            goto exit;
+        }
+
+        ctx.band_lines = bands[i].lines;
+        band.buf       = bands[i].buf;
+        xQueueSend(ctx.free_q, &band, 0);
+    }
+
+    start = NOW_MS();
+
+    /* the reader runs in its own task, so the next band is read while this one is being sent;
+     * the card and the panel share the sdio controller, their transfers take turns under its lock */
+    if (pdPASS != xTaskCreate(lcd_sd_reader_task, "lcd_sd", LCD_SD_TASK_STACK, &ctx, LCD_SD_TASK_PRIO, NULL)) {
+        ret = WM_ERR_NO_MEM;
+        goto exit;
+    }
+
+    while (1) {
+        /* the reader always ends with a marker, its own waits are bounded */
+        xQueueReceive(ctx.full_q, &band, portMAX_DELAY);
+
+        if (!band.lines) {
+            /* the first lcd error is the result, the reader only ended because of it */
+            if (ret == WM_ERR_SUCCESS)
+                ret = band.ret;
+            break;
+        }
+
+        /* after an lcd error the bands are kept, the reader runs out of them and sends its marker */
+        if (ret != WM_ERR_SUCCESS)
+            continue;
+
+        /* the bands of one image come in order, each image is one window */
+        if (!band.y) {
+            ret       = lcd_stream_begin(&stream, dev, 0, 0, ctx.img.width, ctx.img.high);
+            streaming = (ret == WM_ERR_SUCCESS);
+        }
+
+        if (ret == WM_ERR_SUCCESS)
+            ret = lcd_stream_write(&stream, band.buf, band.lines * ctx.img.width * WM_CFG_TFT_LCD_PIXEL_WIDTH);
+
+        if (streaming && ((ret != WM_ERR_SUCCESS) || (band.y + band.lines == ctx.img.high))) {
+            end_ret   = lcd_stream_end(&stream);
+            streaming = false;
+            if (ret == WM_ERR_SUCCESS)
+                ret = end_ret;
+            if (ret == WM_ERR_SUCCESS)
+                frames++;
+        }
+
+        if (ret != WM_ERR_SUCCESS) {
+            wm_log_error("lcd_show_sd_image ret=%d", ret);
+            ctx.stop = true;
+            continue;
+        }
+
+        xQueueSend(ctx.free_q, &band, portMAX_DELAY);
+    }
+
+    elapsed = NOW_MS() - start;
+    if (elapsed && frames) {
+        wm_log_info("%u images in %u ms, %u.%02u images/s, sd %u KB/s", frames, elapsed,
+                    frames * 1000 / elapsed, (frames * 100000 / elapsed) % 100,
+                    ctx.blocks_read * LCD_SD_BLOCK_SIZE / elapsed * 1000 / 1024);
+    }
+
+exit:
+    for (int i = 0; i < LCD_SD_BAND_NUM; i++)
+        lcd_band_free(&bands[i]);
+
+    if (ctx.free_q)
+        vQueueDelete(ctx.free_q);
+    if (ctx.full_q)
+        vQueueDelete(ctx.full_q);
+
+    return ret;
+}
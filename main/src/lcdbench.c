@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <string.h>
+#include "wmsdk_config.h"
+#include "wm_drv_tft_lcd.h"
+#include "wm_cli.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lcd.h"
+#include "pixel.h"
+#include "display.h"
+#include "sdio.h"
+
+#define LOG_TAG "lcdbench"
+#include "wm_log.h"
+
+#define LCDBENCH_DEFAULT_FRAMES        5
+
+#define NOW_MS()                       (xTaskGetTickCount() * portTICK_PERIOD_MS)
+
+/* the stream modes send the same bands into one window opened per frame, see lcd_stream_begin */
+typedef enum {
+    LCDBENCH_MODE_FILL = 0,
+    LCDBENCH_MODE_IMAGE,
+    LCDBENCH_MODE_STREAM_FILL,
+    LCDBENCH_MODE_STREAM_IMAGE,
+    LCDBENCH_MODE_MAX
+} lcdbench_mode_t;
+
+#define LCDBENCH_MODE_STREAM           LCDBENCH_MODE_STREAM_FILL
+
+static const char *lcdbench_mode_name[LCDBENCH_MODE_MAX] = {"fill", "image", "sfill", "simg"};
+
+static const uint16_t lcdbench_lines[] = {1, 2, 4, 8, 16, 20, 34, 40, 68, 136, 272};
+
+typedef struct {
+    uint32_t cpu_ms;                   /**< time spent filling or copying the band buffer */
+    uint32_t lcd_ms;                   /**< time spent in wm_drv_tft_lcd_draw_bitmap */
+    uint32_t bytes;                    /**< pixel bytes sent to the panel */
+    bool fallback;                     /**< stream mode ran with one window per band */
+} lcdbench_result_t;
+
+static int lcdbench_frame(wm_device_t *dev, lcdbench_mode_t mode, uint8_t *buf, uint16_t band_lines,
+                          uint16_t width, uint16_t high, uint16_t color, lcdbench_result_t *result)
+{
+    wm_lcd_data_desc_t data_desc = { 0 };
+    lcd_stream_t stream;
+    uint32_t line_size           = width * WM_CFG_TFT_LCD_PIXEL_WIDTH;
+    bool stream_mode             = (mode >= LCDBENCH_MODE_STREAM);
+    uint32_t start;
+    int ret                      = WM_ERR_SUCCESS;
+
+    if (stream_mode) {
+        start = NOW_MS();
+        ret = lcd_stream_begin(&stream, dev, 0, 0, width, high);
+        result->lcd_ms += NOW_MS() - start;
+        if (ret != WM_ERR_SUCCESS)
+            return ret;
+    }
+
+    for (uint16_t y = 0; y < high;) {
+        data_desc.x_start  = 0;
+        data_desc.x_end    = width - 1;
+        data_desc.y_start  = y;
+        data_desc.y_end    = (y + band_lines > high) ? (high - 1) : (y + band_lines - 1);
+        data_desc.buf      = buf;
+        data_desc.buf_size = (data_desc.y_end - y + 1) * line_size;
+
+        /* the buffer is prepared for every band, as a real producer would have to */
+        start = NOW_MS();
+        if ((mode == LCDBENCH_MODE_FILL) || (mode == LCDBENCH_MODE_STREAM_FILL)) {
+            pixel_fill(buf, color, data_desc.buf_size / WM_CFG_TFT_LCD_PIXEL_WIDTH);
+        } else {
+            memcpy(buf, image_hello_world_480x272 + y * line_size, data_desc.buf_size);
+        }
+        result->cpu_ms += NOW_MS() - start;
+
+        start = NOW_MS();
+        if (stream_mode) {
+            ret = lcd_stream_write(&stream, buf, data_desc.buf_size);
+        } else {
+            sdio_lock();
+            ret = wm_drv_tft_lcd_draw_bitmap(dev, data_desc);
+            sdio_unlock();
+        }
+        result->lcd_ms += NOW_MS() - start;
+        if (ret != WM_ERR_SUCCESS) {
+            wm_log_error("%s ret=%d", stream_mode ? "stream_write" : "draw_bitmap", ret);
+            break;
+        }
+
+        result->bytes += data_desc.buf_size;
+        y = data_desc.y_end + 1;
+    }
+
+    if (stream_mode && (ret == WM_ERR_SUCCESS)) {
+        ret = lcd_stream_end(&stream);
+        if (!stream.window)
+            result->fallback = true;
+    }
+
+    return ret;
+}
+
+static void lcdbench_run(wm_device_t *dev, uint16_t band_lines, uint32_t frames)
+{
+    static const uint16_t colors[] = {LCD_RGB565_RED, LCD_RGB565_GREEN, LCD_RGB565_BLUE};
+    wm_lcd_capabilitys_t cap = { 0 };
+    lcdbench_result_t result;
+    float fps[LCDBENCH_MODE_MAX] = { 0 };
+    uint32_t buf_len;
+    uint32_t heap_before;
+    uint32_t heap_used;
+    uint32_t total_ms;
+    uint8_t *buf;
+    int ret = WM_ERR_SUCCESS;
+
+    wm_drv_tft_lcd_get_capability(dev, &cap);
+
+    if (!band_lines)
+        band_lines = 1;
+    if (band_lines > cap.y_resolution)
+        band_lines = cap.y_resolution;
+
+    buf_len     = band_lines * cap.x_resolution * WM_CFG_TFT_LCD_PIXEL_WIDTH;
+    heap_before = xPortGetFreeHeapSize();
+
+    buf = malloc(buf_len);
+    if (!buf) {
+        wm_cli_printf("%5u  %7u  -- no memory, free heap %u\r\n", band_lines, buf_len, heap_before);
+        return;
+    }
+
+    heap_used = heap_before - xPortGetFreeHeapSize();
+
+    for (int mode = 0; mode < LCDBENCH_MODE_MAX; mode++) {
+        /* the built-in image is 480x272, only draw it on a panel that fits */
+        if (((mode == LCDBENCH_MODE_IMAGE) || (mode == LCDBENCH_MODE_STREAM_IMAGE)) &&
+            ((cap.x_resolution != 480) || (cap.y_resolution != 272)))
+            continue;
+
+        memset(&result, 0, sizeof(result));
+
+        for (uint32_t n = 0; (n < frames) && (ret == WM_ERR_SUCCESS); n++) {
+            ret = lcdbench_frame(dev, mode, buf, band_lines, cap.x_resolution, cap.y_resolution,
+                                 colors[n % (sizeof(colors) / sizeof(colors[0]))], &result);
+        }
+
+        total_ms = result.cpu_ms + result.lcd_ms;
+        if (!total_ms)
+            total_ms = 1;
+
+        fps[mode] = (float)frames * 1000 / total_ms;
+
+        wm_cli_printf("%5u  %7u  %-5s  %6.2f  %6.2f  %6u  %6u  %3u%%",
+                      band_lines, heap_used, lcdbench_mode_name[mode], fps[mode],
+                      (float)result.bytes / total_ms / 1000,
+                      result.cpu_ms, result.lcd_ms, result.cpu_ms * 100 / total_ms);
+
+        /* a stream mode is compared with the same content sent one window per band */
+        if ((mode >= LCDBENCH_MODE_STREAM) && (fps[mode - LCDBENCH_MODE_STREAM] > 0)) {
+            wm_cli_printf("  %+6.1f%%%s", (fps[mode] / fps[mode - LCDBENCH_MODE_STREAM] - 1) * 100,
+                          result.fallback ? " (no raw window)" : "");
+        }
+        wm_cli_printf("\r\n");
+    }
+
+    free(buf);
+}
+
+static void cmd_lcdbench(int argc, char *argv[])
+{
+    wm_device_t *dev;
+    uint32_t frames = LCDBENCH_DEFAULT_FRAMES;
+
+    if (argc > 1)
+        frames = atoi(argv[1]);
+    if (!frames)
+        frames = 1;
+
+    dev = lcd_get_device();
+    if (!dev)
+        return;
+
+    wm_cli_printf("lines  heap(B)  mode      fps    MB/s  cpu(ms) lcd(ms)  cpu   stream\r\n");
+
+    display_lock();
+    if (argc > 2) {
+        lcdbench_run(dev, atoi(argv[2]), frames);
+    } else {
+        for (int i = 0; i < sizeof(lcdbench_lines) / sizeof(lcdbench_lines[0]); i++)
+            lcdbench_run(dev, lcdbench_lines[i], frames);
+    }
+    display_unlock();
+}
+WM_CLI_CMD_DEFINE(lcdbench, cmd_lcdbench, lcdbench cmd, lcdbench [frames] [lines] -- measure lcd refresh rate for band heights);
@@ -0,0 +1,260 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wmsdk_config.h"
+#include "wm_drv_adc.h"
+#include "wm_cli.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "ntc.h"
+#include "ntc_alarm.h"
+#include "ntc_table.h"
+#include "sampler.h"
+
+#define LOG_TAG "ntc"
+#include "wm_log.h"
+
+#define NTC_TABLE_SIZE                 (sizeof(ntc_table) / sizeof(ntc_table[0]))
+
+#define NOW_MS()                       (xTaskGetTickCount() * portTICK_PERIOD_MS)
+
+/* the float conversion the table was generated from, kept as the reference of `ntc check` */
+static float ntc_formula(int voltage)
+{
+    int rt;
+    float rp = 100000;
+    float t2 = 273.15 + 25;
+    float bx = 3950;
+    float ka = 273.15;
+
+    rt = ((100 * 1000) * voltage) / ((3300) - voltage);//ref_r:100k,ref_v:3.3v
+    rt = rt * 10;
+
+    //Rt = R EXP(B(1/T1-1/T2))
+    //T1=1/(ln(Rt/R)/B+1/T2)
+    //T1=1/(log(Rt/R)/B+1/T2)
+    return 1 / (1 / t2 + log(((float)rt) / rp) / bx) - ka + 0.5;
+}
+
+int ntc_mv_to_centi(int mv, int16_t *centi)
+{
+    const ntc_knot_t *a;
+    const ntc_knot_t *b;
+    uint32_t lo = 0;
+    uint32_t hi = NTC_TABLE_SIZE - 1;
+    uint32_t mid;
+
+    /* outside the table the nearest end is returned, flagged as out of range */
+    if (mv <= NTC_TABLE_MV_MIN) {
+        *centi = ntc_table[0].centi;
+        return (mv == NTC_TABLE_MV_MIN) ? WM_ERR_SUCCESS : WM_ERR_INVALID_PARAM;
+    }
+    if (mv >= NTC_TABLE_MV_MAX) {
+        *centi = ntc_table[NTC_TABLE_SIZE - 1].centi;
+        return (mv == NTC_TABLE_MV_MAX) ? WM_ERR_SUCCESS : WM_ERR_INVALID_PARAM;
+    }
+
+    /* the knot at or below mv, the one above it is then inside the table */
+    while (hi - lo > 1) {
+        mid = (lo + hi) / 2;
+        if (ntc_table[mid].mv <= mv)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    a = &ntc_table[lo];
+    b = &ntc_table[lo + 1];
+
+    *centi = a->centi + (int32_t)(b->centi - a->centi) * (mv - a->mv) / (b->mv - a->mv);
+
+    return WM_ERR_SUCCESS;
+}
+
+int ntc_centi_to_mv(int16_t centi, int *mv)
+{
+    const ntc_knot_t *a;
+    const ntc_knot_t *b;
+    uint32_t lo = 0;
+    uint32_t hi = NTC_TABLE_SIZE - 1;
+    uint32_t mid;
+
+    /* the table runs from the hottest knot down, the voltage rises as the temperature falls */
+    if (centi >= ntc_table[0].centi) {
+        *mv = NTC_TABLE_MV_MIN;
+        return (centi == ntc_table[0].centi) ? WM_ERR_SUCCESS : WM_ERR_INVALID_PARAM;
+    }
+    if (centi <= ntc_table[NTC_TABLE_SIZE - 1].centi) {
+        *mv = NTC_TABLE_MV_MAX;
+        return (centi == ntc_table[NTC_TABLE_SIZE - 1].centi) ? WM_ERR_SUCCESS : WM_ERR_INVALID_PARAM;
+    }
+
+    while (hi - lo > 1) {
+        mid = (lo + hi) / 2;
+        if (ntc_table[mid].centi >= centi)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    a = &ntc_table[lo];
+    b = &ntc_table[lo + 1];
+
+    *mv = a->mv + (int32_t)(a->centi - centi) * (b->mv - a->mv) / (a->centi - b->centi);
+
+    return WM_ERR_SUCCESS;
+}
+
+static int ntc_read_mv(int *voltage)
+{
+    wm_device_t *adc_dev = NULL;
+
+    /* while the alarm watches it the comparator is paused around the conversion */
+    if (ntc_alarm_armed())
+        return ntc_alarm_oneshot(voltage);
+
+    adc_dev = wm_dt_get_device_by_name("adc");
+    if (!(adc_dev && (WM_DEV_ST_INITED == adc_dev->state)))
+        adc_dev = wm_drv_adc_init("adc");
+
+    if (!adc_dev)
+        return WM_ERR_FAILED;
+
+    return wm_drv_adc_oneshot(adc_dev, WM_ADC_CHANNEL_2, voltage);
+}
+
+int ntc_read_centi(int16_t *centi)
+{
+    int voltage;
+    int ret;
+
+    ret = ntc_read_mv(&voltage);
+    if (WM_ERR_SUCCESS == ret) {
+        wm_log_debug("voltage %dmv", voltage);
+        ret = ntc_mv_to_centi(voltage, centi);
+    }
+
+    return ret;
+}
+
+int ntc_read(float *temp)
+{
+    int16_t centi;
+    int ret;
+
+    ret = ntc_read_centi(&centi);
+    if (WM_ERR_SUCCESS == ret)
+        *temp = centi / 100.0f;
+
+    return ret;
+}
+
+static int ntc_sample(sampler_sample_t *sample, void *arg)
+{
+    int16_t centi;
+    int ret;
+
+    ret = ntc_read_centi(&centi);
+    if (WM_ERR_SUCCESS == ret)
+        sample->value[0] = centi / 100.0f;
+
+    return ret;
+}
+
+int ntc_sample_start(void)
+{
+    int id;
+
+    if (sampler_find("ntc") >= 0)
+        return WM_ERR_SUCCESS;
+
+    id = sampler_register("ntc", NTC_SAMPLE_MS, SAMPLER_PHASE_AUTO, ntc_sample, NULL);
+
+    return (id < 0) ? id : WM_ERR_SUCCESS;
+}
+
+int ntc_get(float *temp)
+{
+    sampler_sample_t sample;
+
+    if ((WM_ERR_SUCCESS != sampler_latest(sampler_find("ntc"), &sample)) ||
+        (NOW_MS() - sample.time_ms > NTC_STALE_MS))
+        return WM_ERR_FAILED;
+
+    *temp = sample.value[0];
+
+    return WM_ERR_SUCCESS;
+}
+
+/* every millivolt of the table range against the formula */
+static void ntc_check(void)
+{
+    int16_t centi;
+    int32_t err;
+    int32_t worst    = 0;
+    int worst_mv     = 0;
+
+    for (int mv = NTC_TABLE_MV_MIN; mv <= NTC_TABLE_MV_MAX; mv++) {
+        ntc_mv_to_centi(mv, &centi);
+        err = abs(centi - (int32_t)lroundf(ntc_formula(mv) * 100));
+        if (err > worst) {
+            worst    = err;
+            worst_mv = mv;
+        }
+    }
+
+    wm_cli_printf("%u knots, %d - %d mV, max error %d.%02d C at %d mV, bound %d.%02d C: %s\r\n",
+                  (unsigned int)NTC_TABLE_SIZE, NTC_TABLE_MV_MIN, NTC_TABLE_MV_MAX, worst / 100, worst % 100,
+                  worst_mv, NTC_TABLE_MAX_ERROR_CENTI / 100, NTC_TABLE_MAX_ERROR_CENTI % 100,
+                  (worst <= NTC_TABLE_MAX_ERROR_CENTI + 1) ? "ok" : "FAIL");
+}
+
+static void ntc_bench_print(const char *name, uint32_t ms, uint32_t n)
+{
+    float ns = (float)ms * 1000000 / n;
+
+    wm_cli_printf("%-8s %8u ms  %8.1f ns  %8.0f cycles per conversion\r\n", name, ms, ns,
+                  ns * (configCPU_CLOCK_HZ / 1000000) / 1000);
+}
+
+static void ntc_bench(uint32_t loops)
+{
+    uint32_t n     = loops * (NTC_TABLE_MV_MAX - NTC_TABLE_MV_MIN + 1);
+    int32_t sum    = 0;
+    float fsum     = 0;
+    int16_t centi;
+    uint32_t start;
+
+    start = NOW_MS();
+    for (uint32_t i = 0; i < loops; i++) {
+        for (int mv = NTC_TABLE_MV_MIN; mv <= NTC_TABLE_MV_MAX; mv++) {
+            ntc_mv_to_centi(mv, &centi);
+            sum += centi;
+        }
+    }
+    ntc_bench_print("table", NOW_MS() - start, n);
+
+    start = NOW_MS();
+    for (uint32_t i = 0; i < loops; i++) {
+        for (int mv = NTC_TABLE_MV_MIN; mv <= NTC_TABLE_MV_MAX; mv++)
+            fsum += ntc_formula(mv);
+    }
+    ntc_bench_print("formula", NOW_MS() - start, n);
+
+    wm_log_debug("sum %d %d", (int)sum, (int)fsum);
+}
+
+static void cmd_ntc(int argc, char *argv[])
+{
+    float temp;
+
+    if ((argc > 1) && !strcmp("check", argv[1])) {
+        ntc_check();
+    } else if ((argc > 1) && !strcmp("bench", argv[1])) {
+        ntc_bench((argc > 2) ? strtoul(argv[2], NULL, 0) : 10);
+    } else if (WM_ERR_SUCCESS == ntc_read(&temp)) {
+        wm_cli_printf("ntc temp = %.1f\r\n", temp);
+    }
+}
+WM_CLI_CMD_DEFINE(ntc, cmd_ntc, ntc cmd, ntc [check | bench [loops]] -- show temperature or check and time the conversion table);
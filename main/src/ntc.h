@@ -0,0 +1,36 @@
+#ifndef __NTC_H__
+#define __NTC_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the sampler reads the ntc every NTC_SAMPLE_MS once started */
+#define NTC_SAMPLE_MS                  1000
+/* a sample older than this is no longer returned by ntc_get */
+#define NTC_STALE_MS                   (NTC_SAMPLE_MS * 5)
+
+int ntc_read(float *temp);
+
+/* the same in 0.01 C, integer math only */
+int ntc_read_centi(int16_t *centi);
+
+/* adc millivolts to 0.01 C through tools/gen_ntc_table.py's table,
+ * outside the table range the nearest end is stored and WM_ERR_INVALID_PARAM returned */
+int ntc_mv_to_centi(int mv, int16_t *centi);
+
+/* the inverse, the adc millivolts a temperature reads as, with the same range handling */
+int ntc_centi_to_mv(int16_t centi, int *mv);
+
+int ntc_sample_start(void);
+
+/* the latest sampled temperature, WM_ERR_FAILED when there is none or it is stale */
+int ntc_get(float *temp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NTC_H__ */
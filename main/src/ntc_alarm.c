@@ -0,0 +1,451 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wmsdk_config.h"
+#include "wm_drv_adc.h"
+#include "wm_cli.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "ntc.h"
+#include "ntc_alarm.h"
+
+#define LOG_TAG "ntc_alarm"
+#include "wm_log.h"
+
+#define NTC_ALARM_CHANNEL              WM_ADC_CHANNEL_2
+
+/*
+ * the comparator works on conversion codes, not on the mV the driver hands out: a oneshot result
+ * is 1196 mV + (code - offset) * 126.363 uV / 4, so a threshold goes through the inverse of that.
+ * The offset the driver trims at init is not exposed; at arm time the comparator itself finds the
+ * code of the input by successive approximation, and a oneshot of the same input gives the offset.
+ * Until then, or when the search fails, the nominal mid scale code stands in for it.
+ */
+#define NTC_ALARM_ADC_MID_MV           1196
+#define NTC_ALARM_ADC_NV_PER_CODE      31591
+#define NTC_ALARM_ADC_OFFSET_CODE      0x20000
+
+/* the trimmed offset is searched this far either side of the nominal code, about 65 mV */
+#define NTC_ALARM_CAL_RANGE_CODES      2048
+/* a comparator below its threshold interrupts within a few conversions */
+#define NTC_ALARM_CAL_WAIT_MS          5
+
+#define NTC_ALARM_TASK_STACK           512
+#define NTC_ALARM_TASK_PRIO            3
+
+#define NOW_MS()                       (xTaskGetTickCount() * portTICK_PERIOD_MS)
+
+typedef struct {
+    TaskHandle_t task;
+    SemaphoreHandle_t lock;            /**< the adc between the task and oneshot readers */
+    wm_device_t *dev;
+    volatile bool armed;
+
+    int16_t limit_centi;
+    int16_t hyst_centi;
+    int trip_mv;                       /**< hot reads low, at or below this the alarm is raised */
+    int clear_mv;                      /**< and at or above this it is dropped */
+    int trip_code;                     /**< the same as comparator codes */
+    int clear_code;
+    int offset_code;                   /**< the code of NTC_ALARM_ADC_MID_MV, from the calibration */
+    volatile bool over;
+    volatile bool calibrating;         /**< the comparator interrupts only set hit */
+    volatile bool hit;
+
+    ntc_alarm_callback_t cb;
+    void *user_data;
+
+    ntc_alarm_stat_t stat;
+} ntc_alarm_ctx_t;
+
+static ntc_alarm_ctx_t g_ntc_alarm = { 0 };
+
+static void ntc_alarm_isr(wm_device_t *dev, wm_adc_intr_type_t type, void *user_data)
+{
+    BaseType_t woken = pdFALSE;
+
+    if (WM_ADC_INTR_TYPE_COMP != type)
+        return;
+
+    if (g_ntc_alarm.calibrating) {
+        g_ntc_alarm.hit = true;
+        return;
+    }
+
+    if (!g_ntc_alarm.task)
+        return;
+
+    g_ntc_alarm.stat.irqs++;
+    vTaskNotifyGiveFromISR(g_ntc_alarm.task, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+static int ntc_alarm_mv_to_code(int mv)
+{
+    return g_ntc_alarm.offset_code +
+           (int)((int64_t)(mv - NTC_ALARM_ADC_MID_MV) * 1000000 / NTC_ALARM_ADC_NV_PER_CODE);
+}
+
+/* watch for the crossing out of the current state, lock held */
+static int ntc_alarm_arm(void)
+{
+    wm_drv_adc_cfg_t cfg;
+    int ret;
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.adc_channel = NTC_ALARM_CHANNEL;
+    cfg.pga_gain1   = WM_ADC_GAIN1_LEVEL_0;
+    cfg.pga_gain2   = WM_ADC_GAIN2_LEVEL_0;
+    cfg.adc_cmp     = true;
+    if (g_ntc_alarm.over) {
+        cfg.cmp_data = g_ntc_alarm.clear_code;
+        cfg.cmp_pol  = WM_ADC_CMP_POL_HIGH;
+    } else {
+        cfg.cmp_data = g_ntc_alarm.trip_code;
+        cfg.cmp_pol  = WM_ADC_CMP_POL_LOW;
+    }
+
+    ret = wm_drv_adc_cfg(g_ntc_alarm.dev, &cfg);
+    if (WM_ERR_SUCCESS == ret)
+        ret = wm_drv_adc_start_it(g_ntc_alarm.dev, NTC_ALARM_CHANNEL);
+
+    if (WM_ERR_SUCCESS != ret)
+        wm_log_error("arm ret=%d", ret);
+
+    return ret;
+}
+
+/* lock held, the comparator is stopped */
+static int ntc_alarm_convert(int *mv)
+{
+    wm_drv_adc_cfg_t cfg;
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.adc_channel = NTC_ALARM_CHANNEL;
+    cfg.pga_gain1   = WM_ADC_GAIN1_LEVEL_0;
+    cfg.pga_gain2   = WM_ADC_GAIN2_LEVEL_0;
+    cfg.adc_cmp     = false;
+    wm_drv_adc_cfg(g_ntc_alarm.dev, &cfg);
+
+    return wm_drv_adc_oneshot(g_ntc_alarm.dev, NTC_ALARM_CHANNEL, mv);
+}
+
+/* whether the comparator sees the input below code, lock held */
+static bool ntc_alarm_below(int code)
+{
+    wm_drv_adc_cfg_t cfg;
+    uint32_t start;
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.adc_channel = NTC_ALARM_CHANNEL;
+    cfg.pga_gain1   = WM_ADC_GAIN1_LEVEL_0;
+    cfg.pga_gain2   = WM_ADC_GAIN2_LEVEL_0;
+    cfg.adc_cmp     = true;
+    cfg.cmp_data    = code;
+    cfg.cmp_pol     = WM_ADC_CMP_POL_LOW;
+
+    g_ntc_alarm.hit = false;
+    if ((WM_ERR_SUCCESS != wm_drv_adc_cfg(g_ntc_alarm.dev, &cfg)) ||
+        (WM_ERR_SUCCESS != wm_drv_adc_start_it(g_ntc_alarm.dev, NTC_ALARM_CHANNEL)))
+        return false;
+
+    start = NOW_MS();
+    while (!g_ntc_alarm.hit && (NOW_MS() - start < NTC_ALARM_CAL_WAIT_MS))
+        vTaskDelay(1);
+    wm_drv_adc_stop_it(g_ntc_alarm.dev);
+
+    return g_ntc_alarm.hit;
+}
+
+/* the offset from the code of the input and a oneshot of it, lock held, the comparator is stopped */
+static void ntc_alarm_calibrate(void)
+{
+    int lo = NTC_ALARM_ADC_OFFSET_CODE - NTC_ALARM_CAL_RANGE_CODES;
+    int hi = NTC_ALARM_ADC_OFFSET_CODE + NTC_ALARM_CAL_RANGE_CODES;
+    int mid;
+    int mv0;
+    int mv;
+
+    g_ntc_alarm.offset_code      = NTC_ALARM_ADC_OFFSET_CODE;
+    g_ntc_alarm.stat.offset_code = NTC_ALARM_ADC_OFFSET_CODE;
+
+    if (WM_ERR_SUCCESS != ntc_alarm_convert(&mv0))
+        return;
+
+    /* search around where the nominal offset puts the input */
+    lo += ntc_alarm_mv_to_code(mv0) - NTC_ALARM_ADC_OFFSET_CODE;
+    hi += ntc_alarm_mv_to_code(mv0) - NTC_ALARM_ADC_OFFSET_CODE;
+
+    g_ntc_alarm.calibrating = true;
+    if (!ntc_alarm_below(hi) || ntc_alarm_below(lo)) {
+        g_ntc_alarm.calibrating = false;
+        g_ntc_alarm.stat.cal_failed++;
+        wm_log_warn("input code not within %d of nominal, nominal offset used", NTC_ALARM_CAL_RANGE_CODES);
+        return;
+    }
+
+    /* below hi and not below lo, the code of the input lies in between */
+    while (hi - lo > 1) {
+        mid = lo + (hi - lo) / 2;
+        if (ntc_alarm_below(mid))
+            hi = mid;
+        else
+            lo = mid;
+    }
+    g_ntc_alarm.calibrating = false;
+
+    /* the input may have drifted during the search, it is taken as the mean of the two conversions */
+    if (WM_ERR_SUCCESS != ntc_alarm_convert(&mv))
+        return;
+    mv = (mv0 + mv) / 2;
+
+    /* still the nominal offset, the difference is the correction */
+    g_ntc_alarm.offset_code      = lo - (ntc_alarm_mv_to_code(mv) - NTC_ALARM_ADC_OFFSET_CODE);
+    g_ntc_alarm.stat.offset_code = g_ntc_alarm.offset_code;
+}
+
+/* set the state from a conversion, returns whether it changed */
+static bool ntc_alarm_update(int mv)
+{
+    bool over = g_ntc_alarm.over;
+
+    if (!over && (mv <= g_ntc_alarm.trip_mv)) {
+        over = true;
+        g_ntc_alarm.stat.trips++;
+    } else if (over && (mv >= g_ntc_alarm.clear_mv)) {
+        over = false;
+        g_ntc_alarm.stat.clears++;
+    } else {
+        return false;
+    }
+
+    g_ntc_alarm.over                = over;
+    g_ntc_alarm.stat.last_change_ms = NOW_MS();
+
+    return true;
+}
+
+static void ntc_alarm_notify(int mv)
+{
+    int16_t centi;
+
+    ntc_mv_to_centi(mv, &centi);
+
+    if (g_ntc_alarm.over)
+        wm_log_warn("over %d.%02d C at %d.%02d C", g_ntc_alarm.limit_centi / 100, abs(g_ntc_alarm.limit_centi % 100),
+                    centi / 100, abs(centi % 100));
+    else
+        wm_log_info("cleared at %d.%02d C", centi / 100, abs(centi % 100));
+
+    if (g_ntc_alarm.cb)
+        g_ntc_alarm.cb(g_ntc_alarm.over, centi, g_ntc_alarm.user_data);
+}
+
+static void ntc_alarm_task(void *param)
+{
+    bool changed;
+    int mv;
+    int ret;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (!g_ntc_alarm.armed)
+            break;
+
+        /* a single noisy conversion may trip the comparator, one more decides */
+        xSemaphoreTake(g_ntc_alarm.lock, portMAX_DELAY);
+        wm_drv_adc_stop_it(g_ntc_alarm.dev);
+        ret     = ntc_alarm_convert(&mv);
+        changed = (WM_ERR_SUCCESS == ret) && ntc_alarm_update(mv);
+        if (!changed)
+            g_ntc_alarm.stat.spurious++;
+        if (g_ntc_alarm.armed)
+            ntc_alarm_arm();
+        xSemaphoreGive(g_ntc_alarm.lock);
+
+        if (changed)
+            ntc_alarm_notify(mv);
+    }
+
+    g_ntc_alarm.task = NULL;
+    vTaskDelete(NULL);
+}
+
+int ntc_alarm_start(int16_t limit_centi, int16_t hyst_centi, ntc_alarm_callback_t cb, void *user_data)
+{
+    wm_device_t *dev;
+    int trip_mv;
+    int clear_mv;
+    int mv;
+    int ret;
+
+    if ((hyst_centi < 0) || (WM_ERR_SUCCESS != ntc_centi_to_mv(limit_centi, &trip_mv)) ||
+        (WM_ERR_SUCCESS != ntc_centi_to_mv(limit_centi - hyst_centi, &clear_mv)))
+        return WM_ERR_INVALID_PARAM;
+
+    ntc_alarm_stop();
+
+    dev = wm_dt_get_device_by_name("adc");
+    if (!(dev && (WM_DEV_ST_INITED == dev->state)))
+        dev = wm_drv_adc_init("adc");
+
+    if (!dev)
+        return WM_ERR_FAILED;
+
+    if (!g_ntc_alarm.lock) {
+        g_ntc_alarm.lock = xSemaphoreCreateMutex();
+        if (!g_ntc_alarm.lock)
+            return WM_ERR_NO_MEM;
+    }
+
+    g_ntc_alarm.dev = dev;
+    wm_drv_adc_register_callback(dev, WM_ADC_INTR_TYPE_COMP, ntc_alarm_isr, NULL);
+
+    /* armed first, oneshot readers then wait for the lock instead of converting in the middle of the search */
+    xSemaphoreTake(g_ntc_alarm.lock, portMAX_DELAY);
+    g_ntc_alarm.armed = true;
+    memset(&g_ntc_alarm.stat, 0, sizeof(g_ntc_alarm.stat));
+    ntc_alarm_calibrate();
+
+    g_ntc_alarm.limit_centi = limit_centi;
+    g_ntc_alarm.hyst_centi  = hyst_centi;
+    g_ntc_alarm.trip_mv     = trip_mv;
+    g_ntc_alarm.clear_mv    = (clear_mv > trip_mv) ? clear_mv : trip_mv + 1;
+    g_ntc_alarm.trip_code   = ntc_alarm_mv_to_code(g_ntc_alarm.trip_mv);
+    g_ntc_alarm.clear_code  = ntc_alarm_mv_to_code(g_ntc_alarm.clear_mv);
+    g_ntc_alarm.over        = false;
+    g_ntc_alarm.cb          = cb;
+    g_ntc_alarm.user_data   = user_data;
+    xSemaphoreGive(g_ntc_alarm.lock);
+
+    if (pdPASS != xTaskCreate(ntc_alarm_task, "ntc_alarm", NTC_ALARM_TASK_STACK, NULL, NTC_ALARM_TASK_PRIO,
+                              &g_ntc_alarm.task)) {
+        xSemaphoreTake(g_ntc_alarm.lock, portMAX_DELAY);
+        g_ntc_alarm.armed = false;
+        g_ntc_alarm.task  = NULL;
+        wm_drv_adc_stop_it(dev);
+        xSemaphoreGive(g_ntc_alarm.lock);
+        return WM_ERR_NO_MEM;
+    }
+
+    /* the comparator only reports crossings, the state it starts from comes from a conversion */
+    xSemaphoreTake(g_ntc_alarm.lock, portMAX_DELAY);
+    ret = ntc_alarm_convert(&mv);
+    if (WM_ERR_SUCCESS == ret) {
+        ntc_alarm_update(mv);
+        ret = ntc_alarm_arm();
+    }
+    xSemaphoreGive(g_ntc_alarm.lock);
+
+    if (WM_ERR_SUCCESS != ret) {
+        ntc_alarm_stop();
+        return ret;
+    }
+
+    if (g_ntc_alarm.over)
+        ntc_alarm_notify(mv);
+
+    return WM_ERR_SUCCESS;
+}
+
+int ntc_alarm_stop(void)
+{
+    if (!g_ntc_alarm.task)
+        return WM_ERR_SUCCESS;
+
+    xSemaphoreTake(g_ntc_alarm.lock, portMAX_DELAY);
+    g_ntc_alarm.armed = false;
+    wm_drv_adc_stop_it(g_ntc_alarm.dev);
+    xSemaphoreGive(g_ntc_alarm.lock);
+
+    xTaskNotifyGive(g_ntc_alarm.task);
+    while (g_ntc_alarm.task)
+        vTaskDelay(1);
+
+    g_ntc_alarm.over = false;
+
+    return WM_ERR_SUCCESS;
+}
+
+bool ntc_alarm_armed(void)
+{
+    return g_ntc_alarm.armed;
+}
+
+bool ntc_alarm_over(void)
+{
+    return g_ntc_alarm.armed && g_ntc_alarm.over;
+}
+
+int ntc_alarm_oneshot(int *mv)
+{
+    bool changed = false;
+    int ret;
+
+    if (!g_ntc_alarm.armed)
+        return WM_ERR_FAILED;
+
+    xSemaphoreTake(g_ntc_alarm.lock, portMAX_DELAY);
+    wm_drv_adc_stop_it(g_ntc_alarm.dev);
+    ret = ntc_alarm_convert(mv);
+    /* a crossing while the comparator was paused would otherwise go unnoticed */
+    if (WM_ERR_SUCCESS == ret)
+        changed = ntc_alarm_update(*mv);
+    if (g_ntc_alarm.armed)
+        ntc_alarm_arm();
+    xSemaphoreGive(g_ntc_alarm.lock);
+
+    if (changed)
+        ntc_alarm_notify(*mv);
+
+    return ret;
+}
+
+void ntc_alarm_get_stat(ntc_alarm_stat_t *stat)
+{
+    *stat = g_ntc_alarm.stat;
+}
+
+/* degrees C to 0.01 C, refused when it does not fit */
+static int ntc_alarm_parse_centi(const char *str, int16_t *centi)
+{
+    float value = strtof(str, NULL) * 100;
+
+    if (!((value >= INT16_MIN) && (value <= INT16_MAX)))
+        return WM_ERR_INVALID_PARAM;
+
+    *centi = (int16_t)value;
+
+    return WM_ERR_SUCCESS;
+}
+
+static void cmd_ntc_alarm(int argc, char *argv[])
+{
+    ntc_alarm_stat_t stat;
+    int16_t limit;
+    int16_t hyst = NTC_ALARM_DEFAULT_HYST_CENTI;
+    int ret;
+
+    if ((argc > 2) && !strcmp("start", argv[1])) {
+        if ((WM_ERR_SUCCESS != ntc_alarm_parse_centi(argv[2], &limit)) ||
+            ((argc > 3) && (WM_ERR_SUCCESS != ntc_alarm_parse_centi(argv[3], &hyst)))) {
+            wm_cli_printf("temperatures must be within -327.68 .. 327.67 C\r\n");
+            return;
+        }
+        ret = ntc_alarm_start(limit, hyst, NULL, NULL);
+        wm_cli_printf("ntc alarm at %d.%02d C, clear at %d mV: ret=%d\r\n", limit / 100, abs(limit % 100),
+                      g_ntc_alarm.clear_mv, ret);
+    } else if ((argc > 1) && !strcmp("stop", argv[1])) {
+        ntc_alarm_stop();
+    } else {
+        ntc_alarm_get_stat(&stat);
+        wm_cli_printf("%s, %s, trip %d mV (code %d), clear %d mV (code %d)\r\n", ntc_alarm_armed() ? "armed" : "off",
+                      ntc_alarm_over() ? "over" : "normal", g_ntc_alarm.trip_mv, g_ntc_alarm.trip_code,
+                      g_ntc_alarm.clear_mv, g_ntc_alarm.clear_code);
+        wm_cli_printf("%u irqs, %u trips, %u clears, %u spurious, last change %u ms ago\r\n", stat.irqs, stat.trips,
+                      stat.clears, stat.spurious, stat.last_change_ms ? NOW_MS() - stat.last_change_ms : 0);
+        wm_cli_printf("offset code %d%s\r\n", stat.offset_code, stat.cal_failed ? ", nominal, calibration failed" : "");
+    }
+}
+WM_CLI_CMD_DEFINE(ntcalarm, cmd_ntc_alarm, ntcalarm cmd, ntcalarm [start <limit C> [hysteresis C] | stop] -- comparator over temperature alarm);
@@ -0,0 +1,51 @@
+#ifndef __NTC_ALARM_H__
+#define __NTC_ALARM_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Over temperature alarm on the adc comparator. The limit is turned into a threshold voltage
+ * through the ntc table, then into the conversion code the comparator works on, and the comparator
+ * watches the channel, so no cpu time is spent until it is crossed. Its interrupt only wakes the alarm task, which confirms the crossing with one
+ * conversion, flips the state, and arms the comparator the other way at limit - hysteresis.
+ * Starting calibrates the codes against the adc's trimmed offset, which takes a few tens of ms.
+ */
+#define NTC_ALARM_DEFAULT_HYST_CENTI   200
+
+/* runs in the alarm task, over is the new state, centi the conversion that confirmed it */
+typedef void (*ntc_alarm_callback_t)(bool over, int16_t centi, void *user_data);
+
+typedef struct {
+    uint32_t irqs;                     /**< comparator interrupts, several may come before the task runs */
+    uint32_t trips;
+    uint32_t clears;
+    uint32_t spurious;                 /**< wake ups the confirming conversion did not agree with */
+    uint32_t last_change_ms;
+    int32_t offset_code;               /**< the adc offset the thresholds were computed with */
+    uint32_t cal_failed;               /**< arms that fell back to the nominal offset */
+} ntc_alarm_stat_t;
+
+/* arm for limit_centi, cleared again below limit_centi - hyst_centi, cb may be NULL */
+int ntc_alarm_start(int16_t limit_centi, int16_t hyst_centi, ntc_alarm_callback_t cb, void *user_data);
+
+int ntc_alarm_stop(void);
+
+bool ntc_alarm_armed(void);
+
+bool ntc_alarm_over(void);
+
+/* one conversion while the comparator owns the channel, it is paused meanwhile */
+int ntc_alarm_oneshot(int *mv);
+
+void ntc_alarm_get_stat(ntc_alarm_stat_t *stat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __NTC_ALARM_H__ */
@@ -0,0 +1,32 @@
+/* generated by tools/gen_ntc_table.py, do not edit */
+#ifndef __NTC_TABLE_H__
+#define __NTC_TABLE_H__
+
+#include <stdint.h>
+
+/* 72 knots, -40 to 125 C, interpolation within 3 centi-degrees of the formula */
+#define NTC_TABLE_MV_MIN               12
+#define NTC_TABLE_MV_MAX               2661
+#define NTC_TABLE_MAX_ERROR_CENTI      3
+
+typedef struct {
+    uint16_t mv;
+    int16_t centi;                     /**< 0.01 C */
+} ntc_knot_t;
+
+static const ntc_knot_t ntc_table[] = {
+    {  12,  12493}, {  13,  12168}, {  14,  11873}, {  15,  11611}, {  16,  11361}, {  17,  11136},
+    {  18,  10920}, {  19,  10718}, {  21,  10356}, {  22,  10187}, {  24,   9881}, {  25,   9736},
+    {  26,   9599}, {  28,   9346}, {  30,   9110}, {  32,   8892}, {  34,   8690}, {  37,   8415},
+    {  40,   8162}, {  42,   8004}, {  45,   7786}, {  48,   7582}, {  52,   7336}, {  56,   7108},
+    {  60,   6900}, {  63,   6753}, {  67,   6570}, {  72,   6358}, {  77,   6162}, {  83,   5946},
+    {  90,   5716}, {  96,   5534}, { 103,   5338}, { 110,   5156}, { 118,   4963}, { 128,   4743},
+    { 138,   4541}, { 148,   4355}, { 159,   4165}, { 172,   3960}, { 186,   3757}, { 200,   3570},
+    { 216,   3374}, { 231,   3204}, { 247,   3035}, { 268,   2830}, { 292,   2617}, { 316,   2422},
+    { 342,   2227}, { 371,   2027}, { 405,   1813}, { 440,   1611}, { 476,   1420}, { 517,   1218},
+    { 565,   1002}, { 612,    807}, { 664,    606}, { 727,    382}, { 793,    166}, { 866,    -57},
+    { 947,   -286}, {1039,   -528}, {1140,   -776}, {1250,  -1030}, {1377,  -1307}, {1528,  -1620},
+    {1721,  -2005}, {2138,  -2823}, {2321,  -3200}, {2471,  -3531}, {2590,  -3816}, {2661,  -3999},
+};
+
+#endif /* __NTC_TABLE_H__ */
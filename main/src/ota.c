@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "wmsdk_config.h"
 #include "freertos/FreeRTOS.h"
@@ -13,6 +14,7 @@
 #include "mbedtls/base64.h"
 #include "wm_partition_table.h"
 #include "wm_drv_flash.h"
+#include "crc.h"
 
 #define LOG_TAG "ota"
 #include "wm_log.h"
@@ -27,6 +29,9 @@ typedef struct {
     size_t sign_size;                  /**< Size of the signature data in bytes. */
     wm_ota_http_cfg_t http_cfg;        /**< Configuration for HTTP operations related to the OTA process. */
     mbedtls_sha256_context sha256_ctx; /**< SHA-256 context for computing the hash of the OTA firmware file. */
+    uint32_t crc32;                    /**< Running CRC-32 of the OTA firmware file. */
+    uint32_t crc32_expected;           /**< CRC-32 announced with the update, checked when crc32_check is set. */
+    bool crc32_check;                  /**< Flag to indicate if the update message carried a CRC-32. */
 } ctx_t;
 
 static ctx_t g_ctx = { 0 }; /**< Global OTA context instance */
@@ -118,11 +123,29 @@ static int ota_progress_report(wm_ota_state_t *ota_state)
 
 static void ota_get_file_callback(uint8_t *data, uint32_t len)
 {
+    g_ctx.crc32 = crc32(g_ctx.crc32, data, len);
+
     if (0 != mbedtls_sha256_update(&g_ctx.sha256_ctx, data, len)) {
         mbedtls_sha256_free(&g_ctx.sha256_ctx);
     }
 }
 
+/* spoil the first word of the downloaded image so that it is not booted */
+static void ota_discard_image(wm_device_t *flash_dev)
+{
+    wm_partition_item_t app_ota_partition = { 0 };
+    int ret;
+
+    ret = wm_partition_table_find("app_ota", &app_ota_partition);
+    if (ret != WM_ERR_SUCCESS) {
+        wm_log_error("Failed to find 'app_ota' partition.");
+    }
+    ret = wm_drv_flash_write(flash_dev, app_ota_partition.offset, (void *)0xFFFFFFFF, 4);
+    if (ret != WM_ERR_SUCCESS) {
+        wm_log_error("Failed to write to the flash device.");
+    }
+}
+
 static void ota_state_callback(wm_ota_state_t *ota_state)
 {
     int ret                     = WM_ERR_SUCCESS;
@@ -151,6 +174,7 @@ static void ota_state_callback(wm_ota_state_t *ota_state)
     }
 
     if (ota_state->status == WM_OTA_STATUS_CONNECTED) {
+        g_ctx.crc32 = CRC32_INIT;
         mbedtls_sha256_init(&g_ctx.sha256_ctx);
         ret = mbedtls_sha256_starts(&g_ctx.sha256_ctx, false);
         if (0 != WM_ERR_SUCCESS) {
@@ -161,17 +185,14 @@ static void ota_state_callback(wm_ota_state_t *ota_state)
     if (ota_state->status == WM_OTA_STATUS_DOWNLOADED) {
         mbedtls_sha256_finish(&g_ctx.sha256_ctx, ota_file_sha256);
         mbedtls_sha256_free(&g_ctx.sha256_ctx);
-        if (ret) {
+        wm_log_info("OTA file CRC-32 %08x.", (unsigned int)g_ctx.crc32);
+        if (g_ctx.crc32_check && (g_ctx.crc32 != g_ctx.crc32_expected)) {
+            wm_log_error("OTA file CRC-32 mismatch, got %08x, expected %08x, image discarded.",
+                         (unsigned int)g_ctx.crc32, (unsigned int)g_ctx.crc32_expected);
+            ota_discard_image(flash_dev);
+        } else if (ret) {
             wm_log_error("SHA-256 ECDSA signature verification failed, ret = %d", ret);
-            wm_partition_item_t app_ota_partition = { 0 };
-            ret                                   = wm_partition_table_find("app_ota", &app_ota_partition);
-            if (ret != WM_ERR_SUCCESS) {
-                wm_log_error("Failed to find 'app_ota' partition.");
-            }
-            ret = wm_drv_flash_write(flash_dev, app_ota_partition.offset, (void *)0xFFFFFFFF, 4);
-            if (ret != WM_ERR_SUCCESS) {
-                wm_log_error("Failed to write to the flash device.");
-            }
+            ota_discard_image(flash_dev);
         } else {
             wm_log_info("SHA-256 ECDSA signature verification successful.");
             ret = set_firmware_type("UPDATE");
@@ -219,6 +240,13 @@ int ota_parse_update(char *payload)
             // return WM_ERR_OTA_SAME_VERSION;
         }
 
+        /* an optional "crc32" hex string catches a corrupted download before the signature check */
+        cJSON *crc_item   = cJSON_GetObjectItem(json, "crc32");
+        g_ctx.crc32_check = cJSON_IsString(crc_item);
+        if (g_ctx.crc32_check) {
+            g_ctx.crc32_expected = strtoul(crc_item->valuestring, NULL, 16);
+        }
+
         g_ctx.http_cfg.fw_url          = cJSON_GetObjectItem(json, "downloadUrl")->valuestring;
         g_ctx.http_cfg.ota_get_file_cb = ota_get_file_callback;
         g_ctx.http_cfg.ota_state_cb    = ota_state_callback;
@@ -0,0 +1,550 @@
+#include <stdio.h>
+#include <string.h>
+#include "wmsdk_config.h"
+#include "wm_cli.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "pixel.h"
+
+#define LOG_TAG "pixel"
+#include "wm_log.h"
+
+#define PIXEL_ALIGNED(p)               (!((uintptr_t)(p) & 3))
+
+/* 4x4 ordered dither matrix, 0 - 15 */
+static const uint8_t pixel_bayer[4][4] = {
+    { 0,  8,  2, 10},
+    {12,  4, 14,  6},
+    { 3, 11,  1,  9},
+    {15,  7, 13,  5}
+};
+
+/* big-endian 565 of one pixel, returned with the memory byte order of a little-endian halfword */
+static inline uint16_t pixel_pack(uint8_t r, uint8_t g, uint8_t b)
+{
+    uint8_t hi = (r & 0xF8) | (g >> 5);
+    uint8_t lo = ((g << 3) & 0xE0) | (b >> 3);
+
+    return (uint16_t)hi | ((uint16_t)lo << 8);
+}
+
+/* per byte r + t, g + t, b + t clamped at 0xFF, t bytes must be below 0x80 */
+static inline uint32_t pixel_add_sat8(uint32_t w, uint32_t t)
+{
+    uint32_t hi  = w & 0x80808080;
+    uint32_t sum = (w & 0x7F7F7F7F) + t;
+    uint32_t ov  = hi & sum;
+
+    return (sum ^ hi) | ((ov >> 7) * 0xFF);
+}
+
+void pixel_fill(uint8_t *dst, uint16_t color, uint32_t n)
+{
+    uint8_t hi = (uint8_t)(color >> 8);
+    uint8_t lo = (uint8_t)(color & 0x00FF);
+
+    if (!PIXEL_ALIGNED(dst) && n) {
+        *dst++ = hi;
+        *dst++ = lo;
+        n--;
+    }
+
+    if (PIXEL_ALIGNED(dst)) {
+        uint32_t word = ((uint32_t)hi | ((uint32_t)lo << 8)) * 0x00010001;
+        uint32_t *d   = (uint32_t *)dst;
+
+        for (; n >= 2; n -= 2)
+            *d++ = word;
+
+        dst = (uint8_t *)d;
+    }
+
+    for (; n; n--) {
+        *dst++ = hi;
+        *dst++ = lo;
+    }
+}
+
+void pixel_swap16(uint8_t *dst, const uint8_t *src, uint32_t n)
+{
+    if (PIXEL_ALIGNED(dst) && PIXEL_ALIGNED(src)) {
+        uint32_t *d       = (uint32_t *)dst;
+        const uint32_t *s = (const uint32_t *)src;
+
+        for (; n >= 2; n -= 2) {
+            uint32_t w = *s++;
+            *d++ = ((w & 0x00FF00FF) << 8) | ((w >> 8) & 0x00FF00FF);
+        }
+
+        dst = (uint8_t *)d;
+        src = (const uint8_t *)s;
+    }
+
+    for (; n; n--) {
+        uint8_t lo = src[0];
+        dst[0] = src[1];
+        dst[1] = lo;
+        dst += 2;
+        src += 2;
+    }
+}
+
+/* r, g and b thresholds of 4 pixels starting at (x, y), laid out like the 12 source bytes of those pixels */
+static void pixel_dither_words(uint32_t t[3], uint16_t x, uint16_t y)
+{
+    uint8_t bytes[12];
+
+    for (int i = 0; i < 4; i++) {
+        uint8_t d = pixel_bayer[y & 3][(x + i) & 3];
+
+        /* 5-bit channels drop 3 bits, the 6-bit green channel drops 2, red and blue swap places harmlessly */
+        bytes[i * 3 + 0] = d >> 1;
+        bytes[i * 3 + 1] = d >> 2;
+        bytes[i * 3 + 2] = d >> 1;
+    }
+
+    for (int i = 0; i < 3; i++)
+        t[i] = (uint32_t)bytes[i * 4] | ((uint32_t)bytes[i * 4 + 1] << 8) |
+               ((uint32_t)bytes[i * 4 + 2] << 16) | ((uint32_t)bytes[i * 4 + 3] << 24);
+}
+
+static void pixel_888_to_565(uint8_t *dst, const uint8_t *src, uint32_t n, bool bgr, bool dither, uint16_t x, uint16_t y)
+{
+    uint32_t t[3] = {0, 0, 0};
+    int ri        = bgr ? 2 : 0;
+    int bi        = bgr ? 0 : 2;
+
+    if (dither)
+        pixel_dither_words(t, x, y);
+
+    /* 4 pixels are 3 source words and 2 destination words */
+    if (PIXEL_ALIGNED(dst) && PIXEL_ALIGNED(src)) {
+        uint32_t *d       = (uint32_t *)dst;
+        const uint32_t *s = (const uint32_t *)src;
+
+        for (; n >= 4; n -= 4) {
+            uint32_t w0 = s[0];
+            uint32_t w1 = s[1];
+            uint32_t w2 = s[2];
+            uint16_t p0, p1, p2, p3;
+
+            s += 3;
+
+            if (dither) {
+                w0 = pixel_add_sat8(w0, t[0]);
+                w1 = pixel_add_sat8(w1, t[1]);
+                w2 = pixel_add_sat8(w2, t[2]);
+            }
+
+            /* w0 = c0 c1 c2 | c0', w1 = c1' c2' | c0'' c1'', w2 = c2'' | c0''' c1''' c2''' */
+            if (bgr) {
+                p0 = pixel_pack(w0 >> 16, w0 >> 8, w0);
+                p1 = pixel_pack(w1 >> 8, w1, w0 >> 24);
+                p2 = pixel_pack(w2, w1 >> 24, w1 >> 16);
+                p3 = pixel_pack(w2 >> 24, w2 >> 16, w2 >> 8);
+            } else {
+                p0 = pixel_pack(w0, w0 >> 8, w0 >> 16);
+                p1 = pixel_pack(w0 >> 24, w1, w1 >> 8);
+                p2 = pixel_pack(w1 >> 16, w1 >> 24, w2);
+                p3 = pixel_pack(w2 >> 8, w2 >> 16, w2 >> 24);
+            }
+
+            d[0] = (uint32_t)p0 | ((uint32_t)p1 << 16);
+            d[1] = (uint32_t)p2 | ((uint32_t)p3 << 16);
+            d += 2;
+        }
+
+        dst = (uint8_t *)d;
+        src = (const uint8_t *)s;
+    }
+
+    /* the fast path consumed a multiple of 4 pixels, so the dither phase is unchanged */
+    for (uint32_t i = 0; i < n; i++, src += 3) {
+        uint8_t c[3] = {src[0], src[1], src[2]};
+        uint16_t p;
+
+        if (dither) {
+            uint8_t d  = pixel_bayer[y & 3][(x + i) & 3];
+            uint8_t th[3] = {d >> 1, d >> 2, d >> 1};
+
+            for (int k = 0; k < 3; k++)
+                c[k] = (c[k] + th[k] > 0xFF) ? 0xFF : (c[k] + th[k]);
+        }
+
+        p = pixel_pack(c[ri], c[1], c[bi]);
+        *dst++ = (uint8_t)(p & 0x00FF);
+        *dst++ = (uint8_t)(p >> 8);
+    }
+}
+
+void pixel_rgb888_to_rgb565(uint8_t *dst, const uint8_t *src, uint32_t n, bool dither, uint16_t x, uint16_t y)
+{
+    pixel_888_to_565(dst, src, n, false, dither, x, y);
+}
+
+void pixel_bgr888_to_rgb565(uint8_t *dst, const uint8_t *src, uint32_t n, bool dither, uint16_t x, uint16_t y)
+{
+    pixel_888_to_565(dst, src, n, true, dither, x, y);
+}
+
+void pixel_lut_from_rgb888(uint16_t lut[256], const uint8_t *palette, uint16_t n)
+{
+    for (uint16_t i = 0; i < 256; i++) {
+        if (i < n)
+            lut[i] = pixel_pack(palette[i * 3], palette[i * 3 + 1], palette[i * 3 + 2]);
+        else
+            lut[i] = 0;
+    }
+}
+
+void pixel_pal8_to_rgb565(uint8_t *dst, const uint8_t *src, uint32_t n, const uint16_t lut[256])
+{
+    /* 4 indexes are one source word and 2 destination words */
+    if (PIXEL_ALIGNED(dst) && PIXEL_ALIGNED(src)) {
+        uint32_t *d       = (uint32_t *)dst;
+        const uint32_t *s = (const uint32_t *)src;
+
+        for (; n >= 4; n -= 4) {
+            uint32_t w = *s++;
+
+            d[0] = (uint32_t)lut[w & 0xFF] | ((uint32_t)lut[(w >> 8) & 0xFF] << 16);
+            d[1] = (uint32_t)lut[(w >> 16) & 0xFF] | ((uint32_t)lut[w >> 24] << 16);
+            d += 2;
+        }
+
+        dst = (uint8_t *)d;
+        src = (const uint8_t *)s;
+    }
+
+    for (; n; n--) {
+        uint16_t p = lut[*src++];
+        *dst++ = (uint8_t)(p & 0x00FF);
+        *dst++ = (uint8_t)(p >> 8);
+    }
+}
+
+/* alpha of 8 or 4 bits to the 0 - 32 weight of the blend */
+#define PIXEL_ALPHA8_TO_5(a)           (((uint32_t)(a) + 4) >> 3)
+#define PIXEL_ALPHA4_TO_5(a)           (((uint32_t)(a) * 34 + 15) >> 4)
+
+/* blend two native 565 pixels: g, r and b are spread over one word with gaps wide enough for the product,
+ * so that one multiply weights all three channels, the wrapped borrows only land in the gaps */
+static inline uint32_t pixel_blend565(uint32_t fg, uint32_t bg, uint32_t a)
+{
+    fg = (fg | (fg << 16)) & 0x07E0F81F;
+    bg = (bg | (bg << 16)) & 0x07E0F81F;
+    bg = (bg + (((fg - bg) * a) >> 5)) & 0x07E0F81F;
+
+    return (bg | (bg >> 16)) & 0xFFFF;
+}
+
+/* two pixels of one word in memory order, a0 and a1 their weights */
+static inline uint32_t pixel_blend_word(uint32_t d, uint32_t s, uint32_t a0, uint32_t a1)
+{
+    if (!(a0 | a1))
+        return d;
+    if ((a0 & a1) == 32)
+        return s;
+
+    /* to native halfwords, blend, and back to the lcd byte order */
+    d = ((d & 0x00FF00FF) << 8) | ((d >> 8) & 0x00FF00FF);
+    s = ((s & 0x00FF00FF) << 8) | ((s >> 8) & 0x00FF00FF);
+    d = pixel_blend565(s & 0xFFFF, d & 0xFFFF, a0) | (pixel_blend565(s >> 16, d >> 16, a1) << 16);
+
+    return ((d & 0x00FF00FF) << 8) | ((d >> 8) & 0x00FF00FF);
+}
+
+static inline void pixel_blend_one(uint8_t *dst, const uint8_t *src, uint32_t a)
+{
+    uint32_t c = pixel_blend565(((uint32_t)src[0] << 8) | src[1], ((uint32_t)dst[0] << 8) | dst[1], a);
+
+    dst[0] = (uint8_t)(c >> 8);
+    dst[1] = (uint8_t)(c & 0x00FF);
+}
+
+void pixel_blend(uint8_t *dst, const uint8_t *src, uint8_t alpha, uint32_t n)
+{
+    uint32_t a = PIXEL_ALPHA8_TO_5(alpha);
+
+    if (!a)
+        return;
+    if (a == 32) {
+        memcpy(dst, src, n * 2);
+        return;
+    }
+
+    if (PIXEL_ALIGNED(dst) && PIXEL_ALIGNED(src)) {
+        uint32_t *d       = (uint32_t *)dst;
+        const uint32_t *s = (const uint32_t *)src;
+
+        for (; n >= 2; n -= 2, d++)
+            *d = pixel_blend_word(*d, *s++, a, a);
+
+        dst = (uint8_t *)d;
+        src = (const uint8_t *)s;
+    }
+
+    for (; n; n--, dst += 2, src += 2)
+        pixel_blend_one(dst, src, a);
+}
+
+void pixel_blend_a8(uint8_t *dst, const uint8_t *src, const uint8_t *alpha, uint32_t n)
+{
+    if (PIXEL_ALIGNED(dst) && PIXEL_ALIGNED(src)) {
+        uint32_t *d       = (uint32_t *)dst;
+        const uint32_t *s = (const uint32_t *)src;
+
+        for (; n >= 2; n -= 2, d++, alpha += 2)
+            *d = pixel_blend_word(*d, *s++, PIXEL_ALPHA8_TO_5(alpha[0]), PIXEL_ALPHA8_TO_5(alpha[1]));
+
+        dst = (uint8_t *)d;
+        src = (const uint8_t *)s;
+    }
+
+    for (; n; n--, dst += 2, src += 2)
+        pixel_blend_one(dst, src, PIXEL_ALPHA8_TO_5(*alpha++));
+}
+
+void pixel_blend_a4(uint8_t *dst, const uint8_t *src, const uint8_t *alpha, uint8_t phase, uint32_t n)
+{
+    /* the word loop wants the two nibbles of one byte */
+    if (phase && n) {
+        pixel_blend_one(dst, src, PIXEL_ALPHA4_TO_5(*alpha++ & 0x0F));
+        dst += 2;
+        src += 2;
+        n--;
+    }
+
+    if (PIXEL_ALIGNED(dst) && PIXEL_ALIGNED(src)) {
+        uint32_t *d       = (uint32_t *)dst;
+        const uint32_t *s = (const uint32_t *)src;
+
+        for (; n >= 2; n -= 2, d++, alpha++)
+            *d = pixel_blend_word(*d, *s++, PIXEL_ALPHA4_TO_5(*alpha >> 4), PIXEL_ALPHA4_TO_5(*alpha & 0x0F));
+
+        dst = (uint8_t *)d;
+        src = (const uint8_t *)s;
+    }
+
+    for (uint32_t i = 0; i < n; i++, dst += 2, src += 2) {
+        uint8_t a = (i & 1) ? (alpha[i / 2] & 0x0F) : (alpha[i / 2] >> 4);
+
+        pixel_blend_one(dst, src, PIXEL_ALPHA4_TO_5(a));
+    }
+}
+
+/* plain per-pixel versions, the reference for the self check and the baseline of the benchmark */
+static void pixel_ref_swap16(uint8_t *dst, const uint8_t *src, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        uint16_t c = (uint16_t)src[i * 2] | ((uint16_t)src[i * 2 + 1] << 8);
+        dst[i * 2]     = (uint8_t)(c >> 8);
+        dst[i * 2 + 1] = (uint8_t)(c & 0x00FF);
+    }
+}
+
+static void pixel_ref_rgb888(uint8_t *dst, const uint8_t *src, uint32_t n, bool dither, uint16_t x, uint16_t y)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        int r = src[i * 3];
+        int g = src[i * 3 + 1];
+        int b = src[i * 3 + 2];
+        uint16_t c;
+
+        if (dither) {
+            int d = pixel_bayer[y & 3][(x + i) & 3];
+            r = (r + d / 2 > 255) ? 255 : r + d / 2;
+            g = (g + d / 4 > 255) ? 255 : g + d / 4;
+            b = (b + d / 2 > 255) ? 255 : b + d / 2;
+        }
+
+        c = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+        dst[i * 2]     = (uint8_t)(c >> 8);
+        dst[i * 2 + 1] = (uint8_t)(c & 0x00FF);
+    }
+}
+
+/* per channel floor(bg + (fg - bg) * a / 32), what the spread word computes */
+static void pixel_ref_blend(uint8_t *dst, const uint8_t *src, const uint8_t *alpha, uint8_t bits, uint8_t phase, uint32_t n)
+{
+    static const uint8_t shift[3] = {11, 5, 0};
+    static const uint8_t mask[3]  = {0x1F, 0x3F, 0x1F};
+
+    for (uint32_t i = 0; i < n; i++) {
+        uint16_t f = ((uint16_t)src[i * 2] << 8) | src[i * 2 + 1];
+        uint16_t b = ((uint16_t)dst[i * 2] << 8) | dst[i * 2 + 1];
+        uint16_t c = 0;
+        int a;
+
+        if (bits == 8) {
+            a = PIXEL_ALPHA8_TO_5(alpha[i]);
+        } else if (bits == 4) {
+            uint32_t k = i + phase;
+            a = PIXEL_ALPHA4_TO_5((k & 1) ? (alpha[k / 2] & 0x0F) : (alpha[k / 2] >> 4));
+        } else {
+            a = PIXEL_ALPHA8_TO_5(alpha[0]);
+        }
+
+        for (int ch = 0; ch < 3; ch++) {
+            int fc = (f >> shift[ch]) & mask[ch];
+            int bc = (b >> shift[ch]) & mask[ch];
+            int q  = (fc - bc) * a;
+
+            c |= (uint16_t)(bc + ((q >= 0) ? (q / 32) : -((-q + 31) / 32))) << shift[ch];
+        }
+
+        dst[i * 2]     = (uint8_t)(c >> 8);
+        dst[i * 2 + 1] = (uint8_t)(c & 0x00FF);
+    }
+}
+
+static void pixel_ref_pal8(uint8_t *dst, const uint8_t *src, uint32_t n, const uint8_t *palette)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        const uint8_t *p = &palette[src[i] * 3];
+        uint16_t c       = ((p[0] >> 3) << 11) | ((p[1] >> 2) << 5) | (p[2] >> 3);
+
+        dst[i * 2]     = (uint8_t)(c >> 8);
+        dst[i * 2 + 1] = (uint8_t)(c & 0x00FF);
+    }
+}
+
+#define PIXBENCH_DEFAULT_PIXELS        480
+#define PIXBENCH_DEFAULT_LOOPS         200
+
+#define NOW_MS()                       (xTaskGetTickCount() * portTICK_PERIOD_MS)
+
+enum {
+    PIXBENCH_SWAP16 = 0,
+    PIXBENCH_RGB888,
+    PIXBENCH_RGB888_DITHER,
+    PIXBENCH_PAL8,
+    PIXBENCH_BLEND,
+    PIXBENCH_BLEND_A8,
+    PIXBENCH_BLEND_A4,
+    PIXBENCH_MAX
+};
+
+static const char *pixbench_name[PIXBENCH_MAX] = {"swap16", "rgb888", "rgb888+dither", "pal8", "blend", "blend a8", "blend a4"};
+
+/* the blend alpha is taken from the source bytes past the pixels, a fixed 50% for the constant blend */
+static const uint8_t pixbench_half = 0x80;
+
+static void pixbench_call(int kernel, bool fast, uint8_t *dst, const uint8_t *src, uint32_t n,
+                          const uint8_t *palette, const uint16_t *lut, uint16_t y)
+{
+    const uint8_t *alpha = src + n * 2;
+
+    switch (kernel) {
+        case PIXBENCH_SWAP16:
+            fast ? pixel_swap16(dst, src, n) : pixel_ref_swap16(dst, src, n);
+            break;
+        case PIXBENCH_RGB888:
+            fast ? pixel_rgb888_to_rgb565(dst, src, n, false, 0, y) : pixel_ref_rgb888(dst, src, n, false, 0, y);
+            break;
+        case PIXBENCH_RGB888_DITHER:
+            fast ? pixel_rgb888_to_rgb565(dst, src, n, true, 0, y) : pixel_ref_rgb888(dst, src, n, true, 0, y);
+            break;
+        case PIXBENCH_PAL8:
+            fast ? pixel_pal8_to_rgb565(dst, src, n, lut) : pixel_ref_pal8(dst, src, n, palette);
+            break;
+        case PIXBENCH_BLEND:
+            fast ? pixel_blend(dst, src, pixbench_half, n) : pixel_ref_blend(dst, src, &pixbench_half, 0, 0, n);
+            break;
+        case PIXBENCH_BLEND_A8:
+            fast ? pixel_blend_a8(dst, src, alpha, n) : pixel_ref_blend(dst, src, alpha, 8, 0, n);
+            break;
+        case PIXBENCH_BLEND_A4:
+            fast ? pixel_blend_a4(dst, src, alpha, y & 1, n) : pixel_ref_blend(dst, src, alpha, 4, y & 1, n);
+            break;
+        default:
+            break;
+    }
+}
+
+static void cmd_pixbench(int argc, char *argv[])
+{
+    uint32_t n       = (argc > 1) ? atoi(argv[1]) : PIXBENCH_DEFAULT_PIXELS;
+    uint32_t loops   = (argc > 2) ? atoi(argv[2]) : PIXBENCH_DEFAULT_LOOPS;
+    uint8_t *src     = NULL;
+    uint8_t *dst     = NULL;
+    uint8_t *ref     = NULL;
+    uint8_t *palette = NULL;
+    uint16_t *lut    = NULL;
+    uint32_t seed    = 0x12345678;
+
+    if (!n || !loops)
+        return;
+
+    /* one spare pixel for the unaligned check */
+    src     = malloc(n * 3 + 4);
+    dst     = malloc(n * 2 + 4);
+    ref     = malloc(n * 2 + 4);
+    palette = malloc(256 * 3);
+    lut     = malloc(256 * sizeof(uint16_t));
+
+    if (!src || !dst || !ref || !palette || !lut) {
+        wm_cli_printf("mem err\r\n");
+        goto exit;
+    }
+
+    for (uint32_t i = 0; i < n * 3 + 4; i++) {
+        seed   = seed * 1103515245 + 12345;
+        src[i] = (uint8_t)(seed >> 16);
+    }
+
+    /* fully transparent and fully opaque stretches in the alpha bytes, the blends skip or copy those */
+    memset(src + n * 2, 0x00, n / 4);
+    memset(src + n * 2 + n / 4, 0xFF, n / 4);
+
+    for (int i = 0; i < 256 * 3; i++)
+        palette[i] = (uint8_t)(i * 7);
+
+    pixel_lut_from_rgb888(lut, palette, 256);
+
+    wm_cli_printf("kernel          naive(ms)  fast(ms)  Mpix/s  check\r\n");
+
+    for (int k = 0; k < PIXBENCH_MAX; k++) {
+        uint32_t start;
+        uint32_t naive_ms;
+        uint32_t fast_ms;
+        bool ok = true;
+
+        /* check every dither row phase, then the unaligned fallback, the blends start from the same background */
+        for (uint16_t y = 0; (y < 4) && ok; y++) {
+            memcpy(ref, src + n, n * 2);
+            memcpy(dst, src + n, n * 2);
+            pixbench_call(k, false, ref, src, n, palette, lut, y);
+            pixbench_call(k, true, dst, src, n, palette, lut, y);
+            ok = !memcmp(ref, dst, n * 2);
+        }
+        if (ok) {
+            memcpy(ref, src + n, n * 2);
+            memcpy(dst + 2, src + n, n * 2);
+            pixbench_call(k, false, ref, src + 1, n, palette, lut, 0);
+            pixbench_call(k, true, dst + 2, src + 1, n, palette, lut, 0);
+            ok = !memcmp(ref, dst + 2, n * 2);
+        }
+
+        start = NOW_MS();
+        for (uint32_t i = 0; i < loops; i++)
+            pixbench_call(k, false, ref, src, n, palette, lut, i);
+        naive_ms = NOW_MS() - start;
+
+        start = NOW_MS();
+        for (uint32_t i = 0; i < loops; i++)
+            pixbench_call(k, true, dst, src, n, palette, lut, i);
+        fast_ms = NOW_MS() - start;
+
+        wm_cli_printf("%-14s  %9u  %8u  %6.2f  %s\r\n", pixbench_name[k], naive_ms, fast_ms,
+                      (float)n * loops / (fast_ms ? fast_ms : 1) / 1000, ok ? "ok" : "FAIL");
+    }
+
+exit:
+    free(src);
+    free(dst);
+    free(ref);
+    free(palette);
+    free(lut);
+}
+WM_CLI_CMD_DEFINE(pixbench, cmd_pixbench, pixbench cmd, pixbench [pixels] [loops] -- check and benchmark pixel kernels against per-pixel loops);
@@ -0,0 +1,47 @@
+#ifndef __PIXEL_H__
+#define __PIXEL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Pixel format kernels. All outputs are rgb565 in the lcd byte order (high byte first),
+ * the same layout as image.h and the band buffers in lcd.c.
+ * The fast paths move 2 or 4 pixels per 32-bit word and need dst and src 4-byte aligned,
+ * unaligned buffers are converted one pixel at a time with the same result.
+ */
+
+/* fill n pixels with one color */
+void pixel_fill(uint8_t *dst, uint16_t color, uint32_t n);
+
+/* swap the bytes of n rgb565 pixels, converts little-endian 565 to the lcd order and back, dst may be src */
+void pixel_swap16(uint8_t *dst, const uint8_t *src, uint32_t n);
+
+/* n pixels of 3 bytes each, (x, y) is the screen position of the first pixel, used by the dither matrix.
+ * dst may overlap src as long as dst <= src */
+void pixel_rgb888_to_rgb565(uint8_t *dst, const uint8_t *src, uint32_t n, bool dither, uint16_t x, uint16_t y);
+void pixel_bgr888_to_rgb565(uint8_t *dst, const uint8_t *src, uint32_t n, bool dither, uint16_t x, uint16_t y);
+
+/* build a lut for pixel_pal8_to_rgb565 from a palette of n rgb888 entries */
+void pixel_lut_from_rgb888(uint16_t lut[256], const uint8_t *palette, uint16_t n);
+
+/* expand n 8-bit palette indexes through a lut built by pixel_lut_from_rgb888 */
+void pixel_pal8_to_rgb565(uint8_t *dst, const uint8_t *src, uint32_t n, const uint16_t lut[256]);
+
+/* blend n overlay pixels from src over dst. alpha 0 keeps dst, 255 (or 15 for 4 bits) takes src,
+ * it is reduced to 33 levels so that two pixels blend with one multiply each */
+void pixel_blend(uint8_t *dst, const uint8_t *src, uint8_t alpha, uint32_t n);
+/* one alpha byte per pixel */
+void pixel_blend_a8(uint8_t *dst, const uint8_t *src, const uint8_t *alpha, uint32_t n);
+/* two alpha nibbles per byte, high nibble first, the first pixel uses nibble phase (0 or 1) of alpha[0] */
+void pixel_blend_a4(uint8_t *dst, const uint8_t *src, const uint8_t *alpha, uint8_t phase, uint32_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PIXEL_H__ */
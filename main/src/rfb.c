@@ -0,0 +1,553 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "wmsdk_config.h"
+#include "wm_drv_tft_lcd.h"
+#include "wm_cli.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+#include "lwip/inet.h"
+#include "lcd.h"
+#include "pixel.h"
+#include "display.h"
+#include "rfb.h"
+
+#define LOG_TAG "rfb"
+#include "wm_log.h"
+
+/* protocol, see tools/rfb_push.py, all fields little-endian */
+#define RFB_MAGIC                      "WRFB"
+#define RFB_VERSION                    1
+#define RFB_PIXEL_RGB565_BE            0
+#define RFB_HELLO_SIZE                 12
+#define RFB_MSG_HEADER_SIZE            4
+#define RFB_TILE_HEADER_SIZE           16
+#define RFB_MSG_UPDATE                 1
+#define RFB_ENC_RAW                    0
+#define RFB_ENC_SOLID                  1
+#define RFB_ENC_RLE                    2
+#define RFB_RLE_REPEAT                 0x8000
+#define RFB_RLE_COUNT_MASK             0x7FFF
+#define RFB_STATUS_OK                  0
+#define RFB_STATUS_ERROR               1
+
+#define RFB_TASK_STACK                 1024
+#define RFB_TASK_PRIO                  1
+/* receive timeouts wake the task this often to see if it was stopped */
+#define RFB_POLL_MS                    1000
+/* a message that stalls for this long drops the client */
+#define RFB_TIMEOUT_MS                 5000
+#define RFB_RX_SIZE                    512
+#define RFB_BAND_LINES                 32
+/* the task notices a stop within a receive timeout, and an accept timeout on its way out */
+#define RFB_STOP_MS                    (3 * RFB_POLL_MS)
+
+#define NOW_MS()                       (xTaskGetTickCount() * portTICK_PERIOD_MS)
+
+typedef struct {
+    TaskHandle_t task;
+    volatile bool running;
+    uint16_t port;
+    wm_device_t *dev;
+    uint16_t width;
+    uint16_t high;
+
+    int sock;
+    uint8_t rx[RFB_RX_SIZE];
+    uint16_t rx_pos;
+    uint16_t rx_len;
+    uint32_t rx_total;                 /**< bytes taken from rx on this connection */
+    lcd_band_t band;
+
+    rfb_stat_t stat;
+    uint32_t window_start;
+    uint32_t window_tiles;
+    uint32_t window_bytes;
+} rfb_ctx_t;
+
+/* the tile being drawn, each band of it is its own lcd window */
+typedef struct {
+    uint16_t x;
+    uint16_t y;
+    uint16_t w;
+    uint16_t h;
+    uint16_t row;                      /**< lines on the lcd so far */
+    uint32_t line_size;
+} rfb_tile_t;
+
+static rfb_ctx_t g_rfb = { 0 };
+
+static uint16_t rfb_le16(const uint8_t *p)
+{
+    return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+static uint32_t rfb_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* read len bytes through the rx buffer, idle waits for the next message as long as the service runs */
+static int rfb_read(rfb_ctx_t *ctx, void *dst, uint32_t len, bool idle)
+{
+    uint8_t *p       = dst;
+    uint32_t waited  = 0;
+    uint32_t n;
+    int ret;
+
+    while (len) {
+        if (ctx->rx_pos == ctx->rx_len) {
+            /* a client that keeps trickling data never times out, look before every receive */
+            if (!ctx->running)
+                return WM_ERR_FAILED;
+
+            ret = recv(ctx->sock, ctx->rx, sizeof(ctx->rx), 0);
+            if (ret == 0)
+                return WM_ERR_FAILED;
+            if (ret < 0) {
+                if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+                    return WM_ERR_FAILED;
+                waited += RFB_POLL_MS;
+                if (!idle && (waited >= RFB_TIMEOUT_MS))
+                    return WM_ERR_TIMEOUT;
+                continue;
+            }
+
+            ctx->rx_pos = 0;
+            ctx->rx_len = ret;
+        }
+
+        n = ctx->rx_len - ctx->rx_pos;
+        if (n > len)
+            n = len;
+
+        memcpy(p, ctx->rx + ctx->rx_pos, n);
+
+        p             += n;
+        ctx->rx_pos   += n;
+        ctx->rx_total += n;
+        len           -= n;
+        idle           = false;
+        waited         = 0;
+    }
+
+    return WM_ERR_SUCCESS;
+}
+
+/*
+ * the next lines of the tile from the band buffer to the lcd; the display is locked only while they
+ * are written, never while the socket is read, so a slow client cannot hold up other display users
+ */
+static int rfb_put_lines(rfb_ctx_t *ctx, rfb_tile_t *tile, uint32_t len)
+{
+    lcd_stream_t stream;
+    uint16_t lines = len / tile->line_size;
+    int ret;
+
+    display_lock();
+    ret = lcd_stream_begin(&stream, ctx->dev, tile->x, tile->y + tile->row, tile->w, lines);
+    if (ret == WM_ERR_SUCCESS)
+        ret = lcd_stream_write(&stream, ctx->band.buf, len);
+    if (ret == WM_ERR_SUCCESS)
+        ret = lcd_stream_end(&stream);
+    display_unlock();
+
+    if (ret == WM_ERR_SUCCESS)
+        tile->row += lines;
+
+    return ret;
+}
+
+/* raw pixels are read a band at a time, solid tiles fill the band once and send it as often as needed */
+static int rfb_draw_lines(rfb_ctx_t *ctx, rfb_tile_t *tile, uint8_t enc, uint16_t color)
+{
+    uint32_t line_size = tile->line_size;
+    uint16_t lines     = ctx->band.len / line_size;
+    uint16_t n;
+    int ret            = WM_ERR_SUCCESS;
+
+    if (enc == RFB_ENC_SOLID)
+        pixel_fill(ctx->band.buf, color, (uint32_t)tile->w * ((lines < tile->h) ? lines : tile->h));
+
+    for (uint16_t i = 0; (i < tile->h) && (ret == WM_ERR_SUCCESS); i += n) {
+        n = (lines < tile->h - i) ? lines : (tile->h - i);
+
+        if (enc == RFB_ENC_RAW) {
+            ret = rfb_read(ctx, ctx->band.buf, n * line_size, false);
+            if (ret != WM_ERR_SUCCESS)
+                break;
+        }
+
+        ret = rfb_put_lines(ctx, tile, n * line_size);
+    }
+
+    return ret;
+}
+
+/* the same tokens as the animation container, runs may cross lines and bands */
+static int rfb_draw_rle(rfb_ctx_t *ctx, rfb_tile_t *tile)
+{
+    uint8_t token[2];
+    uint8_t pixel[2];
+    uint32_t total = (uint32_t)tile->w * tile->h;
+    uint32_t space = ctx->band.len / tile->line_size * tile->w;
+    uint32_t fill  = 0;
+    uint32_t count;
+    uint32_t n;
+    bool repeat;
+    int ret;
+
+    while (total) {
+        ret = rfb_read(ctx, token, sizeof(token), false);
+        if (ret != WM_ERR_SUCCESS)
+            return ret;
+
+        count  = rfb_le16(token) & RFB_RLE_COUNT_MASK;
+        repeat = rfb_le16(token) & RFB_RLE_REPEAT;
+        if (!count || (count > total))
+            return WM_ERR_INVALID_PARAM;
+
+        if (repeat) {
+            ret = rfb_read(ctx, pixel, sizeof(pixel), false);
+            if (ret != WM_ERR_SUCCESS)
+                return ret;
+        }
+
+        while (count) {
+            n = (count > space - fill) ? (space - fill) : count;
+
+            if (repeat) {
+                pixel_fill(ctx->band.buf + fill * WM_CFG_TFT_LCD_PIXEL_WIDTH, ((uint16_t)pixel[0] << 8) | pixel[1], n);
+            } else {
+                ret = rfb_read(ctx, ctx->band.buf + fill * WM_CFG_TFT_LCD_PIXEL_WIDTH, n * WM_CFG_TFT_LCD_PIXEL_WIDTH, false);
+                if (ret != WM_ERR_SUCCESS)
+                    return ret;
+            }
+
+            fill  += n;
+            count -= n;
+            total -= n;
+
+            /* whole lines either way, the band holds whole lines and the tile ends on one */
+            if ((fill == space) || !total) {
+                ret = rfb_put_lines(ctx, tile, fill * WM_CFG_TFT_LCD_PIXEL_WIDTH);
+                if (ret != WM_ERR_SUCCESS)
+                    return ret;
+                fill = 0;
+            }
+        }
+    }
+
+    return WM_ERR_SUCCESS;
+}
+
+static int rfb_draw_tile(rfb_ctx_t *ctx)
+{
+    rfb_tile_t tile = { 0 };
+    uint8_t hdr[RFB_TILE_HEADER_SIZE];
+    uint8_t color[2];
+    uint16_t x;
+    uint16_t y;
+    uint16_t w;
+    uint16_t h;
+    uint8_t enc;
+    uint32_t len;
+    uint32_t start;
+    int ret;
+
+    ret = rfb_read(ctx, hdr, sizeof(hdr), false);
+    if (ret != WM_ERR_SUCCESS)
+        return ret;
+
+    x   = rfb_le16(&hdr[0]);
+    y   = rfb_le16(&hdr[2]);
+    w   = rfb_le16(&hdr[4]);
+    h   = rfb_le16(&hdr[6]);
+    enc = hdr[8];
+    len = rfb_le32(&hdr[12]);
+
+    /* the payload length is checked against what each encoding must take */
+    if (!w || !h || (x + w > ctx->width) || (y + h > ctx->high) ||
+        ((enc == RFB_ENC_RAW) && (len != (uint32_t)w * h * WM_CFG_TFT_LCD_PIXEL_WIDTH)) ||
+        ((enc == RFB_ENC_SOLID) && (len != sizeof(color))) || (enc > RFB_ENC_RLE)) {
+        wm_log_error("bad tile %ux%u at %u,%u enc %u len %u", w, h, x, y, enc, len);
+        return WM_ERR_INVALID_PARAM;
+    }
+
+    if (enc == RFB_ENC_SOLID) {
+        ret = rfb_read(ctx, color, sizeof(color), false);
+        if (ret != WM_ERR_SUCCESS)
+            return ret;
+    }
+
+    tile.x         = x;
+    tile.y         = y;
+    tile.w         = w;
+    tile.h         = h;
+    tile.line_size = (uint32_t)w * WM_CFG_TFT_LCD_PIXEL_WIDTH;
+
+    start = ctx->rx_total;
+    if (enc == RFB_ENC_RLE) {
+        ret = rfb_draw_rle(ctx, &tile);
+        if ((ret == WM_ERR_SUCCESS) && (ctx->rx_total - start != len)) {
+            wm_log_error("rle tile is %u bytes, header says %u", ctx->rx_total - start, len);
+            ret = WM_ERR_INVALID_PARAM;
+        }
+    } else {
+        ret = rfb_draw_lines(ctx, &tile, enc, ((uint16_t)color[0] << 8) | color[1]);
+    }
+
+    return ret;
+}
+
+static void rfb_update_rate(rfb_ctx_t *ctx)
+{
+    uint32_t now     = NOW_MS();
+    uint32_t elapsed = now - ctx->window_start;
+
+    if (elapsed < 1000)
+        return;
+
+    ctx->stat.tiles_per_s = ctx->window_tiles * 1000 / elapsed;
+    ctx->stat.bytes_per_s = ctx->window_bytes * 1000 / elapsed;
+    ctx->window_start     = now;
+    ctx->window_tiles     = 0;
+    ctx->window_bytes     = 0;
+}
+
+/* one update: header, tiles, then a reply so that the back-end can pace itself */
+static int rfb_handle_message(rfb_ctx_t *ctx)
+{
+    uint8_t msg[RFB_MSG_HEADER_SIZE];
+    uint8_t reply[4];
+    uint32_t rx_start;
+    uint32_t start;
+    uint16_t count;
+    uint16_t done = 0;
+    int ret;
+
+    ret = rfb_read(ctx, msg, sizeof(msg), true);
+    if (ret != WM_ERR_SUCCESS)
+        return ret;
+
+    if (msg[0] != RFB_MSG_UPDATE) {
+        wm_log_error("unknown message %u", msg[0]);
+        return WM_ERR_INVALID_PARAM;
+    }
+
+    count    = rfb_le16(&msg[2]);
+    rx_start = ctx->rx_total - sizeof(msg);
+    start    = NOW_MS();
+
+    while ((done < count) && (ret == WM_ERR_SUCCESS)) {
+        ret = rfb_draw_tile(ctx);
+        if (ret == WM_ERR_SUCCESS)
+            done++;
+    }
+
+    ctx->stat.draw_ms += NOW_MS() - start;
+    ctx->stat.tiles += done;
+    ctx->stat.bytes += ctx->rx_total - rx_start;
+    ctx->window_tiles += done;
+    ctx->window_bytes += ctx->rx_total - rx_start;
+    if (ret == WM_ERR_SUCCESS)
+        ctx->stat.updates++;
+
+    reply[0] = RFB_MSG_UPDATE;
+    reply[1] = (ret == WM_ERR_SUCCESS) ? RFB_STATUS_OK : RFB_STATUS_ERROR;
+    reply[2] = (uint8_t)(done & 0xFF);
+    reply[3] = (uint8_t)(done >> 8);
+    send(ctx->sock, reply, sizeof(reply), 0);
+
+    return ret;
+}
+
+static void rfb_serve(rfb_ctx_t *ctx)
+{
+    struct timeval timeout = { RFB_POLL_MS / 1000, (RFB_POLL_MS % 1000) * 1000 };
+    uint8_t hello[RFB_HELLO_SIZE];
+    int ret;
+
+    setsockopt(ctx->sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    ret = lcd_band_alloc(&ctx->band, ctx->width * WM_CFG_TFT_LCD_PIXEL_WIDTH, RFB_BAND_LINES, 0);
+    if (ret != WM_ERR_SUCCESS)
+        return;
+
+    memcpy(hello, RFB_MAGIC, 4);
+    hello[4]  = RFB_VERSION;
+    hello[5]  = 0;
+    hello[6]  = (uint8_t)(ctx->width & 0xFF);
+    hello[7]  = (uint8_t)(ctx->width >> 8);
+    hello[8]  = (uint8_t)(ctx->high & 0xFF);
+    hello[9]  = (uint8_t)(ctx->high >> 8);
+    hello[10] = RFB_PIXEL_RGB565_BE;
+    hello[11] = 0;
+
+    ctx->rx_pos   = 0;
+    ctx->rx_len   = 0;
+    ctx->rx_total = 0;
+
+    if (send(ctx->sock, hello, sizeof(hello), 0) == sizeof(hello)) {
+        while (ctx->running) {
+            ret = rfb_handle_message(ctx);
+            rfb_update_rate(ctx);
+            if (ret != WM_ERR_SUCCESS) {
+                /* a closed connection is not an error, a bad message or a stalled one is */
+                if (ret != WM_ERR_FAILED)
+                    ctx->stat.errors++;
+                break;
+            }
+        }
+    }
+
+    lcd_band_free(&ctx->band);
+}
+
+static void rfb_task(void *param)
+{
+    struct timeval timeout   = { RFB_POLL_MS / 1000, (RFB_POLL_MS % 1000) * 1000 };
+    struct sockaddr_in addr  = { 0 };
+    struct sockaddr_in peer;
+    socklen_t peer_len;
+    int listener;
+    int opt                  = 1;
+
+    listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener < 0) {
+        wm_log_error("socket fail");
+        goto exit;
+    }
+
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(g_rfb.port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    setsockopt(listener, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    if ((bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0) || (listen(listener, 1) != 0)) {
+        wm_log_error("listen on %u fail", g_rfb.port);
+        goto exit;
+    }
+
+    wm_log_info("listening on %u", g_rfb.port);
+
+    while (g_rfb.running) {
+        peer_len   = sizeof(peer);
+        g_rfb.sock = accept(listener, (struct sockaddr *)&peer, &peer_len);
+        if (g_rfb.sock < 0) {
+            rfb_update_rate(&g_rfb);
+            continue;
+        }
+
+        g_rfb.stat.connections++;
+        wm_log_info("client %s", inet_ntoa(peer.sin_addr));
+
+        /* small tiles go out as soon as they are written */
+        setsockopt(g_rfb.sock, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+        rfb_serve(&g_rfb);
+
+        close(g_rfb.sock);
+        g_rfb.sock = -1;
+        wm_log_info("client closed");
+    }
+
+exit:
+    if (listener >= 0)
+        close(listener);
+
+    g_rfb.running = false;
+    g_rfb.task    = NULL;
+    vTaskDelete(NULL);
+}
+
+/* the task clears its handle as the last thing before it deletes itself */
+static int rfb_wait_exit(void)
+{
+    uint32_t start = NOW_MS();
+
+    while (g_rfb.task) {
+        if (NOW_MS() - start > RFB_STOP_MS)
+            return WM_ERR_TIMEOUT;
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    return WM_ERR_SUCCESS;
+}
+
+int rfb_start(uint16_t port)
+{
+    wm_lcd_capabilitys_t cap = { 0 };
+
+    if (g_rfb.task && g_rfb.running)
+        return WM_ERR_SUCCESS;
+
+    /* stopped but still on its way out, its exit would race the new task */
+    if (rfb_wait_exit() != WM_ERR_SUCCESS)
+        return WM_ERR_BUSY;
+
+    g_rfb.dev = lcd_get_device();
+    if (!g_rfb.dev)
+        return WM_ERR_FAILED;
+
+    wm_drv_tft_lcd_get_capability(g_rfb.dev, &cap);
+
+    g_rfb.width        = cap.x_resolution;
+    g_rfb.high         = cap.y_resolution;
+    g_rfb.port         = port ? port : RFB_DEFAULT_PORT;
+    g_rfb.sock         = -1;
+    g_rfb.window_start = NOW_MS();
+
+    g_rfb.running = true;
+    if (pdPASS != xTaskCreate(rfb_task, "rfb", RFB_TASK_STACK, NULL, RFB_TASK_PRIO, &g_rfb.task)) {
+        g_rfb.running = false;
+        g_rfb.task    = NULL;
+        return WM_ERR_NO_MEM;
+    }
+
+    return WM_ERR_SUCCESS;
+}
+
+/* the task sees the flag at its next receive, closes the client and exits; wait for it */
+void rfb_stop(void)
+{
+    g_rfb.running = false;
+
+    if (rfb_wait_exit() != WM_ERR_SUCCESS)
+        wm_log_warn("task still running");
+}
+
+void rfb_get_stat(rfb_stat_t *stat)
+{
+    *stat = g_rfb.stat;
+}
+
+static void cmd_rfb(int argc, char *argv[])
+{
+    rfb_stat_t stat;
+    int ret;
+
+    if (argc < 2)
+        return;
+
+    if (!strcmp("start", argv[1])) {
+        ret = rfb_start((argc > 2) ? (uint16_t)strtoul(argv[2], NULL, 0) : 0);
+        if (ret != WM_ERR_SUCCESS) {
+            wm_log_error("rfb_start ret=%d", ret);
+        }
+    } else if (!strcmp("stop", argv[1])) {
+        rfb_stop();
+    } else if (!strcmp("stat", argv[1])) {
+        rfb_get_stat(&stat);
+        wm_cli_printf("%s, %u connections, %u errors\r\n", g_rfb.running ? "running" : "stopped",
+                      stat.connections, stat.errors);
+        wm_cli_printf("%u updates, %u tiles, %u bytes, %u ms drawing\r\n", stat.updates, stat.tiles, stat.bytes,
+                      stat.draw_ms);
+        wm_cli_printf("last second: %u tiles/s, %u bytes/s\r\n", stat.tiles_per_s, stat.bytes_per_s);
+    }
+}
+WM_CLI_CMD_DEFINE(rfb, cmd_rfb, rfb cmd, rfb <start [port] | stop | stat> -- receive screen tiles over tcp);
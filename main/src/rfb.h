@@ -0,0 +1,36 @@
+#ifndef __RFB_H__
+#define __RFB_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RFB_DEFAULT_PORT               5900
+
+typedef struct {
+    uint32_t connections;
+    uint32_t updates;                  /**< update messages applied */
+    uint32_t tiles;
+    uint32_t bytes;                    /**< received, headers included */
+    uint32_t errors;                   /**< connections closed on a bad message or an lcd error */
+    uint32_t draw_ms;                  /**< time from an update header to its last tile on the lcd */
+    uint32_t tiles_per_s;              /**< over the last second */
+    uint32_t bytes_per_s;
+} rfb_stat_t;
+
+/*
+ * Write-only remote framebuffer: a back-end connects over tcp and pushes tiles of the screen,
+ * raw, solid or rle coded, each is decoded straight into its lcd window.
+ * One client at a time, see tools/rfb_push.py for the protocol.
+ */
+int rfb_start(uint16_t port);
+void rfb_stop(void);
+void rfb_get_stat(rfb_stat_t *stat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RFB_H__ */
@@ -0,0 +1,466 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wmsdk_config.h"
+#include "wm_cli.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "tsdb.h"
+#include "rollup.h"
+
+#define LOG_TAG "rollup"
+#include "wm_log.h"
+
+/* five records a bucket, a minute of three series fills a block every four minutes */
+#define ROLLUP_MIN_BLOCKS              16384
+#define ROLLUP_HOUR_BLOCKS             4096
+#define ROLLUP_DAY_BLOCKS              1024
+
+#define ROLLUP_SERIES_MASK             0x0FFF
+
+/* the stats a bucket cannot do without, buckets written before the count had a high half lack it */
+#define ROLLUP_STATS_NEEDED            ((1 << ROLLUP_STAT_MIN) | (1 << ROLLUP_STAT_MAX) | (1 << ROLLUP_STAT_AVG))
+
+#define ROLLUP_PRINT_MAX               64
+
+#define NOW_MS()                       (xTaskGetTickCount() * portTICK_PERIOD_MS)
+
+typedef struct {
+    const char *name;
+    uint32_t period;                   /**< seconds */
+    uint32_t start_block;
+    uint32_t blocks;
+} rollup_tier_t;
+
+typedef struct {
+    uint32_t start;                    /**< of the bucket being filled */
+    int16_t min;
+    int16_t max;
+    int64_t sum;
+    uint32_t count;                    /**< 0 when there is none */
+} rollup_acc_t;
+
+typedef struct {
+    uint16_t series;
+    uint32_t resolution;
+    rollup_visit_t visit;
+    void *arg;
+    rollup_query_stat_t *stat;
+    bool done;
+
+    rollup_bucket_t part;              /**< tier bucket being put together from its records */
+    uint8_t have;                      /**< its stats seen so far */
+
+    rollup_bucket_t out;               /**< bucket of resolution being merged */
+    int64_t sum;
+} rollup_query_t;
+
+static const rollup_tier_t g_rollup_tiers[ROLLUP_TIERS] = {
+    { "1min", 60,    ROLLUP_START,                                         ROLLUP_MIN_BLOCKS  },
+    { "1h",   3600,  ROLLUP_START + ROLLUP_MIN_BLOCKS,                     ROLLUP_HOUR_BLOCKS },
+    { "1day", 86400, ROLLUP_START + ROLLUP_MIN_BLOCKS + ROLLUP_HOUR_BLOCKS, ROLLUP_DAY_BLOCKS  },
+};
+
+static struct {
+    SemaphoreHandle_t lock;
+    tsdb_t db[ROLLUP_TIERS];
+    rollup_acc_t acc[ROLLUP_TIERS][ROLLUP_MAX_SERIES];
+    uint32_t last_time;
+    uint32_t samples;
+    uint32_t buckets[ROLLUP_TIERS];    /**< written to the card */
+    uint32_t errors;
+} g_rollup = { 0 };
+
+/* the sampler task and the cli may both come first, only one mutex is kept */
+static int rollup_lock_init(void)
+{
+    SemaphoreHandle_t lock;
+
+    if (g_rollup.lock)
+        return WM_ERR_SUCCESS;
+
+    lock = xSemaphoreCreateMutex();
+    if (!lock)
+        return WM_ERR_NO_MEM;
+
+    taskENTER_CRITICAL();
+    if (!g_rollup.lock) {
+        g_rollup.lock = lock;
+        lock          = NULL;
+    }
+    taskEXIT_CRITICAL();
+
+    if (lock)
+        vSemaphoreDelete(lock);
+
+    return WM_ERR_SUCCESS;
+}
+
+/* the lock and the tier stores, opened on first use */
+static int rollup_open(void)
+{
+    int ret = WM_ERR_SUCCESS;
+
+    ret = rollup_lock_init();
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    xSemaphoreTake(g_rollup.lock, portMAX_DELAY);
+
+    for (int i = 0; (WM_ERR_SUCCESS == ret) && (i < ROLLUP_TIERS); i++) {
+        if (g_rollup.db[i].dev)
+            continue;
+
+        ret = tsdb_open(&g_rollup.db[i], g_rollup_tiers[i].start_block, g_rollup_tiers[i].blocks);
+        if (WM_ERR_SUCCESS != ret)
+            wm_log_error("open %s ret=%d", g_rollup_tiers[i].name, ret);
+    }
+
+    xSemaphoreGive(g_rollup.lock);
+
+    return ret;
+}
+
+static int rollup_write(int tier, uint16_t series, rollup_acc_t *acc)
+{
+    tsdb_t *db = &g_rollup.db[tier];
+    int ret;
+
+    ret = tsdb_append(db, acc->start, ROLLUP_SERIES(series, ROLLUP_STAT_MIN), acc->min);
+    if (WM_ERR_SUCCESS == ret)
+        ret = tsdb_append(db, acc->start, ROLLUP_SERIES(series, ROLLUP_STAT_MAX), acc->max);
+    if (WM_ERR_SUCCESS == ret)
+        ret = tsdb_append(db, acc->start, ROLLUP_SERIES(series, ROLLUP_STAT_AVG),
+                          (int16_t)(acc->sum / (int64_t)acc->count));
+    /* the count in two halves, a day of samples a second is more than 16 bits; the low half goes last */
+    if (WM_ERR_SUCCESS == ret)
+        ret = tsdb_append(db, acc->start, ROLLUP_SERIES(series, ROLLUP_STAT_COUNT_HI),
+                          (int16_t)(uint16_t)(acc->count >> 16));
+    if (WM_ERR_SUCCESS == ret)
+        ret = tsdb_append(db, acc->start, ROLLUP_SERIES(series, ROLLUP_STAT_COUNT),
+                          (int16_t)(uint16_t)(acc->count & 0xFFFF));
+
+    if (WM_ERR_SUCCESS == ret)
+        g_rollup.buckets[tier]++;
+    else
+        g_rollup.errors++;
+
+    acc->count = 0;
+
+    return ret;
+}
+
+int rollup_add(uint16_t series, uint32_t time, int16_t value)
+{
+    rollup_acc_t *acc;
+    uint32_t start;
+    int ret;
+
+    if (!series || (series >= ROLLUP_MAX_SERIES))
+        return WM_ERR_INVALID_PARAM;
+
+    ret = rollup_open();
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    xSemaphoreTake(g_rollup.lock, portMAX_DELAY);
+
+    if (time < g_rollup.last_time) {
+        xSemaphoreGive(g_rollup.lock);
+        return WM_ERR_INVALID_PARAM;
+    }
+    g_rollup.last_time = time;
+    g_rollup.samples++;
+
+    for (int i = 0; i < ROLLUP_TIERS; i++) {
+        start = time - time % g_rollup_tiers[i].period;
+
+        /*
+         * a sample of a later period closes the buckets of every series, not only its own, so a series
+         * that went quiet cannot write an old bucket behind newer ones
+         */
+        for (uint16_t s = 1; s < ROLLUP_MAX_SERIES; s++) {
+            if (g_rollup.acc[i][s].count && (g_rollup.acc[i][s].start < start) &&
+                (WM_ERR_SUCCESS != rollup_write(i, s, &g_rollup.acc[i][s])))
+                ret = WM_ERR_FAILED;
+        }
+
+        acc = &g_rollup.acc[i][series];
+        if (!acc->count) {
+            acc->start = start;
+            acc->min   = value;
+            acc->max   = value;
+            acc->sum   = 0;
+        } else if (value < acc->min) {
+            acc->min = value;
+        } else if (value > acc->max) {
+            acc->max = value;
+        }
+        acc->sum += value;
+        acc->count++;
+    }
+
+    xSemaphoreGive(g_rollup.lock);
+
+    return ret;
+}
+
+int rollup_flush(void)
+{
+    int ret = WM_ERR_SUCCESS;
+
+    if (!g_rollup.lock)
+        return WM_ERR_SUCCESS;
+
+    /* a store being opened is not looked at half set up */
+    xSemaphoreTake(g_rollup.lock, portMAX_DELAY);
+    for (int i = 0; i < ROLLUP_TIERS; i++) {
+        if (g_rollup.db[i].dev && (WM_ERR_SUCCESS != tsdb_flush(&g_rollup.db[i])))
+            ret = WM_ERR_FAILED;
+    }
+    xSemaphoreGive(g_rollup.lock);
+
+    return ret;
+}
+
+int rollup_format(void)
+{
+    int ret;
+
+    ret = rollup_lock_init();
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    xSemaphoreTake(g_rollup.lock, portMAX_DELAY);
+
+    /* in place, queries and flushes use the stores without the rollup lock */
+    for (int i = 0; (WM_ERR_SUCCESS == ret) && (i < ROLLUP_TIERS); i++) {
+        if (g_rollup.db[i].dev)
+            ret = tsdb_clear(&g_rollup.db[i]);
+        else
+            ret = tsdb_format(&g_rollup.db[i], g_rollup_tiers[i].start_block, g_rollup_tiers[i].blocks);
+    }
+
+    memset(g_rollup.acc, 0, sizeof(g_rollup.acc));
+    g_rollup.last_time = 0;
+
+    xSemaphoreGive(g_rollup.lock);
+
+    return ret;
+}
+
+static void rollup_emit(rollup_query_t *q)
+{
+    q->out.avg = (int16_t)(q->sum / (int64_t)q->out.count);
+    q->stat->buckets++;
+
+    if (!q->visit(&q->out, q->arg))
+        q->done = true;
+
+    q->out.count = 0;
+}
+
+/* fold a bucket of the tier, or a raw sample, into the bucket of the query's resolution */
+static void rollup_merge(rollup_query_t *q, const rollup_bucket_t *b)
+{
+    uint32_t start = b->time - b->time % q->resolution;
+
+    if (q->out.count && (start != q->out.time))
+        rollup_emit(q);
+
+    if (q->done || !b->count)
+        return;
+
+    if (!q->out.count) {
+        q->out      = *b;
+        q->out.time = start;
+        q->sum      = (int64_t)b->avg * b->count;
+        return;
+    }
+
+    if (b->min < q->out.min)
+        q->out.min = b->min;
+    if (b->max > q->out.max)
+        q->out.max = b->max;
+    q->sum       += (int64_t)b->avg * b->count;
+    q->out.count += b->count;
+}
+
+static bool rollup_visit_record(const tsdb_record_t *record, void *arg)
+{
+    rollup_query_t *q = arg;
+    uint16_t stat     = record->series >> 12;
+
+    if (((record->series & ROLLUP_SERIES_MASK) != q->series) || (stat >= ROLLUP_STATS))
+        return true;
+
+    /* the records of a bucket go out together, a lone one left by a failed write is dropped */
+    if (record->time != q->part.time) {
+        q->part.time  = record->time;
+        q->part.count = 0;
+        q->have       = 0;
+    }
+
+    switch (stat) {
+        case ROLLUP_STAT_MIN:
+            q->part.min = record->value;
+            break;
+        case ROLLUP_STAT_MAX:
+            q->part.max = record->value;
+            break;
+        case ROLLUP_STAT_AVG:
+            q->part.avg = record->value;
+            break;
+        case ROLLUP_STAT_COUNT_HI:
+            q->part.count |= (uint32_t)(uint16_t)record->value << 16;
+            break;
+        default:
+            q->part.count |= (uint16_t)record->value;
+            break;
+    }
+
+    /* the low half of the count is written last and completes the bucket */
+    q->have |= 1 << stat;
+    if ((ROLLUP_STAT_COUNT == stat) && (ROLLUP_STATS_NEEDED == (q->have & ROLLUP_STATS_NEEDED))) {
+        rollup_merge(q, &q->part);
+        q->have = 0;
+    }
+
+    return !q->done;
+}
+
+static bool rollup_visit_raw(const tsdb_record_t *record, void *arg)
+{
+    rollup_query_t *q = arg;
+    rollup_bucket_t b = { record->time, record->value, record->value, record->value, 1 };
+
+    rollup_merge(q, &b);
+
+    return !q->done;
+}
+
+int rollup_query(uint16_t series, uint32_t t0, uint32_t t1, uint32_t resolution, rollup_visit_t visit, void *arg,
+                 rollup_query_stat_t *stat)
+{
+    rollup_query_t q = { 0 };
+    rollup_query_stat_t local;
+    tsdb_query_stat_t qs = { 0 };
+    rollup_acc_t acc;
+    tsdb_t *db;
+    int tier = -1;
+    int ret;
+
+    if (!stat)
+        stat = &local;
+    memset(stat, 0, sizeof(*stat));
+
+    if (!series || (series >= ROLLUP_MAX_SERIES) || !resolution || !visit)
+        return WM_ERR_INVALID_PARAM;
+
+    /* the coarsest tier whose buckets merge exactly into those asked for */
+    for (int i = ROLLUP_TIERS - 1; i >= 0; i--) {
+        if (!(resolution % g_rollup_tiers[i].period)) {
+            tier = i;
+            break;
+        }
+    }
+
+    q.series     = series;
+    q.resolution = resolution;
+    q.visit      = visit;
+    q.arg        = arg;
+    q.stat       = stat;
+
+    /* from the start of the bucket holding t0, so the first one is whole */
+    t0 -= t0 % resolution;
+
+    stat->tier = tier;
+    if (tier < 0) {
+        db = tsdb_default();
+        if (!db)
+            return WM_ERR_FAILED;
+        ret = tsdb_query(db, t0, t1, series, rollup_visit_raw, &q, &qs);
+    } else {
+        ret = rollup_open();
+        if (WM_ERR_SUCCESS != ret)
+            return ret;
+
+        stat->period = g_rollup_tiers[tier].period;
+        ret          = tsdb_query(&g_rollup.db[tier], t0, t1, TSDB_SERIES_ANY, rollup_visit_record, &q, &qs);
+
+        /* the bucket still filling is the newest */
+        xSemaphoreTake(g_rollup.lock, portMAX_DELAY);
+        acc = g_rollup.acc[tier][series];
+        xSemaphoreGive(g_rollup.lock);
+
+        if ((WM_ERR_SUCCESS == ret) && !q.done && acc.count && (acc.start >= t0) && (acc.start <= t1)) {
+            q.part.time  = acc.start;
+            q.part.min   = acc.min;
+            q.part.max   = acc.max;
+            q.part.avg   = (int16_t)(acc.sum / (int64_t)acc.count);
+            q.part.count = acc.count;
+            rollup_merge(&q, &q.part);
+        }
+    }
+
+    if (!q.done && q.out.count)
+        rollup_emit(&q);
+
+    stat->blocks_read = qs.blocks_read;
+
+    return ret;
+}
+
+static bool rollup_print_bucket(const rollup_bucket_t *bucket, void *arg)
+{
+    uint32_t *left = arg;
+
+    wm_cli_printf("%10u  %6d  %6d  %6d  %u\r\n", bucket->time, bucket->min, bucket->max, bucket->avg, bucket->count);
+
+    return --*left > 0;
+}
+
+static void cmd_rollup(int argc, char *argv[])
+{
+    rollup_query_stat_t qs;
+    uint32_t left;
+    uint32_t start;
+    uint32_t open;
+    int ret;
+
+    if ((argc > 1) && !strcmp("format", argv[1])) {
+        wm_cli_printf("format ret=%d\r\n", rollup_format());
+        return;
+    }
+
+    if ((argc > 5) && !strcmp("query", argv[1])) {
+        left  = ROLLUP_PRINT_MAX;
+        start = NOW_MS();
+        wm_cli_printf("      time     min     max     avg  count\r\n");
+        ret = rollup_query(strtoul(argv[2], NULL, 0), strtoul(argv[3], NULL, 0), strtoul(argv[4], NULL, 0),
+                           strtoul(argv[5], NULL, 0), rollup_print_bucket, &left, &qs);
+        wm_cli_printf("%u buckets from %s, %u blocks read, %u ms, ret=%d\r\n", qs.buckets,
+                      (qs.tier < 0) ? "raw" : g_rollup_tiers[qs.tier].name, qs.blocks_read, NOW_MS() - start, ret);
+        return;
+    }
+
+    ret = rollup_open();
+    if (WM_ERR_SUCCESS != ret) {
+        wm_cli_printf("open ret=%d\r\n", ret);
+        return;
+    }
+
+    wm_cli_printf("%u samples, last time %u, %u errors\r\n", g_rollup.samples, g_rollup.last_time, g_rollup.errors);
+    for (int i = 0; i < ROLLUP_TIERS; i++) {
+        open = 0;
+        for (int s = 1; s < ROLLUP_MAX_SERIES; s++)
+            open += !!g_rollup.acc[i][s].count;
+
+        wm_cli_printf("%-5s %5u s  blocks %u + %u  seq %u  %u buckets written  %u open  last %u\r\n",
+                      g_rollup_tiers[i].name, g_rollup_tiers[i].period, g_rollup.db[i].start_block,
+                      g_rollup_tiers[i].blocks, g_rollup.db[i].seq, g_rollup.buckets[i], open,
+                      g_rollup.db[i].last_time);
+    }
+}
+WM_CLI_CMD_DEFINE(rollup, cmd_rollup, rollup cmd, rollup [query <series> <t0> <t1> <resolution_s> | format] -- min max and average of the sensor history);
@@ -0,0 +1,77 @@
+#ifndef __ROLLUP_H__
+#define __ROLLUP_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "tsdb.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Downsampled history next to the raw store. Every tier keeps, per series and per period,
+ * min / max / average / count, folded in as each raw sample arrives; a bucket is written to the
+ * tier's own tsdb range once a sample of a later period arrives. With its own range a tier is
+ * read without touching the raw blocks or the finer tiers.
+ *
+ * Every bucket is five tsdb records at the bucket's start time, the series tagged with the stat,
+ * the count split in two halves so that a day of one second samples fits.
+ * The bucket still filling lives in ram and is lost on a reboot.
+ */
+#define ROLLUP_TIERS                   3
+#define ROLLUP_MAX_SERIES              4
+
+/* the tier ranges follow the raw store */
+#define ROLLUP_START                   (TSDB_DEFAULT_START + TSDB_DEFAULT_BLOCKS)
+
+enum {
+    ROLLUP_STAT_MIN = 0,
+    ROLLUP_STAT_MAX,
+    ROLLUP_STAT_AVG,
+    ROLLUP_STAT_COUNT,                 /**< low 16 bits */
+    ROLLUP_STAT_COUNT_HI,              /**< high 16 bits */
+    ROLLUP_STATS
+};
+
+#define ROLLUP_SERIES(series, stat)    ((uint16_t)(((stat) << 12) | (series)))
+
+typedef struct {
+    uint32_t time;                     /**< start of the bucket */
+    int16_t min;
+    int16_t max;
+    int16_t avg;
+    uint32_t count;                    /**< raw samples behind it */
+} rollup_bucket_t;
+
+typedef struct {
+    int tier;                          /**< the tier read, -1 for the raw samples */
+    uint32_t period;                   /**< its period in seconds, 0 for raw */
+    uint32_t blocks_read;
+    uint32_t buckets;                  /**< passed to the visitor */
+} rollup_query_stat_t;
+
+/* true to go on, false to stop the query */
+typedef bool (*rollup_visit_t)(const rollup_bucket_t *bucket, void *arg);
+
+/* fold a raw sample into every tier, samples must come in time order */
+int rollup_add(uint16_t series, uint32_t time, int16_t value);
+
+/* write the partial tsdb blocks of every tier */
+int rollup_flush(void);
+
+/* empty tier stores and buckets, for when the raw store is formatted */
+int rollup_format(void);
+
+/*
+ * buckets of resolution seconds between t0 and t1, built from the coarsest tier whose period
+ * divides into it, or from the raw samples when none does
+ */
+int rollup_query(uint16_t series, uint32_t t0, uint32_t t1, uint32_t resolution, rollup_visit_t visit, void *arg,
+                 rollup_query_stat_t *stat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ROLLUP_H__ */
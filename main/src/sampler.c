@@ -0,0 +1,327 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wmsdk_config.h"
+#include "wm_cli.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "sampler.h"
+
+#define LOG_TAG "sampler"
+#include "wm_log.h"
+
+#define SAMPLER_TASK_STACK             1024
+#define SAMPLER_TASK_PRIO              2
+
+/* auto phases are searched over at most this many ticks of the period */
+#define SAMPLER_PHASE_CANDIDATES       256
+
+#define SAMPLER_NONE                   (-1)
+
+#define NOW_MS()                       (xTaskGetTickCount() * portTICK_PERIOD_MS)
+
+typedef struct {
+    char name[SAMPLER_NAME_LEN];
+    sampler_read_t read;
+    void *arg;
+    uint32_t period;                   /**< in wheel ticks */
+    uint32_t due;                      /**< wheel tick of the next read */
+    uint32_t rounds;                   /**< turns of the wheel left before due */
+    int8_t next;                       /**< next sensor in the same slot */
+
+    sampler_sample_t ring[SAMPLER_RING_SIZE];
+    uint32_t count;                    /**< samples ever stored, the newest is ring[(count - 1) % size] */
+
+    sampler_stat_t stat;
+} sampler_sensor_t;
+
+typedef struct {
+    TaskHandle_t task;
+    SemaphoreHandle_t lock;            /**< the wheel, rings and stats, not held across reads */
+    uint32_t base_ms;                  /**< tick time of wheel tick 0, set when the task starts */
+    uint32_t tick;                     /**< wheel tick being processed */
+    int8_t slot[SAMPLER_WHEEL_SLOTS];
+    sampler_sensor_t sensor[SAMPLER_MAX_SENSORS];
+    int count;
+} sampler_ctx_t;
+
+static sampler_ctx_t g_sampler = { 0 };
+
+/* put a sensor in the slot of its due tick, which must be after the current one, lock held */
+static void sampler_insert(int id)
+{
+    sampler_sensor_t *s = &g_sampler.sensor[id];
+    uint32_t slot       = s->due % SAMPLER_WHEEL_SLOTS;
+
+    s->rounds           = (s->due - g_sampler.tick - 1) / SAMPLER_WHEEL_SLOTS;
+    s->next             = g_sampler.slot[slot];
+    g_sampler.slot[slot] = id;
+}
+
+static uint32_t sampler_distance(uint32_t a, uint32_t b, uint32_t period)
+{
+    uint32_t d = (a - b) % period;
+
+    return (d < period - d) ? d : period - d;
+}
+
+/* the first due tick furthest from every other sensor's reads, lock held */
+static uint32_t sampler_auto_due(uint32_t period)
+{
+    uint32_t candidates = (period < SAMPLER_PHASE_CANDIDATES) ? period : SAMPLER_PHASE_CANDIDATES;
+    uint32_t best_due   = g_sampler.tick + 1;
+    uint32_t best       = 0;
+    uint32_t due;
+    uint32_t worst;
+    uint32_t d;
+
+    for (uint32_t c = 0; c < candidates; c++) {
+        due   = g_sampler.tick + 1 + c;
+        worst = UINT32_MAX;
+
+        /* against either period, whichever brings the two closer */
+        for (int i = 0; i < g_sampler.count; i++) {
+            d = sampler_distance(due, g_sampler.sensor[i].due, g_sampler.sensor[i].period);
+            if (d < worst)
+                worst = d;
+            d = sampler_distance(g_sampler.sensor[i].due, due, period);
+            if (d < worst)
+                worst = d;
+        }
+
+        if (worst > best) {
+            best     = worst;
+            best_due = due;
+        }
+    }
+
+    return best_due;
+}
+
+static void sampler_run(int id)
+{
+    sampler_sensor_t *s = &g_sampler.sensor[id];
+    sampler_sample_t sample;
+    uint32_t due_ms = g_sampler.base_ms + s->due * SAMPLER_TICK_MS;
+    uint32_t now_tick;
+    uint32_t jitter;
+    uint32_t cost;
+    int ret;
+
+    sample.time_ms = NOW_MS();
+    jitter         = sample.time_ms - due_ms;
+
+    memset(sample.value, 0, sizeof(sample.value));
+    ret  = s->read(&sample, s->arg);
+    cost = NOW_MS() - sample.time_ms;
+
+    xSemaphoreTake(g_sampler.lock, portMAX_DELAY);
+
+    if (WM_ERR_SUCCESS == ret) {
+        s->ring[s->count % SAMPLER_RING_SIZE] = sample;
+        s->count++;
+        s->stat.samples++;
+    } else if (WM_ERR_BUSY == ret) {
+        s->stat.skipped++;
+    } else {
+        s->stat.errors++;
+    }
+
+    s->stat.jitter_ms_sum += jitter;
+    if (jitter > s->stat.jitter_ms_max)
+        s->stat.jitter_ms_max = jitter;
+    s->stat.cost_ms_sum += cost;
+    if (cost > s->stat.cost_ms_max)
+        s->stat.cost_ms_max = cost;
+
+    /* a period that has already passed in real time is dropped rather than read late */
+    now_tick = (NOW_MS() - g_sampler.base_ms) / SAMPLER_TICK_MS;
+    s->due  += s->period;
+    while ((int32_t)(s->due - now_tick) < 0) {
+        s->due += s->period;
+        s->stat.missed++;
+    }
+    sampler_insert(id);
+
+    xSemaphoreGive(g_sampler.lock);
+}
+
+static void sampler_task(void *param)
+{
+    TickType_t wake = xTaskGetTickCount();
+    int8_t fire[SAMPLER_MAX_SENSORS];
+    int8_t *link;
+    int nfire;
+    int id;
+
+    g_sampler.base_ms = wake * portTICK_PERIOD_MS;
+
+    while (1) {
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(SAMPLER_TICK_MS));
+
+        /* take the due sensors out of the slot, the rest wait another round */
+        xSemaphoreTake(g_sampler.lock, portMAX_DELAY);
+        g_sampler.tick++;
+        nfire = 0;
+        link  = &g_sampler.slot[g_sampler.tick % SAMPLER_WHEEL_SLOTS];
+        while (SAMPLER_NONE != *link) {
+            id = *link;
+            if (g_sampler.sensor[id].rounds) {
+                g_sampler.sensor[id].rounds--;
+                link = &g_sampler.sensor[id].next;
+            } else {
+                *link         = g_sampler.sensor[id].next;
+                fire[nfire++] = id;
+            }
+        }
+        xSemaphoreGive(g_sampler.lock);
+
+        for (int i = 0; i < nfire; i++)
+            sampler_run(fire[i]);
+    }
+}
+
+int sampler_register(const char *name, uint32_t period_ms, uint32_t phase_ms, sampler_read_t read, void *arg)
+{
+    SemaphoreHandle_t lock;
+    sampler_sensor_t *s;
+    int id;
+
+    if (!name || !read || (period_ms < SAMPLER_TICK_MS))
+        return WM_ERR_INVALID_PARAM;
+
+    if (!g_sampler.lock) {
+        lock = xSemaphoreCreateMutex();
+        if (!lock)
+            return WM_ERR_NO_MEM;
+
+        taskENTER_CRITICAL();
+        if (!g_sampler.lock) {
+            memset(g_sampler.slot, SAMPLER_NONE, sizeof(g_sampler.slot));
+            g_sampler.lock = lock;
+            lock           = NULL;
+        }
+        taskEXIT_CRITICAL();
+
+        if (lock)
+            vSemaphoreDelete(lock);
+    }
+
+    xSemaphoreTake(g_sampler.lock, portMAX_DELAY);
+
+    if ((sampler_find(name) >= 0) || (g_sampler.count >= SAMPLER_MAX_SENSORS)) {
+        xSemaphoreGive(g_sampler.lock);
+        return WM_ERR_FAILED;
+    }
+
+    id = g_sampler.count;
+    s  = &g_sampler.sensor[id];
+    memset(s, 0, sizeof(*s));
+    strncpy(s->name, name, SAMPLER_NAME_LEN - 1);
+    s->read   = read;
+    s->arg    = arg;
+    s->period = period_ms / SAMPLER_TICK_MS;
+
+    if (SAMPLER_PHASE_AUTO == phase_ms)
+        s->due = sampler_auto_due(s->period);
+    else
+        s->due = g_sampler.tick + 1 + phase_ms / SAMPLER_TICK_MS;
+
+    if (!g_sampler.task && (pdPASS != xTaskCreate(sampler_task, "sampler", SAMPLER_TASK_STACK, NULL,
+                                                  SAMPLER_TASK_PRIO, &g_sampler.task))) {
+        g_sampler.task = NULL;
+        xSemaphoreGive(g_sampler.lock);
+        return WM_ERR_NO_MEM;
+    }
+
+    sampler_insert(id);
+    g_sampler.count++;
+
+    xSemaphoreGive(g_sampler.lock);
+
+    wm_log_debug("%s every %u ms from tick %u", name, period_ms, s->due);
+
+    return id;
+}
+
+int sampler_find(const char *name)
+{
+    for (int i = 0; i < g_sampler.count; i++) {
+        if (!strncmp(g_sampler.sensor[i].name, name, SAMPLER_NAME_LEN - 1))
+            return i;
+    }
+
+    return WM_ERR_INVALID_PARAM;
+}
+
+int sampler_latest(int id, sampler_sample_t *sample)
+{
+    return (1 == sampler_history(id, sample, 1)) ? WM_ERR_SUCCESS : WM_ERR_FAILED;
+}
+
+uint32_t sampler_history(int id, sampler_sample_t *buf, uint32_t count)
+{
+    sampler_sensor_t *s;
+    uint32_t first;
+
+    if ((id < 0) || (id >= g_sampler.count))
+        return 0;
+
+    s = &g_sampler.sensor[id];
+
+    xSemaphoreTake(g_sampler.lock, portMAX_DELAY);
+    if (count > s->count)
+        count = s->count;
+    if (count > SAMPLER_RING_SIZE)
+        count = SAMPLER_RING_SIZE;
+
+    first = s->count - count;
+    for (uint32_t i = 0; i < count; i++)
+        buf[i] = s->ring[(first + i) % SAMPLER_RING_SIZE];
+    xSemaphoreGive(g_sampler.lock);
+
+    return count;
+}
+
+int sampler_get_stat(int id, sampler_stat_t *stat)
+{
+    if ((id < 0) || (id >= g_sampler.count))
+        return WM_ERR_INVALID_PARAM;
+
+    xSemaphoreTake(g_sampler.lock, portMAX_DELAY);
+    *stat = g_sampler.sensor[id].stat;
+    xSemaphoreGive(g_sampler.lock);
+
+    return WM_ERR_SUCCESS;
+}
+
+static void cmd_sampler(int argc, char *argv[])
+{
+    sampler_sample_t samples[SAMPLER_RING_SIZE];
+    sampler_stat_t stat;
+    uint32_t runs;
+    uint32_t n;
+    int id;
+
+    if ((argc > 2) && !strcmp("history", argv[1])) {
+        id = sampler_find(argv[2]);
+        n  = sampler_history(id, samples, (argc > 3) ? strtoul(argv[3], NULL, 0) : 8);
+        for (uint32_t i = 0; i < n; i++)
+            wm_cli_printf("%10u ms  %8.2f  %8.2f\r\n", samples[i].time_ms, samples[i].value[0], samples[i].value[1]);
+        return;
+    }
+
+    wm_cli_printf("tick %u ms, wheel %u slots\r\n", SAMPLER_TICK_MS, SAMPLER_WHEEL_SLOTS);
+    wm_cli_printf("%-8s %7s %8s %7s %7s %6s %10s %10s %9s %9s\r\n", "sensor", "period", "samples", "errors", "skipped",
+                  "missed", "jitter avg", "jitter max", "cost avg", "cost max");
+    for (id = 0; id < g_sampler.count; id++) {
+        sampler_get_stat(id, &stat);
+        runs = stat.samples + stat.errors + stat.skipped;
+        wm_cli_printf("%-8s %7u %8u %7u %7u %6u %10.2f %10u %9.2f %9u\r\n", g_sampler.sensor[id].name,
+                      g_sampler.sensor[id].period * SAMPLER_TICK_MS, stat.samples, stat.errors, stat.skipped,
+                      stat.missed, runs ? (float)stat.jitter_ms_sum / runs : 0.0f, stat.jitter_ms_max,
+                      runs ? (float)stat.cost_ms_sum / runs : 0.0f, stat.cost_ms_max);
+    }
+}
+WM_CLI_CMD_DEFINE(sampler, cmd_sampler, sampler cmd, sampler [history <sensor> [count]] -- sensor scheduler metrics or recent samples);
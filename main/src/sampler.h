@@ -0,0 +1,67 @@
+#ifndef __SAMPLER_H__
+#define __SAMPLER_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * One task samples every registered sensor. A timer wheel of SAMPLER_WHEEL_SLOTS slots,
+ * advanced every SAMPLER_TICK_MS, holds each sensor at its next due tick; a sensor due further
+ * out than one turn waits a number of rounds in its slot. Sensors without a fixed phase are
+ * started where they are furthest from the others, so i2c and adc reads do not pile up on one tick.
+ * Every sample lands in the sensor's ring with the time it was taken.
+ */
+#define SAMPLER_TICK_MS                10
+#define SAMPLER_WHEEL_SLOTS            64
+#define SAMPLER_MAX_SENSORS            8
+#define SAMPLER_RING_SIZE              32
+#define SAMPLER_MAX_VALUES             2
+#define SAMPLER_NAME_LEN               8
+
+/* let the scheduler pick the phase */
+#define SAMPLER_PHASE_AUTO             0xFFFFFFFF
+
+typedef struct {
+    uint32_t time_ms;                  /**< tick time the read started, in ms */
+    float value[SAMPLER_MAX_VALUES];
+} sampler_sample_t;
+
+/*
+ * fill sample->value, anything but WM_ERR_SUCCESS stores nothing, runs in the sampler task;
+ * WM_ERR_BUSY is a sensor with no sample yet and is not counted as an error
+ */
+typedef int (*sampler_read_t)(sampler_sample_t *sample, void *arg);
+
+typedef struct {
+    uint32_t samples;
+    uint32_t errors;                   /**< reads that failed */
+    uint32_t skipped;                  /**< reads with no sample yet */
+    uint32_t missed;                   /**< periods skipped because the task fell behind */
+    uint32_t jitter_ms_max;            /**< start of the read after its due time */
+    uint32_t jitter_ms_sum;
+    uint32_t cost_ms_max;              /**< time spent in the read */
+    uint32_t cost_ms_sum;
+} sampler_stat_t;
+
+/* returns the sensor id, or a negative WM_ERR_* code, phase_ms is from now */
+int sampler_register(const char *name, uint32_t period_ms, uint32_t phase_ms, sampler_read_t read, void *arg);
+
+/* the id of a registered sensor, or WM_ERR_INVALID_PARAM */
+int sampler_find(const char *name);
+
+/* the newest sample, WM_ERR_FAILED before the first one */
+int sampler_latest(int id, sampler_sample_t *sample);
+
+/* the newest count samples, oldest first, returns how many were copied */
+uint32_t sampler_history(int id, sampler_sample_t *buf, uint32_t count);
+
+int sampler_get_stat(int id, sampler_stat_t *stat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SAMPLER_H__ */
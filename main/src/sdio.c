@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include "wmsdk_config.h"
+#include "wm_drv_sdh_sdmmc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "sdio.h"
+
+#define LOG_TAG "sdio"
+#include "wm_log.h"
+
+static SemaphoreHandle_t g_sdio_lock = NULL;
+
+/* the first card or lcd access may come from any task, only one mutex is kept */
+static SemaphoreHandle_t sdio_get_lock(void)
+{
+    SemaphoreHandle_t lock;
+
+    if (g_sdio_lock)
+        return g_sdio_lock;
+
+    lock = xSemaphoreCreateMutex();
+    if (!lock) {
+        wm_log_error("mem err");
+        return NULL;
+    }
+
+    taskENTER_CRITICAL();
+    if (!g_sdio_lock) {
+        g_sdio_lock = lock;
+        lock        = NULL;
+    }
+    taskEXIT_CRITICAL();
+
+    if (lock)
+        vSemaphoreDelete(lock);
+
+    return g_sdio_lock;
+}
+
+void sdio_lock(void)
+{
+    SemaphoreHandle_t lock = sdio_get_lock();
+
+    if (lock)
+        xSemaphoreTake(lock, portMAX_DELAY);
+}
+
+void sdio_unlock(void)
+{
+    if (g_sdio_lock)
+        xSemaphoreGive(g_sdio_lock);
+}
+
+int sdio_read_blocks(wm_device_t *dev, void *buf, uint32_t start_block, uint32_t count)
+{
+    int ret;
+
+    sdio_lock();
+    ret = wm_drv_sdh_sdmmc_read_blocks(dev, buf, start_block, count);
+    sdio_unlock();
+
+    return ret;
+}
+
+int sdio_write_blocks(wm_device_t *dev, const void *buf, uint32_t start_block, uint32_t count)
+{
+    int ret;
+
+    sdio_lock();
+    ret = wm_drv_sdh_sdmmc_write_blocks(dev, (uint8_t *)buf, start_block, count);
+    sdio_unlock();
+
+    return ret;
+}
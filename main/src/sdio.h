@@ -0,0 +1,28 @@
+#ifndef __SDIO_H__
+#define __SDIO_H__
+
+#include <stdint.h>
+#include "wm_dt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The sdmmc card and the sdspi lcd are driven by the one sdio host controller (0x40000A00, irq 24),
+ * and neither driver knows of the other. Every card read or write and every lcd transfer holds this
+ * lock, so a task reading the card and another one sending to the lcd only overlap between
+ * transfers, a band being read while the previous one is sent is interleaved by the lock.
+ */
+void sdio_lock(void);
+void sdio_unlock(void);
+
+/* wm_drv_sdh_sdmmc_read_blocks / wm_drv_sdh_sdmmc_write_blocks under the lock */
+int sdio_read_blocks(wm_device_t *dev, void *buf, uint32_t start_block, uint32_t count);
+int sdio_write_blocks(wm_device_t *dev, const void *buf, uint32_t start_block, uint32_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SDIO_H__ */
@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <string.h>
+#include "wmsdk_config.h"
+#include "wm_cli.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "crc.h"
+#include "i2c_bus.h"
+#include "sampler.h"
+#include "sht30.h"
+
+#define LOG_TAG "sht30"
+#include "wm_log.h"
+
+#define SHT30_ADDRESS                   0x44
+#define SHT30_SPEED_HZ                  400000
+
+#define SHT30_CMD_SOFT_RESET            0x30A2
+#define SHT30_CMD_BREAK                 0x3093
+#define SHT30_CMD_PERIODIC_10MPS_HIGH   0x2737
+#define SHT30_CMD_FETCH                 0xE000
+
+/* consecutive failed fetches before periodic mode is set up again */
+#define SHT30_MAX_FAILS                 3
+
+#define NOW_MS()                        (xTaskGetTickCount() * portTICK_PERIOD_MS)
+
+/* periodic mode is set up in steps one fetch period apart, so the sampler never waits on the sensor */
+enum {
+    SHT30_STATE_RESET = 0,
+    SHT30_STATE_START,
+    SHT30_STATE_RUN,
+};
+
+typedef struct {
+    int id;                            /**< sampler sensor, the latest reading is its newest sample */
+    bool started;
+
+    int state;
+    uint32_t fails;
+
+    sht30_stat_t stat;
+} sht30_ctx_t;
+
+static sht30_ctx_t g_sht30 = { 0 };
+
+static int sht30_cmd(uint16_t cmd)
+{
+    uint8_t buf[2];
+
+    buf[0] = (uint8_t)(cmd >> 8);
+    buf[1] = (uint8_t)(cmd & 0xFF);
+
+    return i2c_bus_write(SHT30_ADDRESS, SHT30_SPEED_HZ, &buf[0], 1, &buf[1], 1);
+}
+
+/* stop any running acquisition and reset, periodic mode is started on the next call */
+static int sht30_reset(void)
+{
+    /* a sensor in periodic mode only listens to break and fetch, the result of the break does not matter */
+    sht30_cmd(SHT30_CMD_BREAK);
+    vTaskDelay(pdMS_TO_TICKS(2));
+
+    return sht30_cmd(SHT30_CMD_SOFT_RESET);
+}
+
+static int sht30_fetch(sampler_sample_t *sample)
+{
+    uint8_t buf[6];
+    uint32_t start = NOW_MS();
+    uint32_t elapsed;
+    uint16_t data;
+    int ret;
+
+    ret = sht30_cmd(SHT30_CMD_FETCH);
+    if (WM_ERR_SUCCESS == ret)
+        ret = i2c_bus_read(SHT30_ADDRESS, SHT30_SPEED_HZ, NULL, 0, buf, 6);
+
+    elapsed = NOW_MS() - start;
+    if (elapsed > g_sht30.stat.fetch_ms_max)
+        g_sht30.stat.fetch_ms_max = elapsed;
+
+    if (WM_ERR_SUCCESS != ret) {
+        g_sht30.stat.fetch_errors++;
+        return ret;
+    }
+
+    if ((crc8(CRC8_INIT, &buf[0], 2) != buf[2]) || (crc8(CRC8_INIT, &buf[3], 2) != buf[5])) {
+        g_sht30.stat.crc_errors++;
+        return WM_ERR_FAILED;
+    }
+
+    data             = ((uint16_t)buf[0] << 8) | buf[1];
+    sample->value[0] = -45 + (175 * (float)data / 65535);
+
+    data             = ((uint16_t)buf[3] << 8) | buf[4];
+    sample->value[1] = (100 * (float)data / 65535);
+
+    g_sht30.stat.fetches++;
+
+    return WM_ERR_SUCCESS;
+}
+
+/* one step per fetch period, runs in the sampler task */
+static int sht30_sample(sampler_sample_t *sample, void *arg)
+{
+    int ret;
+
+    switch (g_sht30.state) {
+        case SHT30_STATE_RESET:
+            ret = sht30_reset();
+            if (WM_ERR_SUCCESS == ret)
+                g_sht30.state = SHT30_STATE_START;
+            break;
+        case SHT30_STATE_START:
+            /* the first result is ready one measurement later, well before the next period */
+            ret = sht30_cmd(SHT30_CMD_PERIODIC_10MPS_HIGH);
+            g_sht30.state = (WM_ERR_SUCCESS == ret) ? SHT30_STATE_RUN : SHT30_STATE_RESET;
+            break;
+        default:
+            ret = sht30_fetch(sample);
+            if (WM_ERR_SUCCESS == ret) {
+                g_sht30.fails = 0;
+                return WM_ERR_SUCCESS;
+            }
+            if (++g_sht30.fails >= SHT30_MAX_FAILS) {
+                /* the sensor may have been reset or lost its mode */
+                g_sht30.stat.restarts++;
+                g_sht30.state = SHT30_STATE_RESET;
+                g_sht30.fails = 0;
+            }
+            break;
+    }
+
+    if (WM_ERR_SUCCESS != ret) {
+        wm_log_debug("state %d ret=%d", g_sht30.state, ret);
+        return WM_ERR_FAILED;
+    }
+
+    /* set up fine, the first sample comes with a later period */
+    return WM_ERR_BUSY;
+}
+
+int sht30_start(void)
+{
+    int id;
+    int ret;
+
+    if (g_sht30.started)
+        return WM_ERR_SUCCESS;
+
+    ret = i2c_bus_start();
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    g_sht30.state = SHT30_STATE_RESET;
+
+    id = sampler_register("sht30", SHT30_FETCH_MS, SAMPLER_PHASE_AUTO, sht30_sample, NULL);
+    if (id < 0)
+        return id;
+
+    g_sht30.id      = id;
+    g_sht30.started = true;
+
+    return WM_ERR_SUCCESS;
+}
+
+int sht30_get(sht30_reading_t *reading)
+{
+    sampler_sample_t sample;
+
+    if (!g_sht30.started && (WM_ERR_SUCCESS != sht30_start()))
+        return WM_ERR_FAILED;
+
+    if (WM_ERR_SUCCESS != sampler_latest(g_sht30.id, &sample))
+        return WM_ERR_FAILED;
+
+    reading->temp    = sample.value[0];
+    reading->humi    = sample.value[1];
+    reading->time_ms = sample.time_ms;
+
+    return WM_ERR_SUCCESS;
+}
+
+int sht30_read(float *temp, float *humi)
+{
+    sht30_reading_t reading;
+
+    if (WM_ERR_SUCCESS != sht30_get(&reading))
+        return WM_ERR_FAILED;
+
+    if (NOW_MS() - reading.time_ms > SHT30_STALE_MS)
+        return WM_ERR_FAILED;
+
+    *temp = reading.temp;
+    *humi = reading.humi;
+
+    return WM_ERR_SUCCESS;
+}
+
+void sht30_get_stat(sht30_stat_t *stat)
+{
+    *stat = g_sht30.stat;
+}
+
+static void cmd_sht30(int argc, char *argv[])
+{
+    sht30_reading_t reading;
+    sht30_stat_t stat;
+
+    if ((argc > 1) && !strcmp("stat", argv[1])) {
+        sht30_get_stat(&stat);
+        wm_cli_printf("%u fetches, %u fetch errors, %u crc errors, %u restarts, slowest fetch %u ms\r\n",
+                      stat.fetches, stat.fetch_errors, stat.crc_errors, stat.restarts, stat.fetch_ms_max);
+        return;
+    }
+
+    if (WM_ERR_SUCCESS == sht30_get(&reading)) {
+        wm_cli_printf("sht30 temp = %.1f, humi = %.1f%%, %u ms ago\r\n", reading.temp, reading.humi,
+                      NOW_MS() - reading.time_ms);
+    } else {
+        wm_cli_printf("sht30 no reading yet\r\n");
+    }
+}
+WM_CLI_CMD_DEFINE(sht30, cmd_sht30, sht30 cmd, sht30 [stat] -- show the latest temperature and humidity);
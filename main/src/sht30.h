@@ -0,0 +1,44 @@
+#ifndef __SHT30_H__
+#define __SHT30_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the sensor runs in periodic mode, the sampler fetches one result per period into its ring */
+#define SHT30_FETCH_MS                 1000
+/* a cached reading older than this is no longer returned by sht30_read */
+#define SHT30_STALE_MS                 (SHT30_FETCH_MS * 5)
+
+typedef struct {
+    float temp;
+    float humi;
+    uint32_t time_ms;                  /**< tick time of the fetch, in ms */
+} sht30_reading_t;
+
+typedef struct {
+    uint32_t fetches;                  /**< results that passed the crc */
+    uint32_t fetch_errors;             /**< i2c errors of the fetch */
+    uint32_t crc_errors;
+    uint32_t restarts;                 /**< periodic mode set up again after repeated failures */
+    uint32_t fetch_ms_max;             /**< slowest fetch, i2c only */
+} sht30_stat_t;
+
+/* start the sampler, the first call of sht30_get or sht30_read does it too */
+int sht30_start(void);
+
+/* the latest reading, whatever its age, WM_ERR_FAILED before the first one */
+int sht30_get(sht30_reading_t *reading);
+
+/* the latest temperature and humidity, WM_ERR_FAILED when there is none or it is stale */
+int sht30_read(float *temp, float *humi);
+
+void sht30_get_stat(sht30_stat_t *stat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SHT30_H__ */
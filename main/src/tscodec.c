@@ -0,0 +1,547 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "wmsdk_config.h"
+#include "wm_cli.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "tsdb.h"
+#include "tscodec.h"
+
+#define LOG_TAG "tscodec"
+#include "wm_log.h"
+
+#define TSCODEC_NO_WINDOW              0xFF
+
+#define TSCODEC_BENCH_SAMPLES          2048
+#define TSCODEC_BENCH_LOOPS            20
+
+#define NOW_MS()                       (xTaskGetTickCount() * portTICK_PERIOD_MS)
+
+/* prefix lengths and payload bits of the buckets, the last one always fits */
+static const uint8_t tscodec_time_bits[]  = { 0, 7, 9, 12, 32 };
+static const uint8_t tscodec_fixed_bits[] = { 0, 4, 8, 16, 32 };
+
+#define TSCODEC_BUCKETS                (sizeof(tscodec_time_bits) / sizeof(tscodec_time_bits[0]))
+
+/* msb first, false without writing anything when the buffer is too small */
+static bool tscodec_write(tscodec_bits_t *b, uint32_t value, uint32_t n)
+{
+    uint32_t room;
+    uint32_t take;
+
+    if (b->bits + n > b->size * 8)
+        return false;
+
+    while (n) {
+        room = 8 - (b->bits & 7);
+        take = (n < room) ? n : room;
+        if (room == 8)
+            b->buf[b->bits >> 3] = 0;
+        b->buf[b->bits >> 3] |= ((value >> (n - take)) & ((1u << take) - 1)) << (room - take);
+        b->bits += take;
+        n       -= take;
+    }
+
+    return true;
+}
+
+static bool tscodec_read(tscodec_bits_t *b, uint32_t n, uint32_t *value)
+{
+    uint32_t v = 0;
+    uint32_t room;
+    uint32_t take;
+
+    if (b->bits + n > b->size * 8)
+        return false;
+
+    while (n) {
+        room = 8 - (b->bits & 7);
+        take = (n < room) ? n : room;
+        v    = (v << take) | ((b->buf[b->bits >> 3] >> (room - take)) & ((1u << take) - 1));
+        b->bits += take;
+        n       -= take;
+    }
+
+    *value = v;
+
+    return true;
+}
+
+static uint32_t tscodec_zigzag(uint32_t d)
+{
+    return (d << 1) ^ (uint32_t)((int32_t)d >> 31);
+}
+
+static uint32_t tscodec_unzigzag(uint32_t z)
+{
+    return (z >> 1) ^ (0 - (z & 1));
+}
+
+/* '0', '10', '110', '1110' or '1111' then the payload of the first bucket it fits */
+static bool tscodec_write_bucket(tscodec_bits_t *b, const uint8_t *bits, uint32_t z)
+{
+    uint32_t i;
+
+    for (i = 0; i < TSCODEC_BUCKETS - 1; i++) {
+        if (!bits[i] ? !z : (z < (1u << bits[i])))
+            break;
+    }
+
+    /* i ones and a zero, the last bucket has no zero */
+    if (i < TSCODEC_BUCKETS - 1) {
+        if (!tscodec_write(b, ((1u << i) - 1) << 1, i + 1))
+            return false;
+    } else if (!tscodec_write(b, (1u << i) - 1, i)) {
+        return false;
+    }
+
+    return !bits[i] || tscodec_write(b, z, bits[i]);
+}
+
+static bool tscodec_read_bucket(tscodec_bits_t *b, const uint8_t *bits, uint32_t *z)
+{
+    uint32_t bit;
+    uint32_t i;
+
+    for (i = 0; i < TSCODEC_BUCKETS - 1; i++) {
+        if (!tscodec_read(b, 1, &bit))
+            return false;
+        if (!bit)
+            break;
+    }
+
+    *z = 0;
+
+    return !bits[i] || tscodec_read(b, bits[i], z);
+}
+
+static bool tscodec_write_time(tscodec_enc_t *enc, uint32_t time)
+{
+    uint32_t delta = time - enc->time;
+
+    if (!enc->count)
+        return tscodec_write(&enc->out, time, 32);
+
+    if (!tscodec_write_bucket(&enc->out, tscodec_time_bits, tscodec_zigzag(delta - (uint32_t)enc->delta)))
+        return false;
+
+    enc->delta = (int32_t)delta;
+
+    return true;
+}
+
+static bool tscodec_read_time(tscodec_dec_t *dec, uint32_t *time)
+{
+    uint32_t z;
+
+    if (!dec->count)
+        return tscodec_read(&dec->out, 32, time);
+
+    if (!tscodec_read_bucket(&dec->out, tscodec_time_bits, &z))
+        return false;
+
+    dec->delta = (int32_t)((uint32_t)dec->delta + tscodec_unzigzag(z));
+    *time      = dec->time + (uint32_t)dec->delta;
+
+    return true;
+}
+
+static bool tscodec_write_xor(tscodec_enc_t *enc, uint32_t value)
+{
+    uint32_t x = value ^ enc->value;
+    uint32_t leading;
+    uint32_t trailing;
+    uint32_t len;
+
+    if (!x)
+        return tscodec_write(&enc->out, 0, 1);
+
+    leading  = __builtin_clz(x);
+    trailing = __builtin_ctz(x);
+
+    /* inside the previous window only the bits of the window are sent */
+    if ((TSCODEC_NO_WINDOW != enc->leading) && (leading >= enc->leading) && (trailing >= enc->trailing)) {
+        len = 32 - enc->leading - enc->trailing;
+        return tscodec_write(&enc->out, 2, 2) && tscodec_write(&enc->out, x >> enc->trailing, len);
+    }
+
+    len = 32 - leading - trailing;
+    if (!tscodec_write(&enc->out, (3u << 10) | (leading << 5) | (len - 1), 12) ||
+        !tscodec_write(&enc->out, x >> trailing, len))
+        return false;
+
+    enc->leading  = (uint8_t)leading;
+    enc->trailing = (uint8_t)trailing;
+
+    return true;
+}
+
+static bool tscodec_read_xor(tscodec_dec_t *dec, uint32_t *value)
+{
+    uint32_t head;
+    uint32_t x;
+    uint32_t len;
+
+    if (!tscodec_read(&dec->out, 1, &head))
+        return false;
+
+    if (!head) {
+        *value = dec->value;
+        return true;
+    }
+
+    if (!tscodec_read(&dec->out, 1, &head))
+        return false;
+
+    if (head) {
+        if (!tscodec_read(&dec->out, 10, &head))
+            return false;
+        len           = (head & 0x1F) + 1;
+        dec->leading  = (uint8_t)(head >> 5);
+        dec->trailing = (uint8_t)(32 - dec->leading - len);
+        if (dec->leading + len > 32)
+            return false;
+    } else if (TSCODEC_NO_WINDOW == dec->leading) {
+        return false;
+    }
+
+    len = 32 - dec->leading - dec->trailing;
+    if (!tscodec_read(&dec->out, len, &x))
+        return false;
+
+    *value = dec->value ^ (x << dec->trailing);
+
+    return true;
+}
+
+static bool tscodec_write_value(tscodec_enc_t *enc, uint32_t value)
+{
+    if (!enc->count)
+        return tscodec_write(&enc->out, value, 32);
+
+    if (TSCODEC_FLOAT == enc->mode)
+        return tscodec_write_xor(enc, value);
+
+    return tscodec_write_bucket(&enc->out, tscodec_fixed_bits, tscodec_zigzag(value - enc->value));
+}
+
+static bool tscodec_read_value(tscodec_dec_t *dec, uint32_t *value)
+{
+    uint32_t z;
+
+    if (!dec->count)
+        return tscodec_read(&dec->out, 32, value);
+
+    if (TSCODEC_FLOAT == dec->mode)
+        return tscodec_read_xor(dec, value);
+
+    if (!tscodec_read_bucket(&dec->out, tscodec_fixed_bits, &z))
+        return false;
+
+    *value = dec->value + tscodec_unzigzag(z);
+
+    return true;
+}
+
+void tscodec_enc_init(tscodec_enc_t *enc, uint8_t *buf, uint32_t size, tscodec_mode_t mode)
+{
+    memset(enc, 0, sizeof(*enc));
+    enc->out.buf  = buf;
+    enc->out.size = size;
+    enc->mode     = mode;
+    enc->leading  = TSCODEC_NO_WINDOW;
+}
+
+static int tscodec_put(tscodec_enc_t *enc, uint32_t time, uint32_t value)
+{
+    tscodec_enc_t saved = *enc;
+
+    if (!tscodec_write_time(enc, time) || !tscodec_write_value(enc, value)) {
+        /* back to the last whole sample, with the bits after it cleared again */
+        *enc = saved;
+        if (enc->out.bits & 7)
+            enc->out.buf[enc->out.bits >> 3] &= ~(0xFF >> (enc->out.bits & 7));
+        return WM_ERR_NO_MEM;
+    }
+
+    enc->time  = time;
+    enc->value = value;
+    enc->count++;
+
+    return WM_ERR_SUCCESS;
+}
+
+int tscodec_put_fixed(tscodec_enc_t *enc, uint32_t time, int32_t value)
+{
+    return tscodec_put(enc, time, (uint32_t)value);
+}
+
+int tscodec_put_float(tscodec_enc_t *enc, uint32_t time, float value)
+{
+    uint32_t bits;
+
+    memcpy(&bits, &value, 4);
+
+    return tscodec_put(enc, time, bits);
+}
+
+uint32_t tscodec_enc_bytes(const tscodec_enc_t *enc)
+{
+    return (enc->out.bits + 7) / 8;
+}
+
+void tscodec_dec_init(tscodec_dec_t *dec, const uint8_t *buf, uint32_t size, uint32_t count, tscodec_mode_t mode)
+{
+    tscodec_enc_init(dec, (uint8_t *)buf, size, mode);
+    dec->total = count;
+}
+
+static int tscodec_get(tscodec_dec_t *dec, uint32_t *time, uint32_t *value)
+{
+    if ((dec->count >= dec->total) || !tscodec_read_time(dec, time) || !tscodec_read_value(dec, value))
+        return WM_ERR_FAILED;
+
+    dec->time  = *time;
+    dec->value = *value;
+    dec->count++;
+
+    return WM_ERR_SUCCESS;
+}
+
+int tscodec_get_fixed(tscodec_dec_t *dec, uint32_t *time, int32_t *value)
+{
+    return tscodec_get(dec, time, (uint32_t *)value);
+}
+
+int tscodec_get_float(tscodec_dec_t *dec, uint32_t *time, float *value)
+{
+    uint32_t bits;
+    int ret;
+
+    ret = tscodec_get(dec, time, &bits);
+    if (WM_ERR_SUCCESS == ret)
+        memcpy(value, &bits, 4);
+
+    return ret;
+}
+
+/* encode, decode and compare, returns the bytes used or 0 when the round trip fails */
+static uint32_t tscodec_round_trip(tscodec_mode_t mode, const uint32_t *time, const int32_t *value, uint32_t n,
+                                   uint8_t *buf, uint32_t size)
+{
+    tscodec_enc_t enc;
+    tscodec_dec_t dec;
+    uint32_t t;
+    int32_t v;
+    float f;
+    uint32_t i;
+
+    tscodec_enc_init(&enc, buf, size, mode);
+    for (i = 0; i < n; i++) {
+        if (TSCODEC_FLOAT == mode) {
+            if (WM_ERR_SUCCESS != tscodec_put_float(&enc, time[i], value[i] / 100.0f))
+                break;
+        } else if (WM_ERR_SUCCESS != tscodec_put_fixed(&enc, time[i], value[i])) {
+            break;
+        }
+    }
+
+    /* a stream that ran out of room must still hold every sample before that */
+    n = i;
+    tscodec_dec_init(&dec, buf, tscodec_enc_bytes(&enc), n, mode);
+    for (i = 0; i < n; i++) {
+        if (TSCODEC_FLOAT == mode) {
+            if ((WM_ERR_SUCCESS != tscodec_get_float(&dec, &t, &f)) || (t != time[i]) || (f != value[i] / 100.0f))
+                break;
+        } else if ((WM_ERR_SUCCESS != tscodec_get_fixed(&dec, &t, &v)) || (t != time[i]) || (v != value[i])) {
+            break;
+        }
+    }
+
+    if ((i != n) || (WM_ERR_SUCCESS == tscodec_get_fixed(&dec, &t, &v)))
+        return 0;
+
+    return tscodec_enc_bytes(&enc) ? tscodec_enc_bytes(&enc) : 1;
+}
+
+typedef struct {
+    const char *name;
+    uint32_t size;                     /**< output buffer, small ones make the encoder run out */
+} tscodec_case_t;
+
+static const tscodec_case_t tscodec_cases[] = {
+    { "steady",   4096 },
+    { "jitter",   4096 },
+    { "jumps",    4096 },
+    { "extremes", 4096 },
+    { "full",     37   },
+    { "single",   8    },
+};
+
+#define TSCODEC_CASES                  (sizeof(tscodec_cases) / sizeof(tscodec_cases[0]))
+#define TSCODEC_CASE_SAMPLES           256
+
+static void tscodec_make_case(uint32_t k, uint32_t *time, int32_t *value, uint32_t n)
+{
+    uint32_t rnd = 12345 + k;
+
+    for (uint32_t i = 0; i < n; i++) {
+        rnd = rnd * 1103515245 + 12345;
+        switch (k) {
+            case 0:
+                time[i]  = 1000 + i * 10;
+                value[i] = 2350;
+                break;
+            case 1:
+                time[i]  = 1000 + i * 1000 + (rnd >> 16) % 7;
+                value[i] = 2350 + (int32_t)((rnd >> 8) % 21) - 10;
+                break;
+            case 2:
+                time[i]  = i ? time[i - 1] + ((i % 16) ? 1 : 100000) : 0xFFFFFF00;
+                value[i] = (i % 32) ? value[i - 1] + (int32_t)((rnd >> 8) % 2001) - 1000 : -4000;
+                break;
+            case 3:
+                time[i]  = (i & 1) ? 0xFFFFFFFF : 0;
+                value[i] = (i & 1) ? INT32_MAX : INT32_MIN;
+                break;
+            default:
+                time[i]  = i * 60;
+                value[i] = (int32_t)(rnd >> 20) - 2048;
+                break;
+        }
+    }
+}
+
+/* round trips of edge cases in both modes */
+static void tscodec_check(void)
+{
+    static uint32_t time[TSCODEC_CASE_SAMPLES];
+    static int32_t value[TSCODEC_CASE_SAMPLES];
+    static uint8_t buf[4096];
+    uint32_t n;
+    uint32_t bytes[2];
+    int fails = 0;
+
+    for (uint32_t k = 0; k < TSCODEC_CASES; k++) {
+        n = (tscodec_cases[k].size < 16) ? 1 : TSCODEC_CASE_SAMPLES;
+        tscodec_make_case(k, time, value, n);
+
+        bytes[0] = tscodec_round_trip(TSCODEC_FIXED, time, value, n, buf, tscodec_cases[k].size);
+        bytes[1] = tscodec_round_trip(TSCODEC_FLOAT, time, value, n, buf, tscodec_cases[k].size);
+        if (!bytes[0] || !bytes[1])
+            fails++;
+
+        wm_cli_printf("%-9s %3u samples  fixed %5u bytes  float %5u bytes  %s\r\n", tscodec_cases[k].name, n,
+                      bytes[0], bytes[1], (bytes[0] && bytes[1]) ? "ok" : "FAIL");
+    }
+
+    wm_cli_printf("%s\r\n", fails ? "FAIL" : "ok");
+}
+
+typedef struct {
+    uint32_t *time;
+    int32_t *value;
+    uint32_t n;
+    uint32_t max;
+} tscodec_trace_t;
+
+static bool tscodec_collect(const tsdb_record_t *record, void *arg)
+{
+    tscodec_trace_t *trace = arg;
+
+    trace->time[trace->n]  = record->time;
+    trace->value[trace->n] = record->value;
+
+    return ++trace->n < trace->max;
+}
+
+/* the recorded series from the sd card, or a made up one like it when there is too little */
+static const char *tscodec_load_trace(uint16_t series, tscodec_trace_t *trace)
+{
+    tsdb_t *db   = tsdb_default();
+    uint32_t rnd = 1;
+    int32_t v    = (TSDB_SERIES_SHT30_HUMI == series) ? 4500 : 2350;
+
+    trace->n = 0;
+    if (db)
+        tsdb_query(db, 0, UINT32_MAX, series, tscodec_collect, trace, NULL);
+
+    if (trace->n >= 64)
+        return "recorded";
+
+    for (trace->n = 0; trace->n < trace->max; trace->n++) {
+        rnd = rnd * 1103515245 + 12345;
+        v  += (int32_t)((rnd >> 16) % 5) - 2;
+        trace->time[trace->n]  = trace->n * 10;
+        trace->value[trace->n] = v;
+    }
+
+    return "synthetic";
+}
+
+static void tscodec_bench(uint16_t series)
+{
+    tscodec_trace_t trace;
+    tscodec_enc_t enc;
+    const char *source;
+    uint8_t *buf;
+    uint32_t size;
+    uint32_t bytes;
+    uint32_t ms;
+
+    trace.max   = TSCODEC_BENCH_SAMPLES;
+    trace.time  = malloc(trace.max * sizeof(uint32_t));
+    trace.value = malloc(trace.max * sizeof(int32_t));
+    size        = trace.max * 9;
+    buf         = malloc(size);
+    if (!trace.time || !trace.value || !buf) {
+        wm_cli_printf("no memory\r\n");
+        goto out;
+    }
+
+    source = tscodec_load_trace(series, &trace);
+    wm_cli_printf("series %u, %u %s samples, raw 8 bytes each (u32 time + float)\r\n", series, trace.n, source);
+
+    for (int mode = TSCODEC_FIXED; mode <= TSCODEC_FLOAT; mode++) {
+        bytes = tscodec_round_trip(mode, trace.time, trace.value, trace.n, buf, size);
+
+        ms = NOW_MS();
+        for (uint32_t loop = 0; loop < TSCODEC_BENCH_LOOPS; loop++) {
+            tscodec_enc_init(&enc, buf, size, mode);
+            for (uint32_t i = 0; i < trace.n; i++) {
+                if (TSCODEC_FLOAT == mode)
+                    tscodec_put_float(&enc, trace.time[i], trace.value[i] / 100.0f);
+                else
+                    tscodec_put_fixed(&enc, trace.time[i], trace.value[i]);
+            }
+        }
+        ms = NOW_MS() - ms;
+
+        wm_cli_printf("%-5s %6u bytes  %.2f bytes per sample  %.1fx  %.2f us per sample  %s\r\n",
+                      (TSCODEC_FLOAT == mode) ? "float" : "fixed", bytes, (float)bytes / trace.n,
+                      bytes ? 8.0f * trace.n / bytes : 0.0f, (float)ms * 1000 / (TSCODEC_BENCH_LOOPS * trace.n),
+                      bytes ? "ok" : "FAIL");
+    }
+
+out:
+    free(trace.time);
+    free(trace.value);
+    free(buf);
+}
+
+static void cmd_tscodec(int argc, char *argv[])
+{
+    if ((argc > 1) && !strcmp("bench", argv[1])) {
+        if (argc > 2) {
+            tscodec_bench(strtoul(argv[2], NULL, 0));
+        } else {
+            for (uint16_t series = TSDB_SERIES_SHT30_TEMP; series <= TSDB_SERIES_NTC_TEMP; series++)
+                tscodec_bench(series);
+        }
+    } else {
+        tscodec_check();
+    }
+}
+WM_CLI_CMD_DEFINE(tscodec, cmd_tscodec, tscodec cmd, tscodec [bench [series]] -- check the time series codec or measure it on recorded data);
@@ -0,0 +1,73 @@
+#ifndef __TSCODEC_H__
+#define __TSCODEC_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Bit packed timestamp / value streams, after facebook's gorilla.
+ *
+ * Timestamps: the first is stored in 32 bits, then the delta of deltas in the smallest of
+ *   '0'  '10' + 7 bits  '110' + 9 bits  '1110' + 12 bits  '1111' + 32 bits
+ * so a steady period costs one bit a sample.
+ *
+ * Values, one of
+ *   TSCODEC_FIXED  integers such as 0.01 C: first in 32 bits, then the zigzag delta in
+ *                  '0'  '10' + 4 bits  '110' + 8 bits  '1110' + 16 bits  '1111' + 32 bits
+ *   TSCODEC_FLOAT  floats: first in 32 bits, then the xor with the previous value as
+ *                  '0' for no change, '10' + the bits inside the previous leading / trailing zero window,
+ *                  '11' + 5 bits leading zeros + 5 bits length - 1 + the meaningful bits
+ *
+ * The stream carries no count, the decoder is told how many samples there are.
+ */
+typedef enum {
+    TSCODEC_FIXED = 0,
+    TSCODEC_FLOAT,
+} tscodec_mode_t;
+
+typedef struct {
+    uint8_t *buf;
+    uint32_t size;                     /**< bytes */
+    uint32_t bits;                     /**< written or read so far */
+} tscodec_bits_t;
+
+typedef struct {
+    tscodec_bits_t out;
+    tscodec_mode_t mode;
+    uint32_t count;                    /**< samples written, or read */
+    uint32_t total;                    /**< samples in the stream, decoder only */
+    uint32_t time;
+    int32_t delta;
+    uint32_t value;                    /**< int32_t or float bits, by mode */
+    uint8_t leading;                   /**< xor window of the last float */
+    uint8_t trailing;
+} tscodec_enc_t;
+
+typedef tscodec_enc_t tscodec_dec_t;
+
+void tscodec_enc_init(tscodec_enc_t *enc, uint8_t *buf, uint32_t size, tscodec_mode_t mode);
+
+/*
+ * append one sample, WM_ERR_NO_MEM when it does not fit; the stream is then left as before the call,
+ * so it can be sent and a new one started with the sample
+ */
+int tscodec_put_fixed(tscodec_enc_t *enc, uint32_t time, int32_t value);
+int tscodec_put_float(tscodec_enc_t *enc, uint32_t time, float value);
+
+/* bytes used, the last one padded with zeros */
+uint32_t tscodec_enc_bytes(const tscodec_enc_t *enc);
+
+void tscodec_dec_init(tscodec_dec_t *dec, const uint8_t *buf, uint32_t size, uint32_t count, tscodec_mode_t mode);
+
+/* the next sample, WM_ERR_FAILED after the last one or on a truncated stream */
+int tscodec_get_fixed(tscodec_dec_t *dec, uint32_t *time, int32_t *value);
+int tscodec_get_float(tscodec_dec_t *dec, uint32_t *time, float *value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TSCODEC_H__ */
@@ -0,0 +1,809 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wmsdk_config.h"
+#include "wm_drv_sdh_sdmmc.h"
+#include "wm_cli.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "crc.h"
+#include "sampler.h"
+#include "sht30.h"
+#include "ntc.h"
+#include "tsdb.h"
+#include "rollup.h"
+#include "sdio.h"
+
+#define LOG_TAG "tsdb"
+#include "wm_log.h"
+
+#define TSDB_BLOCK_MAGIC               0x42445354 /* "TSDB" */
+#define TSDB_INDEX_MAGIC               0x58445354 /* "TSDX" */
+
+#define TSDB_CRC_OFFSET                (TSDB_BLOCK_SIZE - 4)
+
+/* blocks per read when a query walks the log */
+#define TSDB_QUERY_BATCH               8
+
+#define TSDB_LOG_DEFAULT_PERIOD_S      10
+#define TSDB_LOG_FLUSH_S               60
+
+/* the bench writes its own store further out on the card */
+#define TSDB_BENCH_START               524288
+#define TSDB_BENCH_BLOCKS              16384
+#define TSDB_BENCH_QUERIES             20
+#define TSDB_BENCH_QUERY_S             600
+
+#define NOW_MS()                       (xTaskGetTickCount() * portTICK_PERIOD_MS)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t first_time;
+    uint16_t count;
+    uint16_t reserved;
+} tsdb_block_header_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t crc;                      /**< of the entries */
+} tsdb_index_header_t;
+
+static uint32_t tsdb_data_blocks(tsdb_t *db)
+{
+    return db->segments * TSDB_SEGMENT_BLOCKS;
+}
+
+static uint32_t tsdb_block_of(tsdb_t *db, uint32_t seq)
+{
+    return db->start_block + db->index_blocks + seq % tsdb_data_blocks(db);
+}
+
+static tsdb_record_t *tsdb_records(uint8_t *block)
+{
+    return (tsdb_record_t *)(block + TSDB_BLOCK_HEADER_SIZE);
+}
+
+/* the block holds sequence number seq and is intact */
+static bool tsdb_block_valid(const uint8_t *block, uint32_t seq)
+{
+    const tsdb_block_header_t *hdr = (const tsdb_block_header_t *)block;
+    uint32_t crc;
+
+    if ((TSDB_BLOCK_MAGIC != hdr->magic) || (seq != hdr->seq) || (hdr->count > TSDB_BLOCK_RECORDS))
+        return false;
+
+    memcpy(&crc, block + TSDB_CRC_OFFSET, 4);
+
+    return crc == crc32(CRC32_INIT, block, TSDB_CRC_OFFSET);
+}
+
+static int tsdb_read(tsdb_t *db, uint32_t seq, uint8_t *buf, uint32_t count)
+{
+    return sdio_read_blocks(db->dev, buf, tsdb_block_of(db, seq), count);
+}
+
+static int tsdb_write_block(tsdb_t *db)
+{
+    tsdb_block_header_t *hdr = (tsdb_block_header_t *)db->block;
+    uint32_t crc;
+    int ret;
+
+    hdr->count = (uint16_t)db->count;
+    crc        = crc32(CRC32_INIT, db->block, TSDB_CRC_OFFSET);
+    memcpy(db->block + TSDB_CRC_OFFSET, &crc, 4);
+
+    ret = sdio_write_blocks(db->dev, db->block, tsdb_block_of(db, db->seq), 1);
+    if (WM_ERR_SUCCESS != ret) {
+        wm_log_error("write seq %u ret=%d", db->seq, ret);
+        return ret;
+    }
+
+    db->stat.blocks_written++;
+    db->dirty = false;
+
+    if (TSDB_BLOCK_RECORDS == db->count) {
+        db->seq++;
+        db->count = 0;
+    }
+
+    return WM_ERR_SUCCESS;
+}
+
+/* write the index block holding the entry of segment */
+static int tsdb_write_index(tsdb_t *db, uint32_t segment)
+{
+    uint8_t buf[TSDB_BLOCK_SIZE];
+    tsdb_index_header_t *hdr = (tsdb_index_header_t *)buf;
+    uint32_t n               = segment / TSDB_INDEX_ENTRIES;
+    uint32_t first           = n * TSDB_INDEX_ENTRIES;
+    uint32_t count           = db->segments - first;
+    int ret;
+
+    if (count > TSDB_INDEX_ENTRIES)
+        count = TSDB_INDEX_ENTRIES;
+
+    memset(buf, 0, sizeof(buf));
+    memcpy(buf + TSDB_INDEX_HEADER_SIZE, &db->index[first], count * sizeof(tsdb_segment_t));
+    hdr->magic = TSDB_INDEX_MAGIC;
+    hdr->crc   = crc32(CRC32_INIT, buf + TSDB_INDEX_HEADER_SIZE, TSDB_BLOCK_SIZE - TSDB_INDEX_HEADER_SIZE);
+
+    ret = sdio_write_blocks(db->dev, buf, db->start_block + n, 1);
+    if (WM_ERR_SUCCESS == ret)
+        db->stat.index_writes++;
+
+    return ret;
+}
+
+static int tsdb_read_index(tsdb_t *db, uint8_t *buf)
+{
+    tsdb_index_header_t *hdr = (tsdb_index_header_t *)buf;
+    uint32_t first;
+    uint32_t count;
+    int ret;
+
+    for (uint32_t n = 0; n < db->index_blocks; n++) {
+        ret = sdio_read_blocks(db->dev, buf, db->start_block + n, 1);
+        if (WM_ERR_SUCCESS != ret)
+            return ret;
+        db->stat.open_reads++;
+
+        first = n * TSDB_INDEX_ENTRIES;
+        count = db->segments - first;
+        if (count > TSDB_INDEX_ENTRIES)
+            count = TSDB_INDEX_ENTRIES;
+
+        /* a block never written or torn leaves its segments unused, their data is not found again */
+        if ((TSDB_INDEX_MAGIC == hdr->magic) &&
+            (hdr->crc == crc32(CRC32_INIT, buf + TSDB_INDEX_HEADER_SIZE, TSDB_BLOCK_SIZE - TSDB_INDEX_HEADER_SIZE)))
+            memcpy(&db->index[first], buf + TSDB_INDEX_HEADER_SIZE, count * sizeof(tsdb_segment_t));
+        else
+            memset(&db->index[first], 0, count * sizeof(tsdb_segment_t));
+    }
+
+    return WM_ERR_SUCCESS;
+}
+
+/* the segment with the highest sequence number, or -1 when the store is empty */
+static int tsdb_newest_segment(tsdb_t *db)
+{
+    int newest   = -1;
+    uint32_t seq = 0;
+
+    for (uint32_t i = 0; i < db->segments; i++) {
+        if (db->index[i].seq > seq) {
+            seq    = db->index[i].seq;
+            newest = i;
+        }
+    }
+
+    return newest;
+}
+
+/*
+ * Blocks of a segment are written in order, so the ones holding the expected sequence number come
+ * first and a binary search finds the last of them. Only the newest segment is looked at.
+ */
+static int tsdb_recover(tsdb_t *db, uint8_t *buf)
+{
+    tsdb_block_header_t *hdr = (tsdb_block_header_t *)buf;
+    int newest               = tsdb_newest_segment(db);
+    uint32_t first;
+    int lo;
+    int hi;
+    int mid;
+    int ret;
+
+    db->seq   = 0;
+    db->count = 0;
+
+    if (newest < 0)
+        return WM_ERR_SUCCESS;
+
+    first = db->index[newest].seq - 1;
+    lo    = -1;
+    hi    = TSDB_SEGMENT_BLOCKS;
+    while (hi - lo > 1) {
+        mid = (lo + hi) / 2;
+        ret = tsdb_read(db, first + mid, buf, 1);
+        if (WM_ERR_SUCCESS != ret)
+            return ret;
+        db->stat.open_reads++;
+
+        if (tsdb_block_valid(buf, first + mid))
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    /* the segment was started but nothing reached its first block */
+    if (lo < 0) {
+        db->seq       = first;
+        db->last_time = db->index[newest].first_time;
+        return WM_ERR_SUCCESS;
+    }
+
+    ret = tsdb_read(db, first + lo, db->block, 1);
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+    db->stat.open_reads++;
+
+    hdr           = (tsdb_block_header_t *)db->block;
+    db->last_time = tsdb_records(db->block)[hdr->count - 1].time;
+
+    /* a partial block goes on filling in ram and is rewritten in place */
+    if (TSDB_BLOCK_RECORDS == hdr->count) {
+        db->seq   = first + lo + 1;
+        db->count = 0;
+    } else {
+        db->seq   = first + lo;
+        db->count = hdr->count;
+    }
+
+    return WM_ERR_SUCCESS;
+}
+
+static int tsdb_setup(tsdb_t *db, uint32_t start_block, uint32_t blocks)
+{
+    uint32_t segments = blocks / TSDB_SEGMENT_BLOCKS;
+    wm_device_t *dev;
+
+    memset(db, 0, sizeof(*db));
+
+    /* the index takes from the data, drop segments until both fit */
+    while (segments && (TSDB_INDEX_BLOCKS(segments) + segments * TSDB_SEGMENT_BLOCKS > blocks))
+        segments--;
+
+    /* the log wraps a whole segment at a time, with one left there would be no history */
+    if (segments < 2)
+        return WM_ERR_INVALID_PARAM;
+
+    dev = wm_dt_get_device_by_name("sdmmc");
+    if (!(dev && (WM_DEV_ST_INITED == dev->state)))
+        dev = wm_drv_sdh_sdmmc_init("sdmmc");
+
+    if (!dev)
+        return WM_ERR_FAILED;
+
+    db->dev          = dev;
+    db->start_block  = start_block;
+    db->segments     = segments;
+    db->index_blocks = TSDB_INDEX_BLOCKS(segments);
+    db->index        = calloc(segments, sizeof(tsdb_segment_t));
+    db->block        = malloc(TSDB_BLOCK_SIZE);
+    db->lock         = xSemaphoreCreateMutex();
+
+    if (!db->index || !db->block || !db->lock) {
+        tsdb_close(db);
+        return WM_ERR_NO_MEM;
+    }
+
+    return WM_ERR_SUCCESS;
+}
+
+static void tsdb_set_time_base(tsdb_t *db)
+{
+    /* unsigned wrap keeps tsdb_now right whatever the order of the two */
+    db->time_base = (db->last_time ? db->last_time + 1 : 0) - NOW_MS() / 1000;
+}
+
+int tsdb_open(tsdb_t *db, uint32_t start_block, uint32_t blocks)
+{
+    uint8_t buf[TSDB_BLOCK_SIZE];
+    uint32_t start = NOW_MS();
+    int ret;
+
+    ret = tsdb_setup(db, start_block, blocks);
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    ret = tsdb_read_index(db, buf);
+    if (WM_ERR_SUCCESS == ret)
+        ret = tsdb_recover(db, buf);
+
+    if (WM_ERR_SUCCESS != ret) {
+        wm_log_error("open ret=%d", ret);
+        tsdb_close(db);
+        return ret;
+    }
+
+    tsdb_set_time_base(db);
+    db->stat.open_ms = NOW_MS() - start;
+
+    wm_log_debug("open %u segments, seq %u, %u records in block, %u reads", db->segments, db->seq, db->count,
+                 db->stat.open_reads);
+
+    return WM_ERR_SUCCESS;
+}
+
+int tsdb_format(tsdb_t *db, uint32_t start_block, uint32_t blocks)
+{
+    int ret;
+
+    ret = tsdb_setup(db, start_block, blocks);
+    if (WM_ERR_SUCCESS != ret)
+        return ret;
+
+    tsdb_set_time_base(db);
+
+    ret = tsdb_clear(db);
+    if (WM_ERR_SUCCESS != ret)
+        tsdb_close(db);
+
+    return ret;
+}
+
+int tsdb_clear(tsdb_t *db)
+{
+    int ret = WM_ERR_SUCCESS;
+
+    if (!db->dev)
+        return WM_ERR_NO_INITED;
+
+    xSemaphoreTake(db->lock, portMAX_DELAY);
+
+    memset(db->index, 0, db->segments * sizeof(tsdb_segment_t));
+    for (uint32_t n = 0; (WM_ERR_SUCCESS == ret) && (n < db->index_blocks); n++)
+        ret = tsdb_write_index(db, n * TSDB_INDEX_ENTRIES);
+
+    db->seq       = 0;
+    db->count     = 0;
+    db->dirty     = false;
+    db->last_time = 0;
+
+    xSemaphoreGive(db->lock);
+
+    return ret;
+}
+
+void tsdb_close(tsdb_t *db)
+{
+    if (db->dev && db->block && db->lock)
+        tsdb_flush(db);
+
+    if (db->lock)
+        vSemaphoreDelete(db->lock);
+    free(db->index);
+    free(db->block);
+
+    memset(db, 0, sizeof(*db));
+}
+
+int tsdb_append(tsdb_t *db, uint32_t time, uint16_t series, int16_t value)
+{
+    tsdb_block_header_t *hdr;
+    tsdb_record_t *rec;
+    uint32_t segment;
+    int ret = WM_ERR_SUCCESS;
+
+    if (!db->dev)
+        return WM_ERR_NO_INITED;
+
+    xSemaphoreTake(db->lock, portMAX_DELAY);
+
+    if (time < db->last_time) {
+        xSemaphoreGive(db->lock);
+        return WM_ERR_INVALID_PARAM;
+    }
+
+    /* a full block whose write failed stays in ram, it goes out before anything is added */
+    if (TSDB_BLOCK_RECORDS <= db->count)
+        ret = tsdb_write_block(db);
+
+    if ((WM_ERR_SUCCESS == ret) && !db->count) {
+        /* a new segment takes over the oldest one, its index entry goes out before any of its data */
+        if (!(db->seq % TSDB_SEGMENT_BLOCKS)) {
+            segment                       = (db->seq / TSDB_SEGMENT_BLOCKS) % db->segments;
+            db->index[segment].seq        = db->seq + 1;
+            db->index[segment].first_time = time;
+            ret                           = tsdb_write_index(db, segment);
+        }
+
+        memset(db->block, 0, TSDB_BLOCK_SIZE);
+        hdr             = (tsdb_block_header_t *)db->block;
+        hdr->magic      = TSDB_BLOCK_MAGIC;
+        hdr->seq        = db->seq;
+        hdr->first_time = time;
+    }
+
+    if ((WM_ERR_SUCCESS == ret) && (db->count < TSDB_BLOCK_RECORDS)) {
+        rec         = &tsdb_records(db->block)[db->count++];
+        rec->time   = time;
+        rec->series = series;
+        rec->value  = value;
+
+        db->last_time = time;
+        db->dirty     = true;
+        db->stat.appends++;
+
+        if (TSDB_BLOCK_RECORDS == db->count)
+            ret = tsdb_write_block(db);
+    }
+
+    xSemaphoreGive(db->lock);
+
+    return ret;
+}
+
+int tsdb_flush(tsdb_t *db)
+{
+    int ret = WM_ERR_SUCCESS;
+
+    if (!db->dev)
+        return WM_ERR_NO_INITED;
+
+    xSemaphoreTake(db->lock, portMAX_DELAY);
+    if (db->dirty && db->count)
+        ret = tsdb_write_block(db);
+    xSemaphoreGive(db->lock);
+
+    return ret;
+}
+
+/* pass the matching records of one block on, false once the query is done */
+static bool tsdb_visit_block(uint8_t *block, uint32_t count, uint32_t t0, uint32_t t1, uint16_t series,
+                             tsdb_visit_t visit, void *arg, tsdb_query_stat_t *stat)
+{
+    tsdb_record_t *rec = tsdb_records(block);
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (rec[i].time > t1)
+            return false;
+        if ((rec[i].time < t0) || ((TSDB_SERIES_ANY != series) && (series != rec[i].series)))
+            continue;
+
+        stat->records++;
+        if (!visit(&rec[i], arg))
+            return false;
+    }
+
+    return true;
+}
+
+/*
+ * sequence number of the last full block on the card whose first record is before t0; records of
+ * one time may straddle blocks and segments, so one starting at t0 can have some of them behind it
+ */
+static int tsdb_find(tsdb_t *db, uint32_t t0, uint8_t *buf, uint32_t *seq, tsdb_query_stat_t *stat)
+{
+    tsdb_block_header_t *hdr = (tsdb_block_header_t *)buf;
+    uint32_t best_seq        = 0;
+    uint32_t oldest_seq      = UINT32_MAX;
+    uint32_t first;
+    uint32_t n;
+    uint32_t lo;
+    uint32_t hi;
+    uint32_t mid;
+    int ret;
+
+    /* the segment in ram, the newest one starting before t0, else the oldest */
+    for (uint32_t i = 0; i < db->segments; i++) {
+        if (!db->index[i].seq)
+            continue;
+        if ((db->index[i].first_time < t0) && (db->index[i].seq > best_seq))
+            best_seq = db->index[i].seq;
+        if (db->index[i].seq < oldest_seq)
+            oldest_seq = db->index[i].seq;
+    }
+
+    if (UINT32_MAX == oldest_seq) {
+        *seq = db->seq;
+        return WM_ERR_SUCCESS;
+    }
+
+    first = (best_seq ? best_seq : oldest_seq) - 1;
+    n     = db->seq - first;
+    if (n > TSDB_SEGMENT_BLOCKS)
+        n = TSDB_SEGMENT_BLOCKS;
+
+    /* and the block within it */
+    lo = 0;
+    hi = n;
+    while (hi - lo > 1) {
+        mid = (lo + hi) / 2;
+        ret = tsdb_read(db, first + mid, buf, 1);
+        if (WM_ERR_SUCCESS != ret)
+            return ret;
+        stat->blocks_read++;
+
+        if (tsdb_block_valid(buf, first + mid) && (hdr->first_time < t0))
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    *seq = first + lo;
+
+    return WM_ERR_SUCCESS;
+}
+
+int tsdb_query(tsdb_t *db, uint32_t t0, uint32_t t1, uint16_t series, tsdb_visit_t visit, void *arg,
+               tsdb_query_stat_t *stat)
+{
+    tsdb_query_stat_t local;
+    tsdb_block_header_t *hdr;
+    uint8_t *buf;
+    uint8_t *block;
+    uint32_t seq;
+    uint32_t n;
+    uint32_t pos;
+    bool more = true;
+    int ret;
+
+    if (!db->dev)
+        return WM_ERR_NO_INITED;
+
+    if (!stat)
+        stat = &local;
+    memset(stat, 0, sizeof(*stat));
+
+    buf = malloc(TSDB_BLOCK_SIZE * TSDB_QUERY_BATCH);
+    if (!buf)
+        return WM_ERR_NO_MEM;
+
+    xSemaphoreTake(db->lock, portMAX_DELAY);
+
+    ret = tsdb_find(db, t0, buf, &seq, stat);
+
+    /* full blocks on the card, a batch never crosses the end of the range */
+    while ((WM_ERR_SUCCESS == ret) && more && (seq != db->seq)) {
+        pos = seq % tsdb_data_blocks(db);
+        n   = db->seq - seq;
+        if (n > TSDB_QUERY_BATCH)
+            n = TSDB_QUERY_BATCH;
+        if (n > tsdb_data_blocks(db) - pos)
+            n = tsdb_data_blocks(db) - pos;
+
+        ret = tsdb_read(db, seq, buf, n);
+        if (WM_ERR_SUCCESS != ret)
+            break;
+        stat->blocks_read += n;
+
+        for (uint32_t i = 0; more && (i < n); i++, seq++) {
+            block = buf + i * TSDB_BLOCK_SIZE;
+            hdr   = (tsdb_block_header_t *)block;
+            if (!tsdb_block_valid(block, seq))
+                continue;
+            if (hdr->first_time > t1)
+                more = false;
+            else
+                more = tsdb_visit_block(block, hdr->count, t0, t1, series, visit, arg, stat);
+        }
+    }
+
+    /* and the block still filling */
+    if ((WM_ERR_SUCCESS == ret) && more && db->count)
+        tsdb_visit_block(db->block, db->count, t0, t1, series, visit, arg, stat);
+
+    xSemaphoreGive(db->lock);
+
+    free(buf);
+
+    return ret;
+}
+
+uint32_t tsdb_now(tsdb_t *db)
+{
+    return db->time_base + NOW_MS() / 1000;
+}
+
+static tsdb_t g_tsdb = { 0 };
+
+tsdb_t *tsdb_default(void)
+{
+    if (!g_tsdb.dev && (WM_ERR_SUCCESS != tsdb_open(&g_tsdb, TSDB_DEFAULT_START, TSDB_DEFAULT_BLOCKS)))
+        return NULL;
+
+    return &g_tsdb;
+}
+
+static bool tsdb_log_append(uint32_t now, uint16_t series, int16_t value)
+{
+    if (WM_ERR_SUCCESS != tsdb_append(&g_tsdb, now, series, value))
+        return false;
+
+    rollup_add(series, now, value);
+
+    return true;
+}
+
+/* the latest sensor samples into the default store and its rollups, runs in the sampler task */
+static int tsdb_log_sample(sampler_sample_t *sample, void *arg)
+{
+    static uint32_t last_flush = 0;
+    sht30_reading_t reading;
+    uint32_t now = tsdb_now(&g_tsdb);
+    uint32_t n   = 0;
+    float temp;
+
+    if ((WM_ERR_SUCCESS == sht30_get(&reading)) && (NOW_MS() - reading.time_ms <= SHT30_STALE_MS)) {
+        n += tsdb_log_append(now, TSDB_SERIES_SHT30_TEMP, (int16_t)(reading.temp * 100));
+        n += tsdb_log_append(now, TSDB_SERIES_SHT30_HUMI, (int16_t)(reading.humi * 100));
+    }
+
+    if (WM_ERR_SUCCESS == ntc_get(&temp))
+        n += tsdb_log_append(now, TSDB_SERIES_NTC_TEMP, (int16_t)(temp * 100));
+
+    if (now - last_flush >= TSDB_LOG_FLUSH_S) {
+        tsdb_flush(&g_tsdb);
+        rollup_flush();
+        last_flush = now;
+    }
+
+    sample->value[0] = n;
+
+    return n ? WM_ERR_SUCCESS : WM_ERR_FAILED;
+}
+
+static bool tsdb_print_record(const tsdb_record_t *record, void *arg)
+{
+    uint32_t *left = arg;
+
+    wm_cli_printf("%10u  %u  %d.%02d\r\n", record->time, record->series, record->value / 100,
+                  abs(record->value % 100));
+
+    return --*left > 0;
+}
+
+static bool tsdb_count_record(const tsdb_record_t *record, void *arg)
+{
+    return true;
+}
+
+/* the bench writes series 1 once a second, a query of it sees every second in turn */
+static bool tsdb_check_record(const tsdb_record_t *record, void *arg)
+{
+    uint32_t *next = arg;
+
+    if ((record->time != next[0]) || (1 != record->series))
+        next[1]++;
+    next[0] = record->time + 1;
+
+    return true;
+}
+
+static void tsdb_bench(uint32_t records)
+{
+    static tsdb_t db;
+    tsdb_query_stat_t qs;
+    uint32_t blocks_read = 0;
+    uint32_t found       = 0;
+    uint32_t query_max   = 0;
+    uint32_t rnd         = 1;
+    uint32_t bad         = 0;
+    uint32_t check[2];
+    uint32_t last;
+    uint32_t expect;
+    uint32_t start;
+    uint32_t ms;
+    uint32_t t0;
+    int ret;
+
+    ret = tsdb_format(&db, TSDB_BENCH_START, TSDB_BENCH_BLOCKS);
+    if (WM_ERR_SUCCESS != ret) {
+        wm_cli_printf("format ret=%d\r\n", ret);
+        return;
+    }
+
+    /* three series a second, as the logger writes them */
+    start = NOW_MS();
+    for (uint32_t i = 0; (WM_ERR_SUCCESS == ret) && (i < records); i++)
+        ret = tsdb_append(&db, i / 3, 1 + i % 3, (int16_t)(2000 + i % 1000));
+    if (WM_ERR_SUCCESS == ret)
+        ret = tsdb_flush(&db);
+    ms = NOW_MS() - start;
+
+    wm_cli_printf("ingest %u records in %u ms, %u records/s, %u blocks, %u index writes, ret=%d\r\n", records, ms,
+                  ms ? (uint32_t)((uint64_t)records * 1000 / ms) : 0, db.stat.blocks_written, db.stat.index_writes,
+                  ret);
+
+    tsdb_close(&db);
+    ret = tsdb_open(&db, TSDB_BENCH_START, TSDB_BENCH_BLOCKS);
+    wm_cli_printf("reopen %u ms, %u blocks read, seq %u, %u records in block, ret=%d\r\n", db.stat.open_ms,
+                  db.stat.open_reads, db.seq, db.count, ret);
+    if (WM_ERR_SUCCESS != ret)
+        return;
+
+    /*
+     * random starts, and the first second of a block or a segment, whose records of that second
+     * mostly begin at the end of the one before
+     */
+    last  = records ? (records - 1) / 3 : 0;
+    start = NOW_MS();
+    for (uint32_t i = 0; i < TSDB_BENCH_QUERIES; i++) {
+        rnd = rnd * 1103515245 + 12345;
+        if (0 == i % 3)
+            t0 = (rnd >> 8) % (records / 3 + 1);
+        else if (1 == i % 3)
+            t0 = (rnd >> 8) % (records / TSDB_BLOCK_RECORDS + 1) * TSDB_BLOCK_RECORDS / 3;
+        else
+            t0 = (rnd >> 8) % (records / (TSDB_BLOCK_RECORDS * TSDB_SEGMENT_BLOCKS) + 1) * TSDB_BLOCK_RECORDS *
+                 TSDB_SEGMENT_BLOCKS / 3;
+
+        check[0] = t0;
+        check[1] = 0;
+        ms       = NOW_MS();
+        tsdb_query(&db, t0, t0 + TSDB_BENCH_QUERY_S, 1, tsdb_check_record, check, &qs);
+        ms = NOW_MS() - ms;
+        if (ms > query_max)
+            query_max = ms;
+        blocks_read += qs.blocks_read;
+        found       += qs.records;
+
+        expect = 0;
+        if (records && (t0 <= last))
+            expect = ((t0 + TSDB_BENCH_QUERY_S < last) ? TSDB_BENCH_QUERY_S : last - t0) + 1;
+        if (check[1] || (qs.records != expect)) {
+            wm_cli_printf("query from %u: %u records, %u expected, %u out of order\r\n", t0, qs.records, expect,
+                          check[1]);
+            bad++;
+        }
+    }
+    ms = NOW_MS() - start;
+
+    wm_cli_printf("%u queries of %u s, %.1f ms average, %u ms max, %.1f blocks and %u records each, %u wrong\r\n",
+                  TSDB_BENCH_QUERIES, TSDB_BENCH_QUERY_S, (float)ms / TSDB_BENCH_QUERIES, query_max,
+                  (float)blocks_read / TSDB_BENCH_QUERIES, found / TSDB_BENCH_QUERIES, bad);
+
+    start = NOW_MS();
+    tsdb_query(&db, 0, UINT32_MAX, TSDB_SERIES_ANY, tsdb_count_record, NULL, &qs);
+    wm_cli_printf("full scan %u records, %u blocks, %u ms\r\n", qs.records, qs.blocks_read, NOW_MS() - start);
+
+    tsdb_close(&db);
+}
+
+static void cmd_tsdb(int argc, char *argv[])
+{
+    tsdb_query_stat_t qs;
+    uint32_t left;
+    uint32_t start;
+    int ret;
+
+    if ((argc > 1) && !strcmp("bench", argv[1])) {
+        tsdb_bench((argc > 2) ? strtoul(argv[2], NULL, 0) : 100000);
+        return;
+    }
+
+    if ((argc > 1) && !strcmp("format", argv[1])) {
+        /* in place, the logger may be appending to it; the rollups go with it */
+        ret = g_tsdb.dev ? tsdb_clear(&g_tsdb) : tsdb_format(&g_tsdb, TSDB_DEFAULT_START, TSDB_DEFAULT_BLOCKS);
+        if (WM_ERR_SUCCESS == ret)
+            ret = rollup_format();
+        wm_cli_printf("format ret=%d\r\n", ret);
+        return;
+    }
+
+    if (!tsdb_default()) {
+        wm_cli_printf("open failed\r\n");
+        return;
+    }
+
+    if ((argc > 1) && !strcmp("log", argv[1])) {
+        ret = sampler_register("tsdb", ((argc > 2) ? strtoul(argv[2], NULL, 0) : TSDB_LOG_DEFAULT_PERIOD_S) * 1000,
+                               SAMPLER_PHASE_AUTO, tsdb_log_sample, NULL);
+        sht30_start();
+        ntc_sample_start();
+        wm_cli_printf("log ret=%d\r\n", (ret < 0) ? ret : WM_ERR_SUCCESS);
+    } else if ((argc > 1) && !strcmp("flush", argv[1])) {
+        ret = tsdb_flush(&g_tsdb);
+        if (WM_ERR_SUCCESS == ret)
+            ret = rollup_flush();
+        wm_cli_printf("flush ret=%d\r\n", ret);
+    } else if ((argc > 3) && !strcmp("query", argv[1])) {
+        left  = 64;
+        start = NOW_MS();
+        ret   = tsdb_query(&g_tsdb, strtoul(argv[2], NULL, 0), strtoul(argv[3], NULL, 0),
+                           (argc > 4) ? strtoul(argv[4], NULL, 0) : TSDB_SERIES_ANY, tsdb_print_record, &left, &qs);
+        wm_cli_printf("%u records, %u blocks read, %u ms, ret=%d\r\n", qs.records, qs.blocks_read, NOW_MS() - start,
+                      ret);
+    } else {
+        wm_cli_printf("blocks %u + %u segments of %u, seq %u, %u records in ram, last time %u, now %u\r\n",
+                      g_tsdb.start_block, g_tsdb.segments, TSDB_SEGMENT_BLOCKS, g_tsdb.seq, g_tsdb.count,
+                      g_tsdb.last_time, tsdb_now(&g_tsdb));
+        wm_cli_printf("%u appends, %u blocks written, %u index writes, opened in %u ms with %u reads\r\n",
+                      g_tsdb.stat.appends, g_tsdb.stat.blocks_written, g_tsdb.stat.index_writes, g_tsdb.stat.open_ms,
+                      g_tsdb.stat.open_reads);
+    }
+}
+WM_CLI_CMD_DEFINE(tsdb, cmd_tsdb, tsdb cmd, tsdb [log [period_s] | flush | query <t0> <t1> [series] | format | bench [records]] -- sensor history on the sd card);
@@ -0,0 +1,130 @@
+#ifndef __TSDB_H__
+#define __TSDB_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "wm_dt.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Append only time series store on a raw range of sd card blocks.
+ *
+ * The range starts with TSDB_INDEX_BLOCKS(n) index blocks, then data blocks grouped in segments of
+ * TSDB_SEGMENT_BLOCKS. Data blocks are written strictly in order, each carries its sequence number,
+ * the time of its first record and a crc32, and the log wraps onto the oldest segment when the range
+ * is full. The index keeps the first sequence number and time of every segment; it is written once
+ * per segment, so a time range query finds its segment in ram and its block with a binary search of
+ * that segment, and opening the store only searches the newest segment for the last good block.
+ *
+ * Records are batched in ram until a block is full. tsdb_flush writes a partial block, which the
+ * next flush of the same block overwrites, so a crash loses at most the unflushed records.
+ */
+#define TSDB_BLOCK_SIZE                512
+#define TSDB_SEGMENT_BLOCKS            256
+
+#define TSDB_BLOCK_HEADER_SIZE         16
+#define TSDB_RECORD_SIZE               8
+#define TSDB_BLOCK_RECORDS             ((TSDB_BLOCK_SIZE - TSDB_BLOCK_HEADER_SIZE - 4) / TSDB_RECORD_SIZE)
+
+#define TSDB_INDEX_HEADER_SIZE         8
+#define TSDB_INDEX_ENTRY_SIZE          8
+#define TSDB_INDEX_ENTRIES             ((TSDB_BLOCK_SIZE - TSDB_INDEX_HEADER_SIZE) / TSDB_INDEX_ENTRY_SIZE)
+#define TSDB_INDEX_BLOCKS(segments)    (((segments) + TSDB_INDEX_ENTRIES - 1) / TSDB_INDEX_ENTRIES)
+
+/* the default store, clear of the images the readme puts at the start of sd.img */
+#define TSDB_DEFAULT_START             262144
+#define TSDB_DEFAULT_BLOCKS            131072
+
+#define TSDB_SERIES_ANY                0xFFFF
+
+/* series the sensor logger writes, values in 0.01 units */
+#define TSDB_SERIES_SHT30_TEMP         1
+#define TSDB_SERIES_SHT30_HUMI         2
+#define TSDB_SERIES_NTC_TEMP           3
+
+typedef struct {
+    uint32_t time;                     /**< seconds, see tsdb_now */
+    uint16_t series;
+    int16_t value;
+} tsdb_record_t;
+
+typedef struct {
+    uint32_t seq;                      /**< sequence number of the segment's first block + 1, 0 when unused */
+    uint32_t first_time;
+} tsdb_segment_t;
+
+typedef struct {
+    uint32_t appends;
+    uint32_t blocks_written;           /**< including rewrites of a flushed partial block */
+    uint32_t index_writes;
+    uint32_t open_reads;               /**< blocks read to open the store */
+    uint32_t open_ms;
+} tsdb_stat_t;
+
+typedef struct {
+    uint32_t blocks_read;
+    uint32_t records;                  /**< passed to the visitor */
+} tsdb_query_stat_t;
+
+typedef struct {
+    wm_device_t *dev;
+    SemaphoreHandle_t lock;
+    uint32_t start_block;
+    uint32_t segments;
+    uint32_t index_blocks;
+
+    tsdb_segment_t *index;             /**< one entry per segment, in ram as on the card */
+    uint32_t seq;                      /**< sequence number of the block being filled */
+    uint8_t *block;                    /**< the block being filled */
+    uint32_t count;                    /**< records in it */
+    bool dirty;                        /**< it holds records not yet on the card */
+
+    uint32_t last_time;
+    uint32_t time_base;                /**< tsdb_now at boot, continues from the last record */
+
+    tsdb_stat_t stat;
+} tsdb_t;
+
+/* true to go on, false to stop the query */
+typedef bool (*tsdb_visit_t)(const tsdb_record_t *record, void *arg);
+
+/* open the store in blocks [start_block, start_block + blocks), recovering the write position */
+int tsdb_open(tsdb_t *db, uint32_t start_block, uint32_t blocks);
+
+/* an empty store in the range, whatever was there is lost */
+int tsdb_format(tsdb_t *db, uint32_t start_block, uint32_t blocks);
+
+/*
+ * empty an open store in place, safe while other tasks use it; tsdb_now carries on, so a writer
+ * holding a time taken before does not go backwards
+ */
+int tsdb_clear(tsdb_t *db);
+
+/* flush and free */
+void tsdb_close(tsdb_t *db);
+
+/* time must not go backwards, WM_ERR_INVALID_PARAM when it does */
+int tsdb_append(tsdb_t *db, uint32_t time, uint16_t series, int16_t value);
+
+int tsdb_flush(tsdb_t *db);
+
+/* every record with t0 <= time <= t1 of series, or all with TSDB_SERIES_ANY, in time order */
+int tsdb_query(tsdb_t *db, uint32_t t0, uint32_t t1, uint16_t series, tsdb_visit_t visit, void *arg,
+               tsdb_query_stat_t *stat);
+
+/* the store at TSDB_DEFAULT_START the logger writes, opened on first use, NULL when that fails */
+tsdb_t *tsdb_default(void);
+
+/* seconds since boot, offset so that they carry on after the newest record found when opening */
+uint32_t tsdb_now(tsdb_t *db);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TSDB_H__ */
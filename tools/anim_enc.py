@@ -0,0 +1,170 @@
+#!/usr/bin/env python3
+"""Encode a sequence of images into the animation container played by `anim play`.
+
+The container is written to raw sd blocks, no file system is needed:
+
+    header block(s)  "WANM", version, width, height, fps, frames, keys, data block,
+                     then the key frame index (frame number, block) from byte 32
+    frames           each frame starts on a block boundary:
+                     type (0 key, 1 delta), reserved, rect count, frame length in blocks,
+                     then per rect x, y, w, h, encoded length and the rle data
+
+Header fields are little-endian. RLE tokens are a 16-bit little-endian word: bit 15 set is a
+repeat of the one pixel that follows (count in bits 0..14), clear is a literal run of count pixels.
+Pixels are rgb565 high byte first, the lcd order.
+
+usage: anim_enc.py [-f fps] [-k key_interval] -o out.anim frame0.png frame1.png ...
+"""
+
+import argparse
+import struct
+import sys
+
+from PIL import Image
+
+BLOCK_SIZE = 512
+HEADER_SIZE = 32
+TILE = 16
+MAX_RUN = 0x7FFF
+FRAME_KEY = 0
+FRAME_DELTA = 1
+
+
+def to_rgb565(path, width, height):
+    img = Image.open(path).convert("RGB")
+    if img.size != (width, height):
+        img = img.resize((width, height))
+    out = bytearray(width * height * 2)
+    for i, (r, g, b) in enumerate(img.getdata()):
+        v = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3)
+        out[2 * i] = v >> 8
+        out[2 * i + 1] = v & 0xFF
+    return bytes(out)
+
+
+def rle(pixels):
+    """pixels: bytes of big-endian rgb565"""
+    out = bytearray()
+    n = len(pixels) // 2
+    i = 0
+    lit_start = 0
+
+    def flush_literal(end):
+        s = lit_start
+        while s < end:
+            c = min(end - s, MAX_RUN)
+            out.extend(struct.pack("<H", c))
+            out.extend(pixels[2 * s:2 * (s + c)])
+            s += c
+
+    while i < n:
+        px = pixels[2 * i:2 * i + 2]
+        j = i + 1
+        while j < n and j - i < MAX_RUN and pixels[2 * j:2 * j + 2] == px:
+            j += 1
+        # a repeat costs 4 bytes, only worth it from 3 pixels on
+        if j - i >= 3:
+            flush_literal(i)
+            out.extend(struct.pack("<H", 0x8000 | (j - i)))
+            out.extend(px)
+            lit_start = j
+        i = j if j - i >= 3 else i + 1
+    flush_literal(n)
+    return bytes(out)
+
+
+def crop(frame, width, x, y, w, h):
+    return b"".join(frame[2 * ((y + r) * width + x):2 * ((y + r) * width + x + w)] for r in range(h))
+
+
+def changed_rects(prev, cur, width, height):
+    """changed tiles, merged into spans per tile row, then spans stacked when they line up"""
+    line = width * 2
+    spans = []
+    for ty in range(0, height, TILE):
+        th = min(TILE, height - ty)
+        row = []
+        for tx in range(0, width, TILE):
+            tw = min(TILE, width - tx)
+            dirty = any(prev[(ty + r) * line + 2 * tx:(ty + r) * line + 2 * (tx + tw)] !=
+                        cur[(ty + r) * line + 2 * tx:(ty + r) * line + 2 * (tx + tw)] for r in range(th))
+            if dirty:
+                if row and row[-1][0] + row[-1][2] == tx:
+                    row[-1][2] += tw
+                else:
+                    row.append([tx, ty, tw, th])
+        for s in row:
+            above = next((r for r in spans if r[0] == s[0] and r[2] == s[2] and r[1] + r[3] == ty), None)
+            if above:
+                above[3] += th
+            else:
+                spans.append(s)
+    return spans
+
+
+def frame_record(ftype, rects):
+    body = bytearray()
+    for (x, y, w, h, data) in rects:
+        body.extend(struct.pack("<HHHHI", x, y, w, h, len(data)))
+        body.extend(data)
+    size = 8 + len(body)
+    blocks = (size + BLOCK_SIZE - 1) // BLOCK_SIZE
+    rec = struct.pack("<BBHI", ftype, 0, len(rects), blocks) + bytes(body)
+    return rec + bytes(blocks * BLOCK_SIZE - len(rec))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("-o", "--output", required=True)
+    ap.add_argument("-f", "--fps", type=int, default=15)
+    ap.add_argument("-k", "--key-interval", type=int, default=30, help="frames between forced key frames")
+    ap.add_argument("-W", "--width", type=int, default=480)
+    ap.add_argument("-H", "--height", type=int, default=272)
+    ap.add_argument("frames", nargs="+")
+    args = ap.parse_args()
+
+    w, h = args.width, args.height
+    records = []
+    keys = []
+    prev = None
+    for n, path in enumerate(args.frames):
+        cur = to_rgb565(path, w, h)
+        key = rle(cur)
+        rec = None
+        if prev is not None and n % args.key_interval:
+            rects = [(x, y, rw, rh, rle(crop(cur, w, x, y, rw, rh)))
+                     for (x, y, rw, rh) in changed_rects(prev, cur, w, h)]
+            # a delta that is not clearly smaller than the key frame is not worth the dependency
+            if sum(len(r[4]) + 12 for r in rects) < len(key) * 9 // 10:
+                rec = frame_record(FRAME_DELTA, rects)
+        if rec is None:
+            keys.append(n)
+            rec = frame_record(FRAME_KEY, [(0, 0, w, h, key)])
+        records.append(rec)
+        prev = cur
+        print("frame %d: %s, %d blocks" % (n, "key" if rec[0] == FRAME_KEY else "delta", len(rec) // BLOCK_SIZE),
+              file=sys.stderr)
+
+    header_size = HEADER_SIZE + 8 * len(keys)
+    data_block = (header_size + BLOCK_SIZE - 1) // BLOCK_SIZE
+    index = bytearray()
+    block = data_block
+    for n, rec in enumerate(records):
+        if n in keys:
+            index.extend(struct.pack("<II", n, block))
+        block += len(rec) // BLOCK_SIZE
+
+    header = struct.pack("<4sHHHHIII", b"WANM", 1, w, h, args.fps, len(records), len(keys), data_block)
+    header += bytes(HEADER_SIZE - len(header)) + bytes(index)
+    header += bytes(data_block * BLOCK_SIZE - len(header))
+
+    with open(args.output, "wb") as f:
+        f.write(header)
+        for rec in records:
+            f.write(rec)
+
+    print("%d frames, %d key frames, %d blocks" % (len(records), len(keys), block), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
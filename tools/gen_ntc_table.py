@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+"""Generate main/src/ntc_table.h, the adc millivolt to centi-degree table used by ntc.c.
+
+The table reproduces the conversion ntc.c used to do in float for every sample:
+
+    rt = (100000 * mv) / (3300 - mv) * 10          integer, 100k reference to 3.3 V
+    t  = 1 / (1 / 298.15 + ln(rt / 100000) / 3950) - 273.15 + 0.5
+
+Knots are placed greedily: each segment is made as long as possible while the integer
+linear interpolation done on the target stays within the error bound at every millivolt,
+so the steep hot end gets short segments and the flat middle long ones.
+
+usage: gen_ntc_table.py [-e max_error_centi] [--t-min -40] [--t-max 125] [-o ntc_table.h]
+"""
+
+import argparse
+import math
+import os
+
+REF_MV = 3300
+R_REF = 100000
+B = 3950
+T25 = 273.15 + 25
+
+
+def formula(mv):
+    rt = (R_REF * mv) // (REF_MV - mv) * 10
+    return 1 / (1 / T25 + math.log(rt / R_REF) / B) - 273.15 + 0.5
+
+
+def centi(mv):
+    return int(round(formula(mv) * 100))
+
+
+def interp(a, b, mv):
+    """what ntc.c computes, c division truncates toward zero"""
+    num = (b[1] - a[1]) * (mv - a[0])
+    den = b[0] - a[0]
+    q = abs(num) // den
+    return a[1] + (q if num >= 0 else -q)
+
+
+def segment_ok(a, b, max_err):
+    return all(abs(interp(a, b, mv) - formula(mv) * 100) <= max_err for mv in range(a[0] + 1, b[0]))
+
+
+def build(mv_min, mv_max, max_err):
+    knots = [(mv_min, centi(mv_min))]
+    while knots[-1][0] < mv_max:
+        a = knots[-1]
+        end = a[0] + 1
+        while end < mv_max and segment_ok(a, (end + 1, centi(end + 1)), max_err):
+            end += 1
+        knots.append((end, centi(end)))
+    return knots
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("-e", "--max-error", type=float, default=3, help="centi-degrees between knots")
+    ap.add_argument("--t-min", type=float, default=-40)
+    ap.add_argument("--t-max", type=float, default=125)
+    ap.add_argument("-o", "--output", default=os.path.join(here, "..", "main", "src", "ntc_table.h"))
+    args = ap.parse_args()
+
+    # higher voltage is a higher resistance, a lower temperature
+    mvs = [mv for mv in range(1, REF_MV) if (REF_MV - mv) and (R_REF * mv) // (REF_MV - mv) > 0]
+    mv_min = min(mv for mv in mvs if formula(mv) <= args.t_max)
+    mv_max = max(mv for mv in mvs if formula(mv) >= args.t_min)
+    knots = build(mv_min, mv_max, args.max_error)
+
+    # the error bound checked by `ntc check`, rounded up to whole centi-degrees with the knot rounding
+    worst = max(abs(interp(a, b, mv) - formula(mv) * 100)
+                for a, b in zip(knots, knots[1:]) for mv in range(a[0], b[0] + 1))
+
+    lines = [
+        "/* generated by tools/gen_ntc_table.py, do not edit */",
+        "#ifndef __NTC_TABLE_H__",
+        "#define __NTC_TABLE_H__",
+        "",
+        "#include <stdint.h>",
+        "",
+        "/* %d knots, %.0f to %.0f C, interpolation within %d centi-degrees of the formula */"
+        % (len(knots), args.t_min, args.t_max, math.ceil(worst)),
+        "#define NTC_TABLE_MV_MIN               %d" % mv_min,
+        "#define NTC_TABLE_MV_MAX               %d" % mv_max,
+        "#define NTC_TABLE_MAX_ERROR_CENTI      %d" % math.ceil(worst),
+        "",
+        "typedef struct {",
+        "    uint16_t mv;",
+        "    int16_t centi;                     /**< 0.01 C */",
+        "} ntc_knot_t;",
+        "",
+        "static const ntc_knot_t ntc_table[] = {",
+    ]
+    for i in range(0, len(knots), 6):
+        lines.append("    " + " ".join("{%4d, %6d}," % k for k in knots[i:i + 6]))
+    lines += ["};", "", "#endif /* __NTC_TABLE_H__ */", ""]
+
+    with open(args.output, "w") as f:
+        f.write("\n".join(lines))
+
+    print("%d knots, %d to %d mV, max error %.2f centi-degrees" % (len(knots), mv_min, mv_max, worst))
+
+
+if __name__ == "__main__":
+    main()
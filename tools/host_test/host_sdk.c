@@ -0,0 +1,43 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "wm_cli.h"
+#include "host_sdk.h"
+
+static uint32_t g_failures;
+
+TickType_t xTaskGetTickCount(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (TickType_t)(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+int wm_cli_printf(const char *fmt, ...)
+{
+    char line[512];
+    va_list ap;
+    int len;
+
+    va_start(ap, fmt);
+    len = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+
+    /* the commands mark a failed check with FAIL on its line */
+    if (strstr(line, "FAIL"))
+        g_failures++;
+
+    fputs(line, stdout);
+
+    return len;
+}
+
+uint32_t host_failures(void)
+{
+    return g_failures;
+}
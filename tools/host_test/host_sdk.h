@@ -0,0 +1,23 @@
+#ifndef __HOST_SDK_H__
+#define __HOST_SDK_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The parts of the sdk the kernels under test need, on the host. Cli commands stay static in
+ * their files, WM_CLI_CMD_DEFINE(name, ...) leaves a host_cmd_<name> pointer to each one.
+ */
+typedef void (*host_cmd_t)(int argc, char *argv[]);
+
+/* lines printed through wm_cli_printf that reported FAIL */
+uint32_t host_failures(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HOST_SDK_H__ */
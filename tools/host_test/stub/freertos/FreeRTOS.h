@@ -0,0 +1,24 @@
+#ifndef __FREERTOS_H__
+#define __FREERTOS_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/* the error codes and libc come in with the sdk headers on the board */
+#define WM_ERR_SUCCESS                 0
+#define WM_ERR_FAILED                  -1
+#define WM_ERR_NO_MEM                  -2
+#define WM_ERR_INVALID_PARAM           -3
+#define WM_ERR_TIMEOUT                 -4
+#define WM_ERR_NO_INITED               -5
+#define WM_ERR_BUSY                    -6
+
+typedef uint32_t TickType_t;
+
+/* the board's clock, cycle counts printed on the host are in its terms */
+#define configCPU_CLOCK_HZ             240000000
+
+#define portTICK_PERIOD_MS             1
+#define portMAX_DELAY                  0xFFFFFFFF
+
+#endif /* __FREERTOS_H__ */
@@ -0,0 +1,8 @@
+#ifndef __SEMPHR_H__
+#define __SEMPHR_H__
+
+#include "FreeRTOS.h"
+
+typedef void *SemaphoreHandle_t;
+
+#endif /* __SEMPHR_H__ */
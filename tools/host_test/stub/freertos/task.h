@@ -0,0 +1,13 @@
+#ifndef __TASK_H__
+#define __TASK_H__
+
+#include "FreeRTOS.h"
+
+/* milliseconds of the monotonic clock */
+TickType_t xTaskGetTickCount(void);
+
+/* a single thread */
+#define taskENTER_CRITICAL()           do { } while (0)
+#define taskEXIT_CRITICAL()            do { } while (0)
+
+#endif /* __TASK_H__ */
@@ -0,0 +1,10 @@
+#ifndef __WM_CLI_H__
+#define __WM_CLI_H__
+
+#include "host_sdk.h"
+
+#define WM_CLI_CMD_DEFINE(name, fn, ...) const host_cmd_t host_cmd_##name = fn
+
+int wm_cli_printf(const char *fmt, ...);
+
+#endif /* __WM_CLI_H__ */
@@ -0,0 +1,13 @@
+#ifndef __WM_DRV_ADC_H__
+#define __WM_DRV_ADC_H__
+
+#include "wm_dt.h"
+
+typedef enum {
+    WM_ADC_CHANNEL_2 = 2,
+} wm_adc_channel_t;
+
+wm_device_t *wm_drv_adc_init(const char *dev_name);
+int wm_drv_adc_oneshot(wm_device_t *dev, wm_adc_channel_t channel, int *result);
+
+#endif /* __WM_DRV_ADC_H__ */
@@ -0,0 +1,14 @@
+#ifndef __WM_DT_H__
+#define __WM_DT_H__
+
+#define WM_DEV_ST_INITED               1
+
+typedef struct {
+    const char *name;
+    int state;
+    void *drv;
+} wm_device_t;
+
+wm_device_t *wm_dt_get_device_by_name(const char *name);
+
+#endif /* __WM_DT_H__ */
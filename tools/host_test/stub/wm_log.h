@@ -0,0 +1,11 @@
+#ifndef __WM_LOG_H__
+#define __WM_LOG_H__
+
+#include <stdio.h>
+
+#define wm_log_error(fmt, ...)         printf("E " LOG_TAG ": " fmt "\n", ##__VA_ARGS__)
+#define wm_log_warn(fmt, ...)          printf("W " LOG_TAG ": " fmt "\n", ##__VA_ARGS__)
+#define wm_log_info(fmt, ...)          printf("I " LOG_TAG ": " fmt "\n", ##__VA_ARGS__)
+#define wm_log_debug(fmt, ...)         printf("D " LOG_TAG ": " fmt "\n", ##__VA_ARGS__)
+
+#endif /* __WM_LOG_H__ */
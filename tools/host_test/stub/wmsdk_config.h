@@ -0,0 +1,6 @@
+#ifndef __WMSDK_CONFIG_H__
+#define __WMSDK_CONFIG_H__
+
+/* no driver components on the host, the code behind them is left out */
+
+#endif /* __WMSDK_CONFIG_H__ */
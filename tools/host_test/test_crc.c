@@ -0,0 +1,47 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "crc.h"
+#include "host_sdk.h"
+
+extern const host_cmd_t host_cmd_crcbench;
+
+/* the catalog check values of "123456789" */
+static int crc_check_catalog(void)
+{
+    int fails = 0;
+
+    if (crc8(CRC8_INIT, "123456789", 9) != 0xF7)
+        fails++;
+    if (crc16(CRC16_INIT, "123456789", 9) != 0x29B1)
+        fails++;
+    if (crc32(CRC32_INIT, "123456789", 9) != 0xCBF43926)
+        fails++;
+
+    printf("catalog %s\n", fails ? "FAIL" : "ok");
+
+    return fails;
+}
+
+/*
+ * With no arguments crcbench runs over a block, an odd length and a single byte, the table
+ * versions checked against the bitwise ones; arguments go to crcbench as [len] [loops].
+ */
+int main(int argc, char *argv[])
+{
+    static char *runs[][3] = {
+        { "crcbench", "4096", "20" },
+        { "crcbench", "7",    "1"  },
+        { "crcbench", "1",    "1"  },
+    };
+    int fails = crc_check_catalog();
+
+    if (argc > 1) {
+        argv[0] = "crcbench";
+        host_cmd_crcbench(argc, argv);
+    } else {
+        for (int i = 0; i < sizeof(runs) / sizeof(runs[0]); i++)
+            host_cmd_crcbench(3, runs[i]);
+    }
+
+    return (fails || host_failures()) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
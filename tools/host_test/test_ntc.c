@@ -0,0 +1,118 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "wm_drv_adc.h"
+#include "ntc.h"
+#include "ntc_alarm.h"
+#include "ntc_table.h"
+#include "sampler.h"
+#include "host_sdk.h"
+
+extern const host_cmd_t host_cmd_ntc;
+
+/* no adc, alarm or sampler on the host, only the conversion is under test */
+wm_device_t *wm_dt_get_device_by_name(const char *name)
+{
+    return NULL;
+}
+
+wm_device_t *wm_drv_adc_init(const char *dev_name)
+{
+    return NULL;
+}
+
+int wm_drv_adc_oneshot(wm_device_t *dev, wm_adc_channel_t channel, int *result)
+{
+    return WM_ERR_NO_INITED;
+}
+
+bool ntc_alarm_armed(void)
+{
+    return false;
+}
+
+int ntc_alarm_oneshot(int *mv)
+{
+    return WM_ERR_NO_INITED;
+}
+
+int sampler_register(const char *name, uint32_t period_ms, uint32_t phase_ms, sampler_read_t read, void *arg)
+{
+    return WM_ERR_NO_INITED;
+}
+
+int sampler_find(const char *name)
+{
+    return WM_ERR_INVALID_PARAM;
+}
+
+int sampler_latest(int id, sampler_sample_t *sample)
+{
+    return WM_ERR_FAILED;
+}
+
+/* the float formula tools/gen_ntc_table.py fits, in double: 100k ntc, B 3950, 100k to 3.3 V */
+static double ntc_reference(int mv)
+{
+    double rt = (double)(100 * 1000 * mv / (3300 - mv)) * 10;
+
+    return 1 / (1 / (273.15 + 25) + log(rt / 100000) / 3950) - 273.15 + 0.5;
+}
+
+/* every millivolt of the table against the formula, unrounded, and the ends of the range */
+static int ntc_check_table(void)
+{
+    int16_t centi;
+    double worst = 0;
+    double err;
+    int worst_mv = 0;
+    int fails    = 0;
+
+    for (int mv = NTC_TABLE_MV_MIN; mv <= NTC_TABLE_MV_MAX; mv++) {
+        if (WM_ERR_SUCCESS != ntc_mv_to_centi(mv, &centi)) {
+            printf("%d mV refused\n", mv);
+            fails++;
+            continue;
+        }
+
+        err = fabs(centi - ntc_reference(mv) * 100);
+        if (err > worst) {
+            worst    = err;
+            worst_mv = mv;
+        }
+    }
+
+    if (worst > NTC_TABLE_MAX_ERROR_CENTI)
+        fails++;
+
+    /* outside the table the nearest end is stored and the reading refused */
+    if ((WM_ERR_INVALID_PARAM != ntc_mv_to_centi(NTC_TABLE_MV_MIN - 1, &centi)) ||
+        (WM_ERR_INVALID_PARAM != ntc_mv_to_centi(NTC_TABLE_MV_MAX + 1, &centi)))
+        fails++;
+
+    printf("%d - %d mV, max error %.3f centi C at %d mV, bound %d: %s\n", NTC_TABLE_MV_MIN, NTC_TABLE_MV_MAX, worst,
+           worst_mv, NTC_TABLE_MAX_ERROR_CENTI, fails ? "FAIL" : "ok");
+
+    return fails;
+}
+
+/*
+ * With no arguments the table is swept against the formula and `ntc check` runs as on the board;
+ * arguments go to the ntc command, `bench [loops]` times the table against the formula.
+ */
+int main(int argc, char *argv[])
+{
+    static char *check[] = { "ntc", "check" };
+    int fails            = 0;
+
+    if (argc > 1) {
+        argv[0] = "ntc";
+        host_cmd_ntc(argc, argv);
+    } else {
+        fails = ntc_check_table();
+        host_cmd_ntc(2, check);
+    }
+
+    return (fails || host_failures()) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,28 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "host_sdk.h"
+
+extern const host_cmd_t host_cmd_pixbench;
+
+/*
+ * With no arguments pixbench runs over a screen line, an odd tail and a single pixel, each
+ * kernel checked against its per pixel loop; arguments go to pixbench as [pixels] [loops].
+ */
+int main(int argc, char *argv[])
+{
+    static char *runs[][3] = {
+        { "pixbench", "320", "20" },
+        { "pixbench", "7",   "1"  },
+        { "pixbench", "1",   "1"  },
+    };
+
+    if (argc > 1) {
+        argv[0] = "pixbench";
+        host_cmd_pixbench(argc, argv);
+    } else {
+        for (int i = 0; i < sizeof(runs) / sizeof(runs[0]); i++)
+            host_cmd_pixbench(3, runs[i]);
+    }
+
+    return host_failures() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "tsdb.h"
+#include "tscodec.h"
+#include "host_sdk.h"
+
+#define TSCODEC_FUZZ_STREAMS           20000
+#define TSCODEC_FUZZ_SAMPLES           500
+#define TSCODEC_FUZZ_SIZE              5000
+
+extern const host_cmd_t host_cmd_tscodec;
+
+/* no sd card on the host, the bench makes up its trace */
+tsdb_t *tsdb_default(void)
+{
+    return NULL;
+}
+
+int tsdb_query(tsdb_t *db, uint32_t t0, uint32_t t1, uint16_t series, tsdb_visit_t visit, void *arg,
+               tsdb_query_stat_t *stat)
+{
+    return WM_ERR_NO_INITED;
+}
+
+static uint32_t fuzz_rand(uint32_t *seed)
+{
+    *seed = *seed * 1103515245 + 12345;
+
+    return *seed;
+}
+
+static int fuzz_put(tscodec_enc_t *enc, tscodec_mode_t mode, uint32_t time, int32_t value)
+{
+    return (TSCODEC_FLOAT == mode) ? tscodec_put_float(enc, time, value / 100.0f)
+                                   : tscodec_put_fixed(enc, time, value);
+}
+
+static bool fuzz_get(tscodec_dec_t *dec, tscodec_mode_t mode, uint32_t time, int32_t value)
+{
+    uint32_t t;
+    int32_t v;
+    float f;
+
+    if (TSCODEC_FLOAT == mode)
+        return (WM_ERR_SUCCESS == tscodec_get_float(dec, &t, &f)) && (t == time) && (f == value / 100.0f);
+
+    return (WM_ERR_SUCCESS == tscodec_get_fixed(dec, &t, &v)) && (t == time) && (v == value);
+}
+
+/*
+ * random streams, with deltas of every width, into buffers of random size: what went in before the
+ * encoder ran out must come back exactly, a refused sample must leave the stream as it was
+ */
+static int tscodec_fuzz(void)
+{
+    static uint32_t time[TSCODEC_FUZZ_SAMPLES];
+    static int32_t value[TSCODEC_FUZZ_SAMPLES];
+    static uint8_t buf[TSCODEC_FUZZ_SIZE];
+    uint32_t seed = 7;
+    int fails     = 0;
+
+    for (int k = 0; k < TSCODEC_FUZZ_STREAMS; k++) {
+        tscodec_mode_t mode = (k & 1) ? TSCODEC_FLOAT : TSCODEC_FIXED;
+        uint32_t n          = 1 + fuzz_rand(&seed) % TSCODEC_FUZZ_SAMPLES;
+        uint32_t size       = 1 + fuzz_rand(&seed) % TSCODEC_FUZZ_SIZE;
+        uint32_t t          = fuzz_rand(&seed);
+        int32_t v           = (int32_t)fuzz_rand(&seed);
+        tscodec_enc_t enc;
+        tscodec_dec_t dec;
+        uint32_t bytes;
+        uint32_t i;
+
+        for (i = 0; i < n; i++) {
+            uint32_t r     = fuzz_rand(&seed);
+            uint32_t shift = r >> 28;
+
+            t        += (r >> 8) >> shift;
+            v        += (int32_t)((r >> 4) & 0xFFFF) >> shift;
+            v        -= 0x7FFF >> shift;
+            time[i]   = t;
+            value[i]  = v;
+        }
+
+        tscodec_enc_init(&enc, buf, size, mode);
+        for (i = 0; i < n; i++) {
+            bytes = tscodec_enc_bytes(&enc);
+            if (WM_ERR_SUCCESS != fuzz_put(&enc, mode, time[i], value[i])) {
+                if (tscodec_enc_bytes(&enc) != bytes)
+                    fails++;
+                break;
+            }
+        }
+
+        n = i;
+        tscodec_dec_init(&dec, buf, tscodec_enc_bytes(&enc), n, mode);
+        for (i = 0; (i < n) && fuzz_get(&dec, mode, time[i], value[i]); i++)
+            ;
+
+        if ((i != n) || fuzz_get(&dec, mode, 0, 0))
+            fails++;
+    }
+
+    printf("fuzz %u streams %s\n", TSCODEC_FUZZ_STREAMS, fails ? "FAIL" : "ok");
+
+    return fails;
+}
+
+/*
+ * With no arguments the edge case round trips of the tscodec command and a fuzz run; arguments go
+ * to the command, "bench [series]" for the host benchmark.
+ */
+int main(int argc, char *argv[])
+{
+    static char *check[] = { "tscodec" };
+    int fails            = 0;
+
+    if (argc > 1) {
+        argv[0] = "tscodec";
+        host_cmd_tscodec(argc, argv);
+    } else {
+        host_cmd_tscodec(1, check);
+        fails = tscodec_fuzz();
+    }
+
+    return (fails || host_failures()) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""Push images to the board's remote framebuffer service (`rfb start [port]`), sending only what changed.
+
+On connect the board sends a 12-byte hello:
+
+    "WRFB", version, reserved, width, height, pixel format (0: rgb565 high byte first), reserved
+
+then the client sends updates, each answered by the board once its tiles are on the screen:
+
+    update   type (1), reserved, tile count
+    tile     x, y, w, h, encoding, 3 reserved bytes, payload length, payload
+             encoding 0 raw: w * h pixels
+                      1 solid: one pixel
+                      2 rle: the tokens of the animation container, see anim_enc.py
+    reply    type (1), status (0 ok, 1 error), tiles drawn
+
+Fields are little-endian, pixels are rgb565 high byte first. A bad tile closes the connection.
+
+usage: rfb_push.py [-p port] [-i interval] host image0.png image1.png ...
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import time
+
+from anim_enc import changed_rects, crop, rle, to_rgb565
+
+MSG_UPDATE = 1
+ENC_RAW = 0
+ENC_SOLID = 1
+ENC_RLE = 2
+
+
+def recv_exact(sock, n):
+    buf = b""
+    while len(buf) < n:
+        chunk = sock.recv(n - len(buf))
+        if not chunk:
+            raise ConnectionError("connection closed")
+        buf += chunk
+    return buf
+
+
+def encode_tile(x, y, w, h, pixels):
+    """the smallest of solid, rle and raw"""
+    if pixels == pixels[:2] * (w * h):
+        enc, data = ENC_SOLID, pixels[:2]
+    else:
+        data = rle(pixels)
+        enc = ENC_RLE
+        if len(data) >= len(pixels):
+            enc, data = ENC_RAW, pixels
+    return struct.pack("<HHHHBxxxI", x, y, w, h, enc, len(data)) + data
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("-p", "--port", type=int, default=5900)
+    ap.add_argument("-i", "--interval", type=float, default=0, help="seconds between images")
+    ap.add_argument("-l", "--loop", action="store_true", help="repeat the images until interrupted")
+    ap.add_argument("host")
+    ap.add_argument("images", nargs="+")
+    args = ap.parse_args()
+
+    sock = socket.create_connection((args.host, args.port))
+    magic, version, width, height, fmt = struct.unpack("<4sBxHHBx", recv_exact(sock, 12))
+    if magic != b"WRFB" or version != 1 or fmt != 0:
+        sys.exit("unexpected hello %r" % magic)
+    print("%dx%d screen" % (width, height), file=sys.stderr)
+
+    frames = [to_rgb565(path, width, height) for path in args.images]
+    prev = None
+    n = 0
+    while True:
+        cur = frames[n % len(frames)]
+        rects = [(0, 0, width, height)] if prev is None else changed_rects(prev, cur, width, height)
+        tiles = [encode_tile(x, y, w, h, crop(cur, width, x, y, w, h)) for (x, y, w, h) in rects]
+
+        start = time.time()
+        sock.sendall(struct.pack("<BxH", MSG_UPDATE, len(tiles)) + b"".join(tiles))
+        _, status, drawn = struct.unpack("<BBH", recv_exact(sock, 4))
+        size = 4 + sum(len(t) for t in tiles)
+        print("image %d: %d tiles, %d bytes, %.0f ms%s" % (n, drawn, size, (time.time() - start) * 1000,
+                                                            "" if status == 0 else ", error"), file=sys.stderr)
+        if status != 0:
+            sys.exit(1)
+
+        prev = cur
+        n += 1
+        if n == len(frames) and not args.loop:
+            break
+        time.sleep(args.interval)
+
+
+if __name__ == "__main__":
+    main()